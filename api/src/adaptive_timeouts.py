@@ -0,0 +1,138 @@
+#!/usr/bin/env python3
+"""
+Adaptive Timeouts
+Per-request daemon timeouts derived from input size and observed latency.
+
+Successful round trips are kept in a sliding window per operation and input
+size class (powers of two in KiB). Once a class has enough samples its
+timeout is a multiple of the observed high quantile, so a hung tiny atom is
+abandoned within about a second while a legitimately huge decompile gets as
+long as its peers need. Until then the timeout falls back to the configured
+flat timeout plus a per-KiB allowance.
+"""
+
+import os
+import threading
+import logging
+from collections import deque
+from typing import Deque, Dict, Optional, Tuple
+
+logger = logging.getLogger(__name__)
+
+
+class AdaptiveTimeouts:
+    """Thread-safe per-(operation, size class) timeout model."""
+
+    def __init__(
+        self,
+        default_timeout: float = 10.0,
+        min_timeout: float = 1.0,
+        max_timeout: float = 120.0,
+        multiplier: float = 4.0,
+        quantile: float = 0.99,
+        per_kb: float = 0.05,
+        window: int = 512,
+        min_samples: int = 50,
+    ):
+        """
+        Args:
+            default_timeout: Timeout for small inputs before any latency has been observed
+            min_timeout: Lower bound for any timeout (seconds)
+            max_timeout: Upper bound for any timeout (seconds)
+            multiplier: Timeout as a multiple of the observed quantile
+            quantile: Latency quantile the multiplier is applied to
+            per_kb: Extra fallback seconds per KiB of input
+            window: Samples kept per (operation, size class)
+            min_samples: Samples required before the observed distribution is trusted
+        """
+        self.default_timeout = default_timeout
+        self.min_timeout = min_timeout
+        self.max_timeout = max_timeout
+        self.multiplier = multiplier
+        self.quantile = quantile
+        self.per_kb = per_kb
+        self.window = window
+        self.min_samples = min_samples
+
+        self._lock = threading.Lock()
+        self._samples: Dict[Tuple[str, int], Deque[float]] = {}
+
+    @classmethod
+    def from_env(cls, default_timeout: Optional[float] = None) -> "AdaptiveTimeouts":
+        """Build from FDO_DAEMON_TIMEOUT_* environment variables."""
+        if default_timeout is None:
+            default_timeout = float(os.getenv("FDO_DAEMON_REQUEST_TIMEOUT", "10.0"))
+        return cls(
+            default_timeout=default_timeout,
+            min_timeout=float(os.getenv("FDO_DAEMON_TIMEOUT_MIN", "1.0")),
+            max_timeout=float(os.getenv("FDO_DAEMON_TIMEOUT_MAX", "120.0")),
+            multiplier=float(os.getenv("FDO_DAEMON_TIMEOUT_MULTIPLIER", "4.0")),
+            quantile=float(os.getenv("FDO_DAEMON_TIMEOUT_QUANTILE", "0.99")),
+            per_kb=float(os.getenv("FDO_DAEMON_TIMEOUT_PER_KB", "0.05")),
+        )
+
+    @staticmethod
+    def size_class(size: int) -> int:
+        """0 for inputs under 1 KiB, then one class per power of two KiB."""
+        return (size // 1024).bit_length()
+
+    def record(self, op: str, size: int, seconds: float) -> None:
+        """Add a completed round trip (any HTTP response) to the model."""
+        key = (op, self.size_class(size))
+        with self._lock:
+            samples = self._samples.get(key)
+            if samples is None:
+                samples = self._samples[key] = deque(maxlen=self.window)
+            samples.append(seconds)
+
+    def timeout_for(self, op: str, size: int) -> float:
+        """
+        Timeout for a request of the given operation and input size.
+
+        Args:
+            op: "compile" or "decompile"
+            size: Input size in bytes
+
+        Returns:
+            Timeout in seconds, clamped to [min_timeout, max_timeout]
+        """
+        observed = self._observed_quantile(op, self.size_class(size), self.quantile)
+        if observed is not None:
+            timeout = observed * self.multiplier
+        else:
+            timeout = self.default_timeout + self.per_kb * size / 1024.0
+        return min(self.max_timeout, max(self.min_timeout, timeout))
+
+    def observed_quantile(self, op: str, size: int, quantile: float) -> Optional[float]:
+        """
+        Observed latency quantile for requests like this one.
+
+        Returns:
+            Seconds, or None until the size class has min_samples samples
+        """
+        return self._observed_quantile(op, self.size_class(size), quantile)
+
+    def _observed_quantile(self, op: str, size_class: int, quantile: float) -> Optional[float]:
+        with self._lock:
+            samples = self._samples.get((op, size_class))
+            if samples is None or len(samples) < self.min_samples:
+                return None
+            ordered = sorted(samples)
+        index = min(len(ordered) - 1, int(quantile * len(ordered)))
+        return ordered[index]
+
+    def get_status(self) -> Dict[str, Dict[str, float]]:
+        """Current timeout per observed (operation, size class), for diagnostics."""
+        with self._lock:
+            keys = sorted(self._samples)
+            counts = {key: len(self._samples[key]) for key in keys}
+        status = {}
+        for op, size_class in keys:
+            upper_kb = 1 << size_class
+            quantile = self._observed_quantile(op, size_class, self.quantile)
+            status[f"{op}:<{upper_kb}KiB"] = {
+                "samples": counts[(op, size_class)],
+                "observed_quantile_ms": round(quantile * 1000, 3) if quantile is not None else None,
+                "timeout_s": round(self.timeout_for(op, (upper_kb * 1024) - 1), 3)
+            }
+        return status
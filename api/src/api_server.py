@@ -31,6 +31,10 @@ from fdo_daemon_manager import FdoDaemonManager
 from fdo_daemon_client import FdoDaemonClient, FdoDaemonError
 from fdo_daemon_pool_manager import FdoDaemonPoolManager
 from fdo_daemon_pool_client import FdoDaemonPoolClient
+from pool_broker import (
+    PoolBrokerClient, DEFAULT_SOCKET, start_broker_process, stop_broker_process, ensure_supervisor,
+    discover_daemon_exe
+)
 
 # Import file management
 from database import init_database, test_database_connection
@@ -38,13 +42,38 @@ from file_manager import FileManager, Script
 
 # Import chunking functionality
 from fdo_chunker import FdoChunker, FdoChunkingError
+from p3_payload_builder import P3PacketBuffer
 
 # Import P3 frame parsing and FDO detection
 from p3_frame_parser import P3FrameParser, P3FrameParseError
-from fdo_detector import FdoDetector, FdoDetectionError
+from fdo_detector import FdoDetector, FdoDetectionError, FdoBatchTooLargeError
 
 # Import JSONL processing
-from jsonl_processor import JsonlProcessor, JsonlProcessingError
+from jsonl_processor import JsonlProcessor, JsonlProcessingError, DecompressedSizeError
+
+# Import raw P3 stream / pcap ingestion
+from p3_capture_reader import P3CaptureReader
+
+# Import off-loop frame extraction
+from extraction_pool import ExtractionPool, jsonl_compression
+
+# Import Accept-Encoding response compression
+from response_compression import CompressionMiddleware, available_encodings
+
+# Import metrics registry
+from metrics import REGISTRY, HTTP_REQUESTS, HTTP_REQUEST_SECONDS, JSONL_FRAMES
+
+# Import per-request phase timing
+from request_timing import start_recording, span, timings_block
+
+# Import size/latency-derived daemon request timeouts
+from adaptive_timeouts import AdaptiveTimeouts
+from cgroup_resources import memory_limit
+
+# Import daemon pool scheduling lanes
+from pool_scheduler import (
+    set_request_lane, PoolOverloadedError, LANE_INTERACTIVE, LANE_CHUNKING, LANE_BULK
+)
 
 # Configure logging
 logging.basicConfig(level=logging.INFO)
@@ -66,11 +95,44 @@ app.add_middleware(
     allow_headers=["*"],
 )
 
+# Compress responses per Accept-Encoding (zstd, gzip); FDO_RESPONSE_COMPRESSION_MIN_BYTES=0 disables
+compression_min_bytes = int(os.getenv("FDO_RESPONSE_COMPRESSION_MIN_BYTES", "1024"))
+if compression_min_bytes > 0:
+    app.add_middleware(CompressionMiddleware, minimum_size=compression_min_bytes)
+
+
+@app.middleware("http")
+async def record_request_metrics(request: Request, call_next):
+    """Record request latency and status, labelled by route template to bound cardinality."""
+    start = time.perf_counter()
+    status = 500
+    try:
+        response = await call_next(request)
+        status = response.status_code
+        return response
+    finally:
+        route = request.scope.get("route")
+        route_label = getattr(route, "path_format", None) or getattr(route, "path", None) or "other"
+        HTTP_REQUEST_SECONDS.observe(request.method, route_label, value=time.perf_counter() - start)
+        HTTP_REQUESTS.inc(request.method, route_label, str(status))
+
+
+@app.middleware("http")
+async def record_server_timing(request: Request, call_next):
+    """Install a per-request span recorder and report its phases as a Server-Timing header."""
+    recorder = start_recording()
+    response = await call_next(request)
+    if recorder.phases:
+        response.headers["Server-Timing"] = recorder.server_timing_header()
+    return response
+
+
 # Global managers and clients
 fdo_tools_manager = None
 daemon_manager = None
 daemon_client = None
 pool_manager = None  # For pool mode
+extraction_pool = None  # Worker processes for JSONL/capture extraction
 execution_mode = "single_daemon"  # "single_daemon" or "daemon_pool"
 
 
@@ -149,6 +211,7 @@ class CompileChunkResponse(BaseModel):
     validation_result: Optional[Dict] = None  # If validate_first=True
     stats: Optional[Dict] = None            # Chunking statistics
     error: Optional[str] = None             # Error message if failed
+    timings: Optional[Dict] = None          # Per-phase durations (with ?timings=true)
 
 
 # P3 FDO Detection models
@@ -167,6 +230,11 @@ class DetectFdoResponse(BaseModel):
     summary: Optional[str] = None           # Human-readable detection summary
 
 
+class DetectFdoBatchRequest(BaseModel):
+    frames: List[str]                       # Base64-encoded complete P3 frames
+    include_data: bool = False              # Include base64 FDO data for detected frames
+
+
 # JSONL Processing models
 class JsonlProcessResponse(BaseModel):
     success: bool                           # Whether JSONL processing succeeded
@@ -184,6 +252,7 @@ class JsonlProcessResponse(BaseModel):
     killer_frames_count: int = 0            # Number of frames that crashed daemon
     daemon_restarts: int = 0                # Number of times daemon was restarted
     frames_skipped_after_crash: int = 0     # Number of frames skipped due to unrecoverable crashes
+    timings: Optional[Dict] = None          # Per-phase durations (with ?timings=true)
 
 
 # --- Helpers ---
@@ -301,10 +370,55 @@ def _build_daemon_error_detail(daemon_content_type: str, daemon_text: str, daemo
 
     return err
 
+
+def _pool_overloaded_exception(e: PoolOverloadedError) -> HTTPException:
+    """429 with Retry-After for work the daemon pool cannot take on within its lane's wait budget."""
+    return HTTPException(
+        status_code=429,
+        detail={
+            "success": False,
+            "error": "Daemon pool overloaded",
+            "details": {
+                "lane": e.lane,
+                "estimated_wait_s": round(e.estimated_wait, 3) if e.estimated_wait != float("inf") else None,
+                "retry_after_s": e.retry_after,
+                "message": str(e)
+            }
+        },
+        headers={"Retry-After": str(e.retry_after)}
+    )
+
+
+def _admit_to_pool(lane: str, size: int = 0) -> None:
+    """
+    Put the current request in a scheduling lane and apply pool admission control.
+
+    No-op in single daemon mode.
+
+    Raises:
+        HTTPException: 429 if the lane's queue wait would exceed its budget
+    """
+    if pool_manager is None:
+        return
+    set_request_lane(lane)
+    try:
+        pool_manager.scheduler.admit(size=size)
+    except PoolOverloadedError as e:
+        logger.debug(str(e))
+        raise _pool_overloaded_exception(e)
+
+
+@app.exception_handler(PoolOverloadedError)
+async def pool_overloaded_handler(request: Request, e: PoolOverloadedError):
+    """Fallback for pool overload raised outside the endpoints' own error mapping."""
+    http_error = _pool_overloaded_exception(e)
+    return JSONResponse(status_code=429, content={"detail": http_error.detail}, headers=http_error.headers)
+
+
 @app.on_event("startup")
 async def startup_event():
     """Initialize FDO Tools on startup"""
-    global fdo_tools_manager, daemon_manager, daemon_client, pool_manager, execution_mode
+    global fdo_tools_manager, daemon_manager, daemon_client, pool_manager, extraction_pool, execution_mode
 
     # Detect pool mode from environment
     pool_enabled = os.getenv("FDO_DAEMON_POOL_ENABLED", "false").lower() == "true"
@@ -322,6 +436,13 @@ async def startup_event():
 
         logger.info("📦 Database initialized successfully")
 
+        extraction_pool = ExtractionPool.from_env()
+        logger.info(f"🧵 Extraction workers: {extraction_pool.workers} "
+                    f"(inline below {extraction_pool.inline_bytes} bytes)")
+        if compression_min_bytes > 0:
+            logger.info(f"🗜️ Response compression: {', '.join(available_encodings())} "
+                        f"(from {compression_min_bytes} bytes)")
+
         # Initialize manager and discover releases/backends
         fdo_tools_manager = get_fdo_tools_manager()
         releases = fdo_tools_manager.discover_releases()
@@ -341,33 +462,28 @@ async def startup_event():
 
         if pool_enabled:
             # Pool mode - start multiple daemons
-            pool_size = int(os.getenv("FDO_DAEMON_POOL_SIZE", "5"))
-            base_port = int(os.getenv("FDO_DAEMON_POOL_BASE_PORT", "8080"))
-            health_interval = float(os.getenv("FDO_DAEMON_HEALTH_INTERVAL", "10.0"))
-            restart_delay = float(os.getenv("FDO_DAEMON_RESTART_DELAY", "2.0"))
-            max_restart_attempts = int(os.getenv("FDO_DAEMON_MAX_RESTART_ATTEMPTS", "5"))
             max_retries = int(os.getenv("FDO_DAEMON_MAX_RETRIES", "3"))
             request_timeout = float(os.getenv("FDO_DAEMON_REQUEST_TIMEOUT", "10.0"))
-            circuit_breaker_threshold = int(os.getenv("FDO_DAEMON_CIRCUIT_BREAKER_THRESHOLD", "3"))
-
-            logger.info(f"🔧 Pool configuration: size={pool_size}, ports={base_port}-{base_port + pool_size - 1}")
-
-            pool_manager = FdoDaemonPoolManager(
-                exe_path=daemon_exe,
-                pool_size=pool_size,
-                base_port=base_port,
-                bind_host=bind,
-                restart_delay=restart_delay,
-                health_interval=health_interval,
-                max_restart_attempts=max_restart_attempts,
-                circuit_breaker_threshold=circuit_breaker_threshold
-            )
-            pool_manager.start()
+            broker_socket = os.getenv("FDO_POOL_BROKER_SOCKET")
+
+            if broker_socket:
+                # Worker process: the daemons are owned by the pool broker started in main()
+                pool_manager = await PoolBrokerClient.connect(broker_socket)
+                logger.info(f"🔧 Using shared daemon pool broker at {broker_socket}")
+            else:
+                pool_manager = FdoDaemonPoolManager.from_env(daemon_exe, bind)
+                logger.info(f"🔧 Pool configuration: size={pool_manager.pool_size or 'auto'}, "
+                            f"base_port={pool_manager.base_port}, slots_per_daemon={pool_manager.slots_per_daemon}")
+                pool_manager.start()
 
             daemon_client = FdoDaemonPoolClient(
                 pool_manager=pool_manager,
                 max_retries=max_retries,
-                timeout_seconds=request_timeout
+                timeout_seconds=request_timeout,
+                hedging=os.getenv("FDO_DAEMON_HEDGING", "false").lower() == "true",
+                hedge_quantile=float(os.getenv("FDO_DAEMON_HEDGE_QUANTILE", "0.95")),
+                hedge_budget=float(os.getenv("FDO_DAEMON_HEDGE_BUDGET", "0.05")),
+                fast_transport=os.getenv("FDO_DAEMON_FAST_TRANSPORT", "false").lower() == "true"
             )
 
             # Confirm pool health
@@ -386,7 +502,12 @@ async def startup_event():
             )
             daemon_manager.start()
 
-            daemon_client = FdoDaemonClient(base_url=daemon_manager.base_url, token=token)
+            daemon_client = FdoDaemonClient(
+                base_url=daemon_manager.base_url,
+                token=token,
+                timeouts=AdaptiveTimeouts.from_env(),
+                fast_transport=os.getenv("FDO_DAEMON_FAST_TRANSPORT", "false").lower() == "true"
+            )
 
             # Confirm health
             health = await daemon_client.health()
@@ -463,6 +584,12 @@ async def health_check():
         )
 
 
+@app.get("/health/extraction")
+async def extraction_health_check():
+    """JSONL/capture extractions running in worker processes, with frames processed so far"""
+    return extraction_pool.get_status()
+
+
 @app.get("/health/pool")
 async def pool_health_check():
     """Get detailed pool status and metrics (pool mode only)"""
@@ -487,33 +614,9 @@ async def pool_health_check():
         )
 
 
-def get_container_memory_limit() -> Optional[int]:
-    """
-    Detect Docker container memory limit from cgroup files.
-    Returns memory limit in bytes, or None if not in a container or limit not set.
-    """
-    cgroup_paths = [
-        '/sys/fs/cgroup/memory/memory.limit_in_bytes',  # cgroup v1
-        '/sys/fs/cgroup/memory.max',  # cgroup v2
-    ]
-
-    for path in cgroup_paths:
-        try:
-            with open(path, 'r') as f:
-                limit = int(f.read().strip())
-                # cgroup v1 uses a very large number (9223372036854771712) when unlimited
-                # cgroup v2 uses "max" string for unlimited (already handled by int() raising ValueError)
-                if limit < 9000000000000000:  # Reasonable upper bound
-                    return limit
-        except (FileNotFoundError, ValueError, PermissionError):
-            continue
-
-    return None
-
-
 @app.get("/health/pool/memory")
 async def pool_memory_metrics():
-    """Get per-daemon memory usage metrics and system memory status"""
+    """Get per-daemon memory, CPU and context switch metrics (sampled in the background) and system memory status"""
     if execution_mode != "daemon_pool":
         return JSONResponse(
             status_code=400,
@@ -526,42 +629,16 @@ async def pool_memory_metrics():
     try:
         import psutil
 
-        # Collect daemon processes
-        daemon_procs = {}
-        starter_procs = {}
-        wine_infra = []
-
-        for proc in psutil.process_iter(['pid', 'name', 'memory_info', 'cmdline']):
-            try:
-                rss_mb = proc.info['memory_info'].rss / 1024 / 1024
-                name = proc.info['name']
-                cmdline = ' '.join(proc.info['cmdline']) if proc.info['cmdline'] else ''
-
-                # Match daemon processes by port
-                if 'fdo_daemon.exe' in cmdline:
-                    # Extract port from command line
-                    for i, arg in enumerate(proc.info['cmdline']):
-                        if arg == '--port' and i + 1 < len(proc.info['cmdline']):
-                            port = int(proc.info['cmdline'][i + 1])
-                            daemon_procs[port] = rss_mb
-                            break
-
-                # Match launcher processes (start.exe with significant memory)
-                elif name == 'start.exe' and rss_mb > 20:
-                    # Associate with closest daemon (approximate by PID proximity)
-                    starter_procs[proc.info['pid']] = rss_mb
-
-                # Wine infrastructure
-                elif 'wine' in name.lower() or name in ['services.exe', 'winedevice.exe', 'explorer.exe', 'plugplay.exe', 'svchost.exe', 'rpcss.exe']:
-                    wine_infra.append(rss_mb)
-
-            except (psutil.NoSuchProcess, psutil.AccessDenied, ValueError):
-                pass
-
-        # Calculate averages
-        avg_daemon_mem = sum(daemon_procs.values()) / len(daemon_procs) if daemon_procs else 0
-        avg_starter_mem = sum(starter_procs.values()) / len(starter_procs) if starter_procs else 0
-        total_wine_infra = sum(wine_infra)
+        # Cached per-daemon process tree samples (see daemon_resources)
+        snapshot = pool_manager.resources.snapshot()
+        daemons = snapshot["daemons"]
+        mb = 1024 * 1024
+
+        daemon_mems = [d["daemon_rss_bytes"] / mb for d in daemons.values()]
+        launcher_mems = [d["children_rss_bytes"] / mb for d in daemons.values()]
+        avg_daemon_mem = sum(daemon_mems) / len(daemon_mems) if daemon_mems else 0
+        avg_starter_mem = sum(launcher_mems) / len(launcher_mems) if launcher_mems else 0
+        total_wine_infra = snapshot["wine_infra_rss_bytes"] / mb
 
         # Get pool size
         pool_size = pool_manager.pool_size
@@ -574,15 +651,25 @@ async def pool_memory_metrics():
         pool_status = pool_manager.get_pool_status()
         instances_memory = []
         for instance in pool_status['instances']:
-            port = instance['port']
-            daemon_mem = daemon_procs.get(port, avg_daemon_mem)
+            stats = daemons.get(instance['id'])
+            if stats is None:
+                # Not running at the last sample
+                instances_memory.append({'id': instance['id'], 'port': instance['port'], 'state': instance['state']})
+                continue
+            daemon_mem = stats['daemon_rss_bytes'] / mb
+            launcher_mem = stats['children_rss_bytes'] / mb
             instances_memory.append({
                 'id': instance['id'],
-                'port': port,
+                'port': instance['port'],
                 'daemon_memory_mb': round(daemon_mem, 1),
-                'launcher_memory_mb': round(avg_starter_mem, 1),
+                'launcher_memory_mb': round(launcher_mem, 1),
                 'wine_infra_share_mb': round(wine_infra_per_daemon, 1),
-                'total_memory_mb': round(daemon_mem + avg_starter_mem + wine_infra_per_daemon, 1)
+                'total_memory_mb': round(daemon_mem + launcher_mem + wine_infra_per_daemon, 1),
+                'pids': stats['pids'],
+                'cpu_seconds': stats['cpu_seconds'],
+                'cpu_percent': stats['cpu_percent'],
+                'voluntary_ctxt_switches': stats['voluntary_ctxt_switches'],
+                'involuntary_ctxt_switches': stats['involuntary_ctxt_switches']
             })
 
         # Get system memory metrics
@@ -595,7 +682,7 @@ async def pool_memory_metrics():
         }
 
         # Get container memory limit if in Docker
-        container_limit = get_container_memory_limit()
+        container_limit = memory_limit()
         if container_limit:
             system_memory['container_memory_limit_mb'] = round(container_limit / 1024 / 1024, 1)
 
@@ -607,6 +694,8 @@ async def pool_memory_metrics():
             'wine_infra_per_daemon_mb': round(wine_infra_per_daemon, 1),
             'per_daemon_total_mb': round(per_daemon_total, 1),
             'instances': instances_memory,
+            'sampled_at': snapshot['sampled_at'],
+            'sample_interval_s': pool_manager.resources.interval,
             **system_memory
         }
 
@@ -675,10 +764,14 @@ async def compile_fdo(request: CompileRequest):
                 }
             )
 
+        _admit_to_pool(LANE_INTERACTIVE, len(source))
+
         # Compile using daemon (text/plain -> octet-stream)
         start_time = time.time()
         try:
             binary_data = await daemon_client.compile_source(sanitize_fdo_source(source))
+        except PoolOverloadedError as e:
+            raise _pool_overloaded_exception(e)
         except FdoDaemonError as e:
             # Single daemon error details with normalized error payload
             norm = _build_daemon_error_detail(e.content_type, e.text, e.json)
@@ -763,12 +856,16 @@ async def decompile_fdo(request: DecompileRequest):
                 }
             )
 
+        _admit_to_pool(LANE_INTERACTIVE, len(binary_data))
+
         # Decompile using daemon (octet-stream -> text/plain)
         start_time = time.time()
         try:
             source_code_raw = await daemon_client.decompile_binary(binary_data)
             # Unescape quotes that the FDO daemon may have escaped
             source_code = source_code_raw.replace('\\"', '"')
+        except PoolOverloadedError as e:
+            raise _pool_overloaded_exception(e)
         except FdoDaemonError as e:
             norm = _build_daemon_error_detail(e.content_type, e.text, e.json)
             raise HTTPException(
@@ -815,8 +912,107 @@ async def decompile_fdo(request: DecompileRequest):
         )
 
 
+async def _decompile_extracted_frames(processing_result: Dict[str, Any], source_name: str,
+                                     start_time: float) -> JsonlProcessResponse:
+    """
+    Decompile FDO frames extracted by JsonlProcessor and build the response.
+
+    Shared by the JSONL and raw capture ingestion endpoints.
+    """
+    JSONL_FRAMES.inc("parsed", amount=processing_result.get('frames_processed', 0))
+    JSONL_FRAMES.inc("fdo", amount=processing_result.get('fdo_frames_found', 0))
+
+    # Check if processing found any FDO data
+    if not processing_result['success']:
+        return JsonlProcessResponse(
+            success=False,
+            frames_processed=processing_result['frames_processed'],
+            fdo_frames_found=processing_result['fdo_frames_found'],
+            total_fdo_bytes=processing_result['total_fdo_bytes'],
+            chronological_order=processing_result['chronological_order'],
+            supported_tokens=processing_result['supported_tokens'],
+            error=processing_result['error']
+        )
+
+    # Decompile the extracted FDO frames individually
+    fdo_frames = processing_result['fdo_frames']
+    if not fdo_frames:
+        return JsonlProcessResponse(
+            success=False,
+            frames_processed=processing_result['frames_processed'],
+            fdo_frames_found=processing_result['fdo_frames_found'],
+            total_fdo_bytes=0,
+            chronological_order=processing_result['chronological_order'],
+            supported_tokens=processing_result['supported_tokens'],
+            error="No FDO data extracted from frames"
+        )
+
+    # Decompile frames individually using enhanced forensic approach with daemon restart capability
+    decompile_start = time.time()
+    try:
+        # Pass daemon_manager for restart capability during crashes
+        with span("decompile"):
+            decompilation_result = await JsonlProcessor._decompile_frames_individually(fdo_frames, daemon_client, daemon_manager)
+        source_code = decompilation_result['source']
+        frames_decompiled_successfully = decompilation_result['frames_decompiled_successfully']
+        frames_failed_decompilation = decompilation_result['frames_failed_decompilation']
+        decompilation_failure_rate = decompilation_result['decompilation_failure_rate']
+        killer_frames = decompilation_result.get('killer_frames', [])
+        daemon_restarts = decompilation_result.get('daemon_restarts', 0)
+        frames_skipped_after_crash = decompilation_result.get('frames_skipped_after_crash', 0)
+        JSONL_FRAMES.inc("decompiled", amount=frames_decompiled_successfully)
+        JSONL_FRAMES.inc("failed", amount=frames_failed_decompilation)
+    except PoolOverloadedError as e:
+        raise _pool_overloaded_exception(e)
+    except Exception as e:
+        return JsonlProcessResponse(
+            success=False,
+            frames_processed=processing_result['frames_processed'],
+            fdo_frames_found=processing_result['fdo_frames_found'],
+            total_fdo_bytes=processing_result['total_fdo_bytes'],
+            chronological_order=processing_result['chronological_order'],
+            supported_tokens=processing_result['supported_tokens'],
+            error=f"Frame-by-frame decompilation error: {str(e)}"
+        )
+
+    decompile_duration = time.time() - decompile_start
+    total_duration = time.time() - start_time
+
+    logger.info(f"Enhanced JSONL processing successful: {source_name}, "
+               f"{processing_result['frames_processed']} frames, "
+               f"{processing_result['fdo_frames_found']} FDO frames, "
+               f"{frames_decompiled_successfully}/{processing_result['fdo_frames_found']} frames decompiled, "
+               f"{len(killer_frames)} killer frames, {daemon_restarts} daemon restarts, "
+               f"{frames_skipped_after_crash} frames skipped, "
+               f"{len(source_code)} chars, {decompilation_failure_rate:.1f}% failure rate, "
+               f"{total_duration:.3f}s")
+
+    if killer_frames:
+        logger.warning(f"🔥 {len(killer_frames)} KILLER FRAMES detected in {source_name}!")
+        for killer in killer_frames[:3]:  # Log first 3 killer frames
+            logger.warning(f"   Killer Frame {killer['index']}: {killer['token']}/{killer['stream_id']} "
+                         f"({killer['size_bytes']} bytes) - {killer['error']}")
+
+    return JsonlProcessResponse(
+        success=True,
+        source=source_code,
+        frames_processed=processing_result['frames_processed'],
+        fdo_frames_found=processing_result['fdo_frames_found'],
+        total_fdo_bytes=processing_result['total_fdo_bytes'],
+        chronological_order=processing_result['chronological_order'],
+        supported_tokens=processing_result['supported_tokens'],
+        decompilation_time=f"{decompile_duration:.3f}s",
+        frames_decompiled_successfully=frames_decompiled_successfully,
+        frames_failed_decompilation=frames_failed_decompilation,
+        decompilation_failure_rate=decompilation_failure_rate,
+        killer_frames_count=len(killer_frames),
+        daemon_restarts=daemon_restarts,
+        frames_skipped_after_crash=frames_skipped_after_crash
+    )
+
+
 @app.post("/decompile-jsonl", response_model=JsonlProcessResponse)
-async def decompile_jsonl_file(file: UploadFile = File(...)):
+async def decompile_jsonl_file(file: UploadFile = File(...), timings: bool = False):
     """
     Process JSONL file containing P3 frames to extract and decompile FDO streams.
 
@@ -833,30 +1029,25 @@ async def decompile_jsonl_file(file: UploadFile = File(...)):
     start_time = time.time()
 
     try:
-        # Validate file type
-        if not file.filename.lower().endswith('.jsonl'):
+        # Frame-by-frame decompiles run in the bulk lane so long jobs cannot starve interactive requests
+        _admit_to_pool(LANE_BULK)
+
+        # Validate file type (.jsonl, or gzip/zstd compressed .jsonl.gz/.jsonl.zst)
+        try:
+            compression = jsonl_compression(file.filename)
+        except ValueError as e:
             raise HTTPException(
                 status_code=400,
                 detail={
                     "success": False,
-                    "error": "File must have .jsonl extension",
+                    "error": str(e),
                     "details": {"filename": file.filename}
                 }
             )
 
-        # Read file content and create line iterator for streaming processing
+        # Read file content; decoding and parsing happen in an extraction worker
         try:
             content = await file.read()
-            jsonl_content = content.decode('utf-8')
-        except UnicodeDecodeError as e:
-            raise HTTPException(
-                status_code=400,
-                detail={
-                    "success": False,
-                    "error": "File must be valid UTF-8 encoded JSONL",
-                    "details": {"decode_error": str(e)}
-                }
-            )
         except Exception as e:
             raise HTTPException(
                 status_code=400,
@@ -867,7 +1058,7 @@ async def decompile_jsonl_file(file: UploadFile = File(...)):
                 }
             )
 
-        if not jsonl_content.strip():
+        if not content.strip():
             raise HTTPException(
                 status_code=400,
                 detail={
@@ -876,17 +1067,28 @@ async def decompile_jsonl_file(file: UploadFile = File(...)):
                 }
             )
 
-        # Create line iterator factory for streaming processor
-        def create_line_iterator():
-            """Create line iterator that yields JSONL lines one at a time."""
-            for line in jsonl_content.splitlines():
-                if line.strip():  # Skip empty lines
-                    yield line
-
-        # Process JSONL file using streaming processor
+        # Process JSONL file using streaming processor, off the event loop for large uploads
         try:
-            # Pass line iterator factory to allow multiple iterations
-            processing_result = JsonlProcessor.stream_process_file(create_line_iterator)
+            with span("extract"):
+                processing_result = await extraction_pool.extract_jsonl(file.filename, content, compression)
+        except UnicodeDecodeError as e:
+            raise HTTPException(
+                status_code=400,
+                detail={
+                    "success": False,
+                    "error": "File must be valid UTF-8 encoded JSONL",
+                    "details": {"decode_error": str(e)}
+                }
+            )
+        except DecompressedSizeError as e:
+            raise HTTPException(
+                status_code=413,
+                detail={
+                    "success": False,
+                    "error": str(e),
+                    "details": {"filename": file.filename, "compressed_bytes": len(content)}
+                }
+            )
         except JsonlProcessingError as e:
             raise HTTPException(
                 status_code=400,
@@ -905,121 +1107,138 @@ async def decompile_jsonl_file(file: UploadFile = File(...)):
                 }
             )
 
-        # Check if processing found any FDO data
-        if not processing_result['success']:
-            return JsonlProcessResponse(
-                success=False,
-                frames_processed=processing_result['frames_processed'],
-                fdo_frames_found=processing_result['fdo_frames_found'],
-                total_fdo_bytes=processing_result['total_fdo_bytes'],
-                chronological_order=processing_result['chronological_order'],
-                supported_tokens=processing_result['supported_tokens'],
-                error=processing_result['error']
-            )
+        response = await _decompile_extracted_frames(processing_result, file.filename, start_time)
+        if timings:
+            response.timings = timings_block()
+        return response
 
-        # Decompile the extracted FDO frames individually
-        fdo_frames = processing_result['fdo_frames']
-        if not fdo_frames:
-            return JsonlProcessResponse(
-                success=False,
-                frames_processed=processing_result['frames_processed'],
-                fdo_frames_found=processing_result['fdo_frames_found'],
-                total_fdo_bytes=0,
-                chronological_order=processing_result['chronological_order'],
-                supported_tokens=processing_result['supported_tokens'],
-                error="No FDO data extracted from frames"
-            )
+    except HTTPException:
+        # Re-raise HTTP exceptions (validation errors)
+        raise
+    except Exception as e:
+        logger.error(f"Unexpected error during JSONL processing: {e}", exc_info=True)
+        raise HTTPException(
+            status_code=500,
+            detail={
+                "success": False,
+                "error": "Internal server error during JSONL processing",
+                "details": {"exception": str(e)}
+            }
+        )
+
+
+@app.post("/decompile-capture", response_model=JsonlProcessResponse)
+async def decompile_capture_file(file: UploadFile = File(...), port: Optional[int] = None,
+                                 timings: bool = False):
+    """
+    Process a raw P3 byte stream or pcap/pcapng capture and decompile its FDO streams.
+
+    Frames are recovered directly from the bytes (TCP payloads are reassembled
+    per flow, then resynchronized on the P3 sync/msg_end bytes), avoiding the
+    JSONL/hex round trip.
+
+    Args:
+        file: Uploaded .pcap, .pcapng or raw P3 stream file (format detected from magic bytes)
+        port: Optional TCP port filter for captures (e.g. 5190)
+
+    Returns:
+        JsonlProcessResponse with decompiled source and processing metadata
+    """
+    start_time = time.time()
+
+    try:
+        # Frame-by-frame decompiles run in the bulk lane so long jobs cannot starve interactive requests
+        _admit_to_pool(LANE_BULK)
 
-        # Decompile frames individually using enhanced forensic approach with daemon restart capability
-        decompile_start = time.time()
         try:
-            # Pass daemon_manager for restart capability during crashes
-            decompilation_result = await JsonlProcessor._decompile_frames_individually(fdo_frames, daemon_client, daemon_manager)
-            source_code = decompilation_result['source']
-            frames_decompiled_successfully = decompilation_result['frames_decompiled_successfully']
-            frames_failed_decompilation = decompilation_result['frames_failed_decompilation']
-            decompilation_failure_rate = decompilation_result['decompilation_failure_rate']
-            killer_frames = decompilation_result.get('killer_frames', [])
-            daemon_restarts = decompilation_result.get('daemon_restarts', 0)
-            frames_skipped_after_crash = decompilation_result.get('frames_skipped_after_crash', 0)
+            content = await file.read()
         except Exception as e:
-            return JsonlProcessResponse(
-                success=False,
-                frames_processed=processing_result['frames_processed'],
-                fdo_frames_found=processing_result['fdo_frames_found'],
-                total_fdo_bytes=processing_result['total_fdo_bytes'],
-                chronological_order=processing_result['chronological_order'],
-                supported_tokens=processing_result['supported_tokens'],
-                error=f"Frame-by-frame decompilation error: {str(e)}"
+            raise HTTPException(
+                status_code=400,
+                detail={
+                    "success": False,
+                    "error": "Failed to read uploaded file",
+                    "details": {"read_error": str(e)}
+                }
             )
 
-        decompile_duration = time.time() - decompile_start
-        total_duration = time.time() - start_time
+        if not content:
+            raise HTTPException(
+                status_code=400,
+                detail={
+                    "success": False,
+                    "error": "Capture file is empty"
+                }
+            )
 
-        logger.info(f"Enhanced JSONL processing successful: {file.filename}, "
-                   f"{processing_result['frames_processed']} frames, "
-                   f"{processing_result['fdo_frames_found']} FDO frames, "
-                   f"{frames_decompiled_successfully}/{processing_result['fdo_frames_found']} frames decompiled, "
-                   f"{len(killer_frames)} killer frames, {daemon_restarts} daemon restarts, "
-                   f"{frames_skipped_after_crash} frames skipped, "
-                   f"{len(source_code)} chars, {decompilation_failure_rate:.1f}% failure rate, "
-                   f"{total_duration:.3f}s")
+        capture_format = P3CaptureReader.detect_format(content[:4])
+        logger.info(f"Processing capture upload: {file.filename} ({capture_format}, {len(content)} bytes)")
 
-        if killer_frames:
-            logger.warning(f"🔥 {len(killer_frames)} KILLER FRAMES detected in {file.filename}!")
-            for killer in killer_frames[:3]:  # Log first 3 killer frames
-                logger.warning(f"   Killer Frame {killer['index']}: {killer['token']}/{killer['stream_id']} "
-                             f"({killer['size_bytes']} bytes) - {killer['error']}")
+        # Malformed captures surface as processing_result['error'] (frames are read lazily)
+        with span("extract"):
+            processing_result = await extraction_pool.extract_capture(file.filename, content, port=port)
 
-        return JsonlProcessResponse(
-            success=True,
-            source=source_code,
-            frames_processed=processing_result['frames_processed'],
-            fdo_frames_found=processing_result['fdo_frames_found'],
-            total_fdo_bytes=processing_result['total_fdo_bytes'],
-            chronological_order=processing_result['chronological_order'],
-            supported_tokens=processing_result['supported_tokens'],
-            decompilation_time=f"{decompile_duration:.3f}s",
-            frames_decompiled_successfully=frames_decompiled_successfully,
-            frames_failed_decompilation=frames_failed_decompilation,
-            decompilation_failure_rate=decompilation_failure_rate,
-            killer_frames_count=len(killer_frames),
-            daemon_restarts=daemon_restarts,
-            frames_skipped_after_crash=frames_skipped_after_crash
-        )
+        response = await _decompile_extracted_frames(processing_result, file.filename, start_time)
+        if timings:
+            response.timings = timings_block()
+        return response
 
     except HTTPException:
-        # Re-raise HTTP exceptions (validation errors)
         raise
     except Exception as e:
-        logger.error(f"Unexpected error during JSONL processing: {e}", exc_info=True)
+        logger.error(f"Unexpected error during capture processing: {e}", exc_info=True)
         raise HTTPException(
             status_code=500,
             detail={
                 "success": False,
-                "error": "Internal server error during JSONL processing",
+                "error": "Internal server error during capture processing",
                 "details": {"exception": str(e)}
             }
         )
 
 
+def _accepts_chunk_stream(accept: str) -> bool:
+    """True if the Accept header prefers the compact chunk stream over JSON."""
+    qualities: Dict[str, float] = {}
+    for part in accept.lower().split(","):
+        media_type, _, params = part.strip().partition(";")
+        quality = 1.0
+        for param in params.split(";"):
+            name, _, value = param.strip().partition("=")
+            if name == "q":
+                try:
+                    quality = float(value)
+                except ValueError:
+                    quality = 0.0
+        qualities[media_type.strip()] = quality
+    stream_quality = qualities.get(P3PacketBuffer.MEDIA_TYPE, 0.0)
+    return stream_quality > 0 and stream_quality >= qualities.get("application/json", 0.0)
+
+
 @app.post("/compile-chunk", response_model=CompileChunkResponse)
-async def compile_chunk_fdo(request: CompileChunkRequest):
+async def compile_chunk_fdo(request: CompileChunkRequest, http_request: Request, timings: bool = False):
     """
     Chunk FDO script into P3-ready payload segments.
 
     This endpoint implements AOLBUF.AOL chunking logic for splitting FDO streams
     into properly sized P3 protocol payloads ready for transmission.
 
+    With Accept: application/vnd.atomforge.p3-chunks a successful result is sent
+    as the compact binary chunk stream (see P3PacketBuffer) instead of JSON;
+    failures are still reported as CompileChunkResponse JSON.
+
     Args:
         request: CompileChunkRequest with FDO script, token, stream_id, and options
 
     Returns:
-        CompileChunkResponse with chunked payloads and metadata
+        CompileChunkResponse with chunked payloads and metadata, or the chunk stream
     """
     start_time = time.time()
 
     try:
+        # Per-atom compiles share the pool through the chunking lane
+        _admit_to_pool(LANE_CHUNKING)
+
         # Initialize chunker with daemon client
         chunker = FdoChunker(daemon_client)
 
@@ -1031,33 +1250,55 @@ async def compile_chunk_fdo(request: CompileChunkRequest):
             validate_first=request.validate_first
         )
 
+        if result['success'] and _accepts_chunk_stream(http_request.headers.get("accept", "")):
+            # Compact mode: the packet buffer already holds the framed stream
+            with span("serialize"):
+                stream = result['chunks'].to_stream()
+            stats = result['stats']
+            logger.info(f"FDO chunking successful: {stats['chunk_count']} chunks, "
+                       f"{stats['total_size']} bytes as chunk stream, {time.time() - start_time:.3f}s")
+            return Response(
+                content=stream,
+                media_type=P3PacketBuffer.MEDIA_TYPE,
+                headers={
+                    "X-Chunk-Count": str(stats['chunk_count']),
+                    "X-Total-Size": str(stats['total_size']),
+                    "X-Continuation-Count": str(stats['continuation_count']),
+                    "Vary": "Accept"
+                }
+            )
+
         # Convert binary chunks to base64 for JSON response
-        base64_chunks = []
-        chunk_info_list = []
-
-        if result['success'] and result['chunks']:
-            base64_chunks = [base64.b64encode(chunk).decode('ascii') for chunk in result['chunks']]
-
-            # Build enhanced chunk info with continuation metadata
-            for i, (chunk, info) in enumerate(zip(result['chunks'], result['chunk_info'])):
-                chunk_info_list.append(ChunkInfo(
-                    payload=base64.b64encode(chunk).decode('ascii'),
-                    size=info['size'],
-                    is_continuation=info['is_continuation'],
-                    sequence_index=info['sequence_index']
-                ))
-
-        # Build response
-        response = CompileChunkResponse(
-            success=result['success'],
-            chunks=base64_chunks if result['success'] else None,  # Legacy compatibility
-            chunk_info=chunk_info_list if result['success'] else None,  # Enhanced metadata
-            chunk_count=len(base64_chunks) if result['success'] else 0,
-            total_size=result['stats'].get('total_size', 0) if result['success'] else 0,
-            validation_result=result.get('validation'),
-            stats=result.get('stats'),
-            error=result.get('error')
-        )
+        with span("serialize"):
+            base64_chunks = []
+            chunk_info_list = []
+
+            if result['success'] and result['chunks']:
+                base64_chunks = [base64.b64encode(chunk).decode('ascii') for chunk in result['chunks']]
+
+                # Build enhanced chunk info with continuation metadata
+                for i, (payload, info) in enumerate(zip(base64_chunks, result['chunk_info'])):
+                    chunk_info_list.append(ChunkInfo(
+                        payload=payload,
+                        size=info['size'],
+                        is_continuation=info['is_continuation'],
+                        sequence_index=info['sequence_index']
+                    ))
+
+            # Build response
+            response = CompileChunkResponse(
+                success=result['success'],
+                chunks=base64_chunks if result['success'] else None,  # Legacy compatibility
+                chunk_info=chunk_info_list if result['success'] else None,  # Enhanced metadata
+                chunk_count=len(base64_chunks) if result['success'] else 0,
+                total_size=result['stats'].get('total_size', 0) if result['success'] else 0,
+                validation_result=result.get('validation'),
+                stats=result.get('stats'),
+                error=result.get('error')
+            )
+
+        if timings:
+            response.timings = timings_block()
 
         duration = time.time() - start_time
 
@@ -1069,6 +1310,12 @@ async def compile_chunk_fdo(request: CompileChunkRequest):
 
         return response
 
+    except HTTPException:
+        raise
+
+    except PoolOverloadedError as e:
+        raise _pool_overloaded_exception(e)
+
     except FdoChunkingError as e:
         logger.error(f"Chunking error: {e}")
         return CompileChunkResponse(
@@ -1169,6 +1416,84 @@ async def detect_fdo_in_p3_frame(request: DetectFdoRequest):
         )
 
 
+async def _read_body_limited(request: Request, max_bytes: int) -> bytes:
+    """Read a request body, stopping with FdoBatchTooLargeError as soon as it exceeds max_bytes."""
+    length = request.headers.get('content-length', '')
+    if length.isdigit() and int(length) > max_bytes:
+        raise FdoBatchTooLargeError(f"Body of {length} bytes exceeds {max_bytes} bytes")
+    chunks = []
+    size = 0
+    async for chunk in request.stream():
+        size += len(chunk)
+        if size > max_bytes:
+            raise FdoBatchTooLargeError(f"Body exceeds {max_bytes} bytes")
+        chunks.append(chunk)
+    return b"".join(chunks)
+
+
+@app.post("/detect-fdo/batch")
+async def detect_fdo_batch(request: Request, include_data: bool = False):
+    """
+    Detect FDO data in many P3 frames per request.
+
+    Accepts either a JSON body (DetectFdoBatchRequest) with base64 frames, or an
+    application/octet-stream body of frames each prefixed by a big-endian u32
+    length. quick_fdo_check prefilters every frame; full detection runs only on
+    candidates. Results are compact per-frame entries in input order:
+    {"i", "fdo"} for rejected frames, plus "type", "token", "stream_id",
+    "fdo_size" (and "fdo_data" when requested) for detected ones.
+
+    Args:
+        request: Raw request (JSON or length-prefixed binary)
+        include_data: Include FDO data for binary bodies (JSON bodies use the field)
+
+    Returns:
+        JSON with batch counters and per-frame results
+    """
+    start_time = time.time()
+    content_type = request.headers.get('content-type', '')
+
+    try:
+        # Limits are enforced before any frame is decoded
+        body = await _read_body_limited(request, FdoDetector.MAX_BATCH_BYTES)
+        if content_type.startswith('application/octet-stream'):
+            frames = FdoDetector.split_length_prefixed(body, max_frames=FdoDetector.MAX_BATCH_FRAMES)
+        else:
+            batch = DetectFdoBatchRequest(**json.loads(body))
+            include_data = batch.include_data
+            if len(batch.frames) > FdoDetector.MAX_BATCH_FRAMES:
+                raise FdoBatchTooLargeError(f"Batch has {len(batch.frames)} frames")
+            frames = [base64.b64decode(frame) for frame in batch.frames]
+
+    except FdoBatchTooLargeError as e:
+        raise HTTPException(
+            status_code=413,
+            detail={
+                "success": False,
+                "error": "Batch too large",
+                "details": {
+                    "message": str(e),
+                    "max_frames": FdoDetector.MAX_BATCH_FRAMES,
+                    "max_bytes": FdoDetector.MAX_BATCH_BYTES
+                }
+            }
+        )
+    except (FdoDetectionError, ValueError, TypeError) as e:
+        raise HTTPException(
+            status_code=400,
+            detail={"success": False, "error": "Invalid batch body", "details": {"message": str(e)}}
+        )
+
+    result = FdoDetector.detect_batch(frames, include_data=include_data)
+
+    duration = time.time() - start_time
+    logger.debug(f"Batch FDO detection: {result['frame_count']} frames, {result['candidates']} candidates, "
+                 f"{result['fdo_detected']} detected, duration={duration:.3f}s")
+
+    result['success'] = True
+    return JSONResponse(content=result)
+
+
 @app.get("/examples", response_model=List[ExampleResponse])
 async def get_examples(search: str = None):
     """Get available FDO examples from golden tests, optionally filtered by search query
@@ -1428,6 +1753,15 @@ async def toggle_favorite(script_id: int):
         raise HTTPException(status_code=500, detail=f"Failed to toggle favorite: {str(e)}")
 
 
+@app.get("/metrics")
+async def metrics():
+    """Prometheus text exposition of request, daemon pool and throughput metrics."""
+    if isinstance(pool_manager, PoolBrokerClient):
+        # Pool-level families live in the broker, which also merges every worker's own (labelled by pid)
+        return Response(content=await pool_manager.merged_metrics(), media_type=REGISTRY.CONTENT_TYPE)
+    return Response(content=REGISTRY.render(), media_type=REGISTRY.CONTENT_TYPE)
+
+
 # Pool monitoring UI endpoint
 @app.get("/pool")
 async def get_pool_ui():
@@ -1453,20 +1787,43 @@ def main():
     # Configuration
     host = os.getenv("HOST", "0.0.0.0")
     port = int(os.getenv("PORT", 8000))
+    workers = int(os.getenv("FDO_API_WORKERS", "1"))
+    pool_enabled = os.getenv("FDO_DAEMON_POOL_ENABLED", "false").lower() == "true"
 
     logger.info(f"🚀 Starting AtomForge API Server v2.0 (daemon-only)")
     logger.info(f"   Server: http://{host}:{port}")
     logger.info(f"   Docs:   http://{host}:{port}/docs")
     logger.info(f"   Health: http://{host}:{port}/health")
 
+    broker = None
+    socket_path = os.getenv("FDO_POOL_BROKER_SOCKET", DEFAULT_SOCKET)
+    if pool_enabled and os.getenv("FDO_POOL_SUPERVISOR", "false").lower() == "true":
+        # The pool lives in a persistent supervisor that outlives this process; reattach or start it
+        daemon_exe = discover_daemon_exe()
+        if not daemon_exe:
+            raise RuntimeError("fdo_daemon.exe not found in selected release or backend drop")
+        reattached = ensure_supervisor(socket_path, daemon_exe)
+        logger.info(f"   Pool:    {'reattached to' if reattached else 'started'} supervisor at {socket_path}")
+        os.environ["FDO_POOL_BROKER_SOCKET"] = socket_path
+    elif workers > 1 and pool_enabled:
+        # Workers share one daemon pool owned by a broker process instead of each starting their own
+        logger.info(f"   Workers: {workers} (shared pool broker at {socket_path})")
+        broker = start_broker_process(socket_path)
+        os.environ["FDO_POOL_BROKER_SOCKET"] = socket_path
+
     # Run server
-    uvicorn.run(
-        "api_server:app",
-        host=host,
-        port=port,
-        reload=False,
-        access_log=True
-    )
+    try:
+        uvicorn.run(
+            "api_server:app",
+            host=host,
+            port=port,
+            reload=False,
+            access_log=True,
+            workers=workers
+        )
+    finally:
+        if broker is not None:
+            stop_broker_process(broker)
 
 
 if __name__ == "__main__":
@@ -0,0 +1,173 @@
+#!/usr/bin/env python3
+"""
+Cgroup Resources
+Container CPU and memory limits, default pool sizing and daemon CPU pinning.
+
+Limits come from the cgroup files visible inside the container (v2 first,
+then v1), so a container started with --cpus / --memory sizes its pool to
+what it was actually given rather than to the host.
+"""
+
+import math
+import os
+import logging
+from typing import List, Optional
+
+logger = logging.getLogger(__name__)
+
+# cgroup v1 reports "unlimited" as a page-aligned value near 2^63
+_UNLIMITED_BYTES = 9000000000000000
+
+
+def _read(path: str) -> Optional[str]:
+    try:
+        with open(path) as f:
+            return f.read().strip()
+    except (OSError, ValueError):
+        return None
+
+
+def cpu_quota() -> Optional[float]:
+    """
+    CPU quota of the container in CPUs (e.g. 2.5 for --cpus=2.5).
+
+    Returns:
+        Quota, or None if no quota is set
+    """
+    # cgroup v2: "<quota> <period>" or "max <period>"
+    value = _read("/sys/fs/cgroup/cpu.max")
+    if value:
+        quota, _, period = value.partition(" ")
+        if quota != "max":
+            try:
+                return int(quota) / int(period or 100000)
+            except ValueError:
+                pass
+        return None
+
+    # cgroup v1: quota is -1 when unlimited
+    quota = _read("/sys/fs/cgroup/cpu/cpu.cfs_quota_us") or _read("/sys/fs/cgroup/cpu,cpuacct/cpu.cfs_quota_us")
+    period = _read("/sys/fs/cgroup/cpu/cpu.cfs_period_us") or _read("/sys/fs/cgroup/cpu,cpuacct/cpu.cfs_period_us")
+    try:
+        if quota and period and int(quota) > 0:
+            return int(quota) / int(period)
+    except ValueError:
+        pass
+    return None
+
+
+def memory_limit() -> Optional[int]:
+    """
+    Container memory limit in bytes.
+
+    Returns:
+        Limit, or None if not in a container or no limit is set
+    """
+    for path in ("/sys/fs/cgroup/memory.max",  # cgroup v2 ("max" when unlimited)
+                 "/sys/fs/cgroup/memory/memory.limit_in_bytes"):  # cgroup v1
+        value = _read(path)
+        try:
+            limit = int(value) if value else None
+        except ValueError:
+            continue
+        if limit and limit < _UNLIMITED_BYTES:
+            return limit
+    return None
+
+
+def allowed_cpus() -> List[int]:
+    """CPUs this process may run on, limited to the cgroup quota (rounded up)."""
+    try:
+        cpus = sorted(os.sched_getaffinity(0))
+    except (AttributeError, OSError):
+        cpus = list(range(os.cpu_count() or 1))
+    quota = cpu_quota()
+    if quota:
+        cpus = cpus[:max(1, math.ceil(quota))]
+    return cpus
+
+
+def default_pool_size(daemon_rss_bytes: Optional[int], reserved_cpus: int = 1, memory_fraction: float = 0.8,
+                      max_size: int = 100) -> int:
+    """
+    Pool size that fits the container.
+
+    One daemon per CPU left after the API's reserved CPUs (Ada32 is
+    single-threaded), further limited so that the daemons' measured RSS stays
+    within memory_fraction of the memory limit after the API's own usage.
+
+    Args:
+        daemon_rss_bytes: Measured RSS of one daemon's process tree (None: CPU bound only)
+        reserved_cpus: CPUs kept for the API process
+        memory_fraction: Share of the memory limit daemons may use
+        max_size: Upper bound (FDO_DAEMON_POOL_MAX_SIZE)
+
+    Returns:
+        Pool size, at least 1
+    """
+    quota = cpu_quota()
+    cpus = quota if quota else len(allowed_cpus())
+    size = max(1, int(cpus) - reserved_cpus)
+
+    limit = memory_limit()
+    if limit and daemon_rss_bytes:
+        api_rss = _process_rss(os.getpid())
+        budget = limit * memory_fraction - api_rss
+        size = min(size, max(1, int(budget // daemon_rss_bytes)))
+
+    return min(size, max_size)
+
+
+def core_sets(count: int, reserved_cpus: int = 1) -> List[List[int]]:
+    """
+    Split the allowed CPUs (after the API's reserved ones) into one core set per daemon.
+
+    With more CPUs than daemons each daemon gets a disjoint group of cores;
+    with fewer, daemons share single cores round-robin.
+
+    Args:
+        count: Number of daemons
+        reserved_cpus: Leading allowed CPUs left to the API process
+
+    Returns:
+        List of CPU lists, one per daemon index
+    """
+    cpus = allowed_cpus()
+    available = cpus[reserved_cpus:] if len(cpus) > reserved_cpus else cpus
+    if count <= 0:
+        return []
+    if count >= len(available):
+        return [[available[i % len(available)]] for i in range(count)]
+
+    bounds = [i * len(available) // count for i in range(count + 1)]
+    return [available[bounds[i]:bounds[i + 1]] for i in range(count)]
+
+
+def pin_pids(pids: List[int], cpus: List[int]) -> int:
+    """
+    Restrict processes (every thread of each) to a CPU set.
+
+    Returns:
+        Number of threads pinned
+    """
+    pinned = 0
+    for pid in pids:
+        try:
+            tids = [int(tid) for tid in os.listdir(f"/proc/{pid}/task")]
+        except OSError:
+            tids = [pid]
+        for tid in tids:
+            try:
+                os.sched_setaffinity(tid, cpus)
+                pinned += 1
+            except OSError as e:
+                logger.debug(f"Could not pin {pid}/{tid} to {cpus}: {e}")
+    return pinned
+
+
+def _process_rss(pid: int) -> int:
+    value = _read(f"/proc/{pid}/statm")
+    try:
+        return int(value.split()[1]) * os.sysconf("SC_PAGE_SIZE") if value else 0
+    except (ValueError, IndexError):
+        return 0
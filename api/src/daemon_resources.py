@@ -0,0 +1,232 @@
+#!/usr/bin/env python3
+"""
+Daemon Resources
+Per-daemon RSS, CPU time and context switches sampled from /proc.
+
+Each FdoDaemonManager knows the PID it spawned; the rest of its process tree
+(Wine loader children) is followed through /proc/<pid>/task/<tid>/children.
+A background collector samples every tracked process at a fixed interval and
+keeps the latest snapshot, so /health/pool/memory and /metrics serve cached
+numbers instead of scanning every process on the host per call.
+
+Shared Wine infrastructure (wineserver, services.exe, ...) belongs to no
+daemon's tree. It is found with one /proc scan per interval and reported as
+a pool-wide total.
+"""
+
+import os
+import time
+import threading
+import logging
+from dataclasses import dataclass
+from typing import Any, Dict, List, Optional, TYPE_CHECKING
+
+if TYPE_CHECKING:
+    from fdo_daemon_pool_manager import FdoDaemonPoolManager
+
+logger = logging.getLogger(__name__)
+
+CLOCK_TICKS = os.sysconf("SC_CLK_TCK")
+PAGE_SIZE = os.sysconf("SC_PAGE_SIZE")
+
+# Wine processes shared by every daemon in the prefix (matched on /proc/<pid>/comm)
+WINE_INFRA_NAMES = {
+    "wineserver", "services.exe", "winedevice.exe", "explorer.exe",
+    "plugplay.exe", "svchost.exe", "rpcss.exe"
+}
+
+
+@dataclass
+class ProcessSample:
+    """One process's counters at a point in time."""
+    pid: int
+    name: str
+    rss_bytes: int
+    cpu_seconds: float               # User + system time
+    voluntary_switches: int          # Blocked (I/O, locks, sleeps)
+    involuntary_switches: int        # Preempted by the scheduler
+
+
+def read_process(pid: int) -> Optional[ProcessSample]:
+    """
+    Sample a process from /proc/<pid>/stat and /proc/<pid>/status.
+
+    Returns:
+        ProcessSample, or None if the process has exited or is unreadable
+    """
+    try:
+        with open(f"/proc/{pid}/stat") as f:
+            stat = f.read()
+        # comm may contain spaces and parentheses; fields resume after the last ')'
+        name = stat[stat.index("(") + 1:stat.rindex(")")]
+        fields = stat[stat.rindex(")") + 2:].split()
+        cpu_seconds = (int(fields[11]) + int(fields[12])) / CLOCK_TICKS  # utime + stime
+        rss_bytes = int(fields[21]) * PAGE_SIZE
+
+        voluntary = involuntary = 0
+        with open(f"/proc/{pid}/status") as f:
+            for line in f:
+                if line.startswith("voluntary_ctxt_switches:"):
+                    voluntary = int(line.split()[1])
+                elif line.startswith("nonvoluntary_ctxt_switches:"):
+                    involuntary = int(line.split()[1])
+    except (OSError, ValueError, IndexError):
+        return None
+
+    return ProcessSample(pid, name, rss_bytes, cpu_seconds, voluntary, involuntary)
+
+
+def child_pids(pid: int) -> List[int]:
+    """Direct children of a process, across all of its threads."""
+    children = []
+    try:
+        for tid in os.listdir(f"/proc/{pid}/task"):
+            try:
+                with open(f"/proc/{pid}/task/{tid}/children") as f:
+                    children.extend(int(child) for child in f.read().split())
+            except (OSError, ValueError):
+                continue
+    except OSError:
+        pass
+    return children
+
+
+def process_tree(root: int) -> List[int]:
+    """PIDs of a process and all of its descendants, root first."""
+    pids = []
+    pending = [root]
+    seen = set()
+    while pending:
+        pid = pending.pop()
+        if pid in seen:
+            continue
+        seen.add(pid)
+        pids.append(pid)
+        pending.extend(child_pids(pid))
+    return pids
+
+
+def wine_infra_samples(exclude: set) -> List[ProcessSample]:
+    """Shared Wine processes outside every daemon tree (one /proc scan)."""
+    samples = []
+    for entry in os.listdir("/proc"):
+        if not entry.isdigit():
+            continue
+        pid = int(entry)
+        if pid in exclude:
+            continue
+        try:
+            with open(f"/proc/{pid}/comm") as f:
+                name = f.read().strip()
+        except OSError:
+            continue
+        if name in WINE_INFRA_NAMES or name.startswith("wine"):
+            sample = read_process(pid)
+            if sample:
+                samples.append(sample)
+    return samples
+
+
+class DaemonResourceCollector:
+    """Background sampler of per-daemon process trees for one pool."""
+
+    def __init__(self, pool_manager: "FdoDaemonPoolManager", interval: float = 5.0):
+        """
+        Args:
+            pool_manager: Pool whose daemons are sampled
+            interval: Seconds between samples
+        """
+        self.pool_manager = pool_manager
+        self.interval = interval
+
+        self._lock = threading.Lock()
+        self._snapshot: Dict[str, Any] = {"sampled_at": None, "daemons": {}, "wine_infra_rss_bytes": 0, "wine_infra_processes": 0}
+        self._previous_cpu: Dict[int, float] = {}  # Root pid -> tree CPU seconds at the last sample
+        self._thread: Optional[threading.Thread] = None
+        self._stop = threading.Event()
+
+    def start(self) -> None:
+        """Take a first sample and start the collector thread."""
+        self.collect()
+        self._stop.clear()
+        self._thread = threading.Thread(target=self._loop, name="PoolResourceCollector", daemon=True)
+        self._thread.start()
+
+    def stop(self) -> None:
+        self._stop.set()
+        if self._thread:
+            self._thread.join(timeout=2.0)
+
+    def snapshot(self) -> Dict[str, Any]:
+        """Latest sample (see collect)."""
+        with self._lock:
+            return self._snapshot
+
+    def collect(self) -> Dict[str, Any]:
+        """
+        Sample every pool daemon's process tree and the shared Wine processes.
+
+        Also updates each DaemonInstance.rss_bytes, which drives RSS-based
+        recycling.
+
+        Returns:
+            {"sampled_at", "daemons": {id: {...}}, "wine_infra_rss_bytes", "wine_infra_processes"}
+        """
+        now = time.time()
+        elapsed = now - self._snapshot["sampled_at"] if self._snapshot["sampled_at"] else None
+        daemons = {}
+        tracked = set()
+        cpu_seen = {}
+
+        for instance in list(self.pool_manager.instances):
+            manager = instance.manager
+            root = manager.pid if manager else None
+            if root is None:
+                instance.rss_bytes = None
+                continue
+
+            pids = process_tree(root)
+            tracked.update(pids)
+            samples = [s for s in (read_process(pid) for pid in pids) if s]
+            if not samples:
+                instance.rss_bytes = None
+                continue
+
+            root_sample = samples[0] if samples[0].pid == root else None
+            rss = sum(s.rss_bytes for s in samples)
+            cpu = sum(s.cpu_seconds for s in samples)
+            previous = self._previous_cpu.get(root)
+            cpu_seen[root] = cpu
+            instance.rss_bytes = rss
+
+            daemons[instance.id] = {
+                "port": instance.port,
+                "pids": [s.pid for s in samples],
+                "rss_bytes": rss,
+                "daemon_rss_bytes": root_sample.rss_bytes if root_sample else 0,
+                "children_rss_bytes": rss - (root_sample.rss_bytes if root_sample else 0),
+                "cpu_seconds": round(cpu, 3),
+                "cpu_percent": (round(max(0.0, cpu - previous) / elapsed * 100, 1)
+                                if previous is not None and elapsed else None),
+                "voluntary_ctxt_switches": sum(s.voluntary_switches for s in samples),
+                "involuntary_ctxt_switches": sum(s.involuntary_switches for s in samples)
+            }
+
+        infra = wine_infra_samples(tracked)
+        snapshot = {
+            "sampled_at": now,
+            "daemons": daemons,
+            "wine_infra_rss_bytes": sum(s.rss_bytes for s in infra),
+            "wine_infra_processes": len(infra)
+        }
+        with self._lock:
+            self._snapshot = snapshot
+            self._previous_cpu = cpu_seen
+        return snapshot
+
+    def _loop(self) -> None:
+        while not self._stop.wait(self.interval):
+            try:
+                self.collect()
+            except Exception as e:
+                logger.error(f"Daemon resource collection failed: {e}", exc_info=True)
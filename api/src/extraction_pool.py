@@ -0,0 +1,292 @@
+#!/usr/bin/env python3
+"""
+Extraction Pool
+Runs CPU-bound frame extraction for /decompile-jsonl and /decompile-capture
+in worker processes, so parsing a large upload does not block the event loop
+(and with it /health, /compile and every other request).
+
+Workers report progress every JsonlProcessor.PROGRESS_LOG_INTERVAL frames
+over a shared queue. A reader thread hands each report to the event loop,
+which updates the job shown under /health/extraction. Uncompressed uploads
+smaller than FDO_EXTRACTION_INLINE_BYTES are still parsed inline, where a
+worker round trip would cost more than it saves.
+
+JSONL uploads may be gzip or zstd compressed (.jsonl.gz, .jsonl.zst); they are
+decompressed line by line as the parser reads them, never held in full. Their
+compressed size says nothing about the work inside, so they always go to a
+worker, and decompression stops at FDO_EXTRACTION_MAX_DECOMPRESSED_MB.
+"""
+
+import asyncio
+import gzip
+import io
+import itertools
+import logging
+import multiprocessing
+import os
+import threading
+import time
+from concurrent.futures import ProcessPoolExecutor
+from concurrent.futures.process import BrokenProcessPool
+from dataclasses import dataclass, field
+from typing import Any, Callable, Dict, Optional
+
+from jsonl_processor import JsonlProcessor, DecompressedSizeError
+from metrics import EXTRACTION_JOBS
+from p3_capture_reader import P3CaptureReader
+
+try:
+    import zstandard
+except ImportError:  # .jsonl.zst uploads are rejected without it
+    zstandard = None
+
+logger = logging.getLogger(__name__)
+
+# Upload suffixes accepted for JSONL captures and the compression each implies
+JSONL_SUFFIXES = {".jsonl.gz": "gzip", ".jsonl.zst": "zstd", ".jsonl": None}
+
+# Set in each worker process by _init_worker
+_progress_queue = None
+
+
+def _init_worker(progress_queue) -> None:
+    global _progress_queue
+    _progress_queue = progress_queue
+
+
+def _reporter(job_id: int) -> Callable[[int], None]:
+    return lambda frames: _progress_queue.put((job_id, frames))
+
+
+def jsonl_compression(filename: str) -> Optional[str]:
+    """
+    Compression of a JSONL upload from its file name.
+
+    Raises:
+        ValueError: If the name has no JSONL suffix, or names zstd without the zstandard package
+    """
+    name = filename.lower()
+    for suffix, compression in JSONL_SUFFIXES.items():
+        if name.endswith(suffix):
+            if compression == "zstd" and zstandard is None:
+                raise ValueError("zstd-compressed uploads need the zstandard package")
+            return compression
+    raise ValueError(f"File must have one of the extensions {', '.join(sorted(JSONL_SUFFIXES))}")
+
+
+class _SizeLimitedReader(io.RawIOBase):
+    """Decompressing stream that raises DecompressedSizeError once it has produced more than limit bytes."""
+
+    def __init__(self, raw, limit: int):
+        self.raw = raw
+        self.limit = limit
+        self.total = 0
+
+    def readable(self) -> bool:
+        return True
+
+    def readinto(self, buffer) -> int:
+        count = self.raw.readinto(buffer)
+        self.total += count
+        if self.total > self.limit:
+            raise DecompressedSizeError(f"Decompressed upload exceeds {self.limit // (1024 * 1024)} MB")
+        return count
+
+    def close(self) -> None:
+        self.raw.close()
+        super().close()
+
+
+def _open_compressed(content: bytes, compression: str, max_bytes: int = 0) -> io.TextIOWrapper:
+    if compression == "zstd":
+        raw = zstandard.ZstdDecompressor().stream_reader(io.BytesIO(content), read_across_frames=True)
+    else:
+        raw = gzip.GzipFile(fileobj=io.BytesIO(content))
+    if max_bytes:
+        raw = io.BufferedReader(_SizeLimitedReader(raw, max_bytes))
+    return io.TextIOWrapper(raw, encoding="utf-8")
+
+
+def _jsonl_lines(content: bytes, compression: Optional[str] = None, max_bytes: int = 0) -> Callable:
+    """
+    Line iterator factory over a UTF-8 JSONL upload.
+
+    Plain uploads are decoded up front (raises UnicodeDecodeError); compressed
+    ones are decompressed and decoded as they are read, so an invalid stream
+    ends processing with an error in the result. A compressed stream that
+    expands past max_bytes (0: unlimited) raises DecompressedSizeError.
+    """
+    if compression is not None:
+        def create_compressed_line_iterator():
+            with _open_compressed(content, compression, max_bytes) as text:
+                for line in text:
+                    if line.strip():  # Skip empty lines
+                        yield line
+
+        return create_compressed_line_iterator
+
+    text = content.decode("utf-8")
+
+    def create_line_iterator():
+        for line in text.splitlines():
+            if line.strip():  # Skip empty lines
+                yield line
+
+    return create_line_iterator
+
+
+def extract_jsonl(content: bytes, compression: Optional[str] = None,
+                  progress: Optional[Callable[[int], None]] = None, max_bytes: int = 0) -> Dict[str, Any]:
+    return JsonlProcessor.stream_process_file(_jsonl_lines(content, compression, max_bytes), progress=progress)
+
+
+def extract_capture(content: bytes, port: Optional[int] = None,
+                    progress: Optional[Callable[[int], None]] = None) -> Dict[str, Any]:
+    # Malformed captures surface as result['error'] (frames are read lazily)
+    frames = P3CaptureReader.read_frames(io.BytesIO(content), port=port, validate_crc=JsonlProcessor.VALIDATE_CRC)
+    return JsonlProcessor.stream_process_frames(frames, progress=progress)
+
+
+def _run_jsonl(job_id: int, content: bytes, compression: Optional[str], max_bytes: int) -> Dict[str, Any]:
+    return extract_jsonl(content, compression, _reporter(job_id), max_bytes)
+
+
+def _run_capture(job_id: int, content: bytes, port: Optional[int]) -> Dict[str, Any]:
+    return extract_capture(content, port, _reporter(job_id))
+
+
+@dataclass
+class ExtractionJob:
+    """An extraction running (or queued) in a worker process."""
+    id: int
+    kind: str
+    name: str
+    size_bytes: int
+    started_at: float = field(default_factory=time.time)
+    frames_processed: int = 0
+
+
+class ExtractionPool:
+    """Process pool for JSONL and capture frame extraction with progress reporting."""
+
+    def __init__(self, workers: int = 2, inline_bytes: int = 65536, max_decompressed_mb: float = 1024):
+        """
+        Args:
+            workers: Worker processes (0 parses every upload inline on the event loop)
+            inline_bytes: Uncompressed uploads below this size are parsed inline
+            max_decompressed_mb: Reject compressed uploads that expand beyond this many MiB (0 disables)
+        """
+        self.workers = workers
+        self.inline_bytes = inline_bytes
+        self.max_decompressed_bytes = int(max_decompressed_mb * 1024 * 1024)
+        self.jobs: Dict[int, ExtractionJob] = {}
+        self._job_ids = itertools.count(1)
+        self._executor: Optional[ProcessPoolExecutor] = None
+        self._progress_queue = None
+        self._reader: Optional[threading.Thread] = None
+        self._loop: Optional[asyncio.AbstractEventLoop] = None
+
+        EXTRACTION_JOBS.set_function(lambda: [((), len(self.jobs))])
+
+    @classmethod
+    def from_env(cls) -> "ExtractionPool":
+        return cls(
+            workers=int(os.getenv("FDO_EXTRACTION_WORKERS", str(min(4, os.cpu_count() or 1)))),
+            inline_bytes=int(os.getenv("FDO_EXTRACTION_INLINE_BYTES", "65536")),
+            max_decompressed_mb=float(os.getenv("FDO_EXTRACTION_MAX_DECOMPRESSED_MB", "1024"))
+        )
+
+    async def extract_jsonl(self, name: str, content: bytes, compression: Optional[str] = None) -> Dict[str, Any]:
+        """
+        Extract FDO frames from a JSONL upload (see JsonlProcessor.stream_process_file).
+
+        Args:
+            compression: "gzip", "zstd" or None (see jsonl_compression)
+
+        Raises:
+            UnicodeDecodeError: If an uncompressed upload is not UTF-8
+            DecompressedSizeError: If a compressed upload expands beyond max_decompressed_bytes
+        """
+        # A small compressed upload can still expand to a large capture: only plain ones are sized up front
+        if self.workers <= 0 or (compression is None and len(content) < self.inline_bytes):
+            return extract_jsonl(content, compression, max_bytes=self.max_decompressed_bytes)
+        return await self._submit("jsonl", name, content, _run_jsonl, compression, self.max_decompressed_bytes)
+
+    async def extract_capture(self, name: str, content: bytes, port: Optional[int] = None) -> Dict[str, Any]:
+        """Extract FDO frames from a raw P3 stream or pcap/pcapng upload (see JsonlProcessor.stream_process_frames)."""
+        if self.workers <= 0 or len(content) < self.inline_bytes:
+            return extract_capture(content, port)
+        return await self._submit("capture", name, content, _run_capture, port)
+
+    def get_status(self) -> Dict[str, Any]:
+        now = time.time()
+        return {
+            "workers": self.workers,
+            "inline_bytes": self.inline_bytes,
+            "max_decompressed_bytes": self.max_decompressed_bytes or None,
+            "active_jobs": [
+                {
+                    "id": job.id,
+                    "kind": job.kind,
+                    "name": job.name,
+                    "size_bytes": job.size_bytes,
+                    "frames_processed": job.frames_processed,
+                    "elapsed_s": round(now - job.started_at, 3)
+                }
+                for job in list(self.jobs.values())
+            ]
+        }
+
+    def shutdown(self) -> None:
+        if self._executor is not None:
+            self._executor.shutdown(wait=False, cancel_futures=True)
+            self._executor = None
+        if self._progress_queue is not None:
+            self._progress_queue.put(None)  # Stops the reader thread
+            self._progress_queue = None
+
+    async def _submit(self, kind: str, name: str, content: bytes, fn: Callable, *args) -> Dict[str, Any]:
+        executor = self._ensure_started()
+        job = ExtractionJob(next(self._job_ids), kind, name, len(content))
+        self.jobs[job.id] = job
+        logger.info(f"Extraction job {job.id}: {kind} {name} ({len(content)} bytes) sent to a worker process")
+        try:
+            return await asyncio.wrap_future(executor.submit(fn, job.id, content, *args))
+        except BrokenProcessPool:
+            # A worker died (e.g. OOM-killed); start a fresh pool for the next job
+            logger.error(f"Extraction worker died during job {job.id}, restarting the extraction pool")
+            if self._executor is executor:
+                self._executor = None
+                executor.shutdown(wait=False, cancel_futures=True)
+            raise
+        finally:
+            del self.jobs[job.id]
+
+    def _ensure_started(self) -> ProcessPoolExecutor:
+        if self._executor is None:
+            # spawn, not fork: the API process runs threads (health monitor, resource sampler)
+            context = multiprocessing.get_context("spawn")
+            if self._progress_queue is None:
+                self._progress_queue = context.Queue()
+                self._loop = asyncio.get_running_loop()
+                self._reader = threading.Thread(
+                    target=self._read_progress, args=(self._progress_queue,), daemon=True, name="extraction-progress"
+                )
+                self._reader.start()
+            self._executor = ProcessPoolExecutor(
+                max_workers=self.workers, mp_context=context,
+                initializer=_init_worker, initargs=(self._progress_queue,)
+            )
+        return self._executor
+
+    def _read_progress(self, queue) -> None:
+        while True:
+            report = queue.get()
+            if report is None:
+                return
+            self._loop.call_soon_threadsafe(self._record_progress, *report)
+
+    def _record_progress(self, job_id: int, frames: int) -> None:
+        job = self.jobs.get(job_id)
+        if job is not None:
+            job.frames_processed = frames
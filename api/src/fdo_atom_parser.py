@@ -54,6 +54,11 @@ class FdoAtomParser:
     # Maximum hex data length for raw_data (112 bytes = 224 hex chars, max for AT token NON-FDO frames)
     MAX_RAW_DATA_HEX_LENGTH = 224
 
+    # Data atoms whose payload may be split across several atoms of the same type
+    # (appends concatenate). With exact splitting the chunker splits these on
+    # their compiled bytes instead of the fixed limits above.
+    SPLITTABLE_DATA_ATOMS = ('man_append_data', 'idb_append_data', 'dod_data')
+
     @classmethod
     def preprocess_script(cls, fdo_script: str) -> str:
         """
@@ -537,13 +542,36 @@ class FdoAtomParser:
         return True
 
     @classmethod
-    def parse_preserving_actions(cls, fdo_script: str) -> List[Dict[str, Any]]:
+    def _data_atom_kind(cls, line: str) -> str:
+        """
+        Classify a splittable data atom line.
+
+        Returns:
+            'text' for man_append_data <"text">, 'binary' for the hex forms, '' otherwise
+        """
+        line_clean = line.strip()
+        if not line_clean.startswith(cls.SPLITTABLE_DATA_ATOMS):
+            return ""
+        if cls._extract_text_from_append_data(line_clean):
+            return 'text'
+        if (cls._extract_hex_from_man_append_data(line_clean) or
+                cls._extract_hex_from_idb_append_data(line_clean) or
+                cls._extract_hex_pairs_from_idb_append_data(line_clean) or
+                cls._extract_hex_from_dod_data(line_clean) or
+                cls._extract_hex_pairs_from_dod_data(line_clean)):
+            return 'binary'
+        return ""
+
+    @classmethod
+    def parse_preserving_actions(cls, fdo_script: str, exact_split: bool = False) -> List[Dict[str, Any]]:
         """
         Parse FDO script preserving action blocks as atomic units.
         Automatically splits long man_append_data and idb_append_data blocks to prevent P3 segmentation issues.
 
         Args:
             fdo_script: FDO script text with atoms/action blocks
+            exact_split: Leave top-level data atoms whole and mark them for the
+                chunker to split on compiled bytes (action blocks are still preprocessed)
 
         Returns:
             List of atom units with metadata:
@@ -554,9 +582,11 @@ class FdoAtomParser:
                 'line_start': int,   # Starting line number (0-indexed)
                 'line_end': int      # Ending line number (0-indexed)
             }
+            With exact_split, data atom units also carry 'data_atom' ('text' or
+            'binary') and 'split_lines' (the fixed-limit split, as a fallback).
         """
         # Preprocess script to split long man_append_data blocks
-        preprocessed_script = cls.preprocess_script(fdo_script)
+        preprocessed_script = fdo_script if exact_split else cls.preprocess_script(fdo_script)
 
         atom_units = []
         lines = preprocessed_script.strip().split('\n')
@@ -574,6 +604,11 @@ class FdoAtomParser:
             if cls._is_action_atom(line):
                 block_result = cls._parse_action_block(lines, i)
                 if block_result:
+                    if exact_split:
+                        # Nested streams are compiled as one unit; split their data atoms up front
+                        block_result['content'] = '\n'.join(
+                            l.strip() for l in cls.preprocess_script(block_result['content']).split('\n')
+                        )
                     atom_units.append(block_result)
                     i = block_result['line_end'] + 1
                 else:
@@ -591,14 +626,19 @@ class FdoAtomParser:
                 is_raw_data = cls._is_raw_data(line)
 
                 # Regular single atom (including raw_data)
-                atom_units.append({
+                unit = {
                     'content': line,
                     'is_action': False,
                     'is_raw_data': is_raw_data,
                     'type': 'raw_data_atom' if is_raw_data else 'single_atom',
                     'line_start': i,
                     'line_end': i
-                })
+                }
+                data_atom = cls._data_atom_kind(line) if exact_split else ""
+                if data_atom:
+                    unit['data_atom'] = data_atom
+                    unit['split_lines'] = cls.preprocess_script(line).split('\n')
+                atom_units.append(unit)
                 i += 1
 
         logger.info(f"Parsed {len(atom_units)} atom units ({sum(1 for u in atom_units if u['is_action'])} action blocks)")
@@ -6,13 +6,16 @@ Based on reverse engineering of the actual AOLBUF.AOL module
 """
 
 import asyncio
-from typing import List, Dict, Any, Tuple
+import time
+from typing import List, Dict, Any, Optional, Tuple
 import logging
 import re
 
 from fdo_daemon_client import FdoDaemonClient, FdoDaemonError
 from fdo_atom_parser import FdoAtomParser
-from p3_payload_builder import P3PayloadBuilder
+from p3_payload_builder import P3PayloadBuilder, P3PacketBuffer
+from request_timing import span, add_phase
+from pool_scheduler import PoolOverloadedError
 
 logger = logging.getLogger(__name__)
 
@@ -26,7 +29,10 @@ class FdoChunker:
     Leverages AtomForge's FDO daemon for high-performance per-atom compilation.
     """
 
-    def __init__(self, daemon_client, enable_parallel: bool = None):
+    # Smallest data piece worth an extra atom header when filling a packet's remaining space
+    MIN_SPLIT_DATA_BYTES = 8
+
+    def __init__(self, daemon_client, enable_parallel: bool = None, exact_split: bool = None):
         """
         Initialize chunker with FDO daemon client.
 
@@ -34,6 +40,8 @@ class FdoChunker:
             daemon_client: Client for communicating with FDO compilation daemon
                           (FdoDaemonClient or FdoDaemonPoolClient)
             enable_parallel: Enable parallel atom compilation (default: from env var or True)
+            exact_split: Split data atoms on their compiled bytes to fill packets
+                        (default: FDO_CHUNKER_EXACT_SPLIT or True)
         """
         self.daemon_client = daemon_client
         self.parser = FdoAtomParser()
@@ -45,7 +53,15 @@ class FdoChunker:
             enable_parallel = os.getenv('FDO_CHUNKER_PARALLEL_ENABLED', 'true').lower() == 'true'
 
         self.enable_parallel = enable_parallel
-        logger.info(f"FDO Chunker initialized: parallel_compilation={'enabled' if self.enable_parallel else 'disabled'}")
+
+        # Configure byte-exact data atom splitting (default: enabled)
+        if exact_split is None:
+            import os
+            exact_split = os.getenv('FDO_CHUNKER_EXACT_SPLIT', 'true').lower() == 'true'
+
+        self.exact_split = exact_split
+        logger.info(f"FDO Chunker initialized: parallel_compilation={'enabled' if self.enable_parallel else 'disabled'}, "
+                    f"exact_split={'enabled' if self.exact_split else 'disabled'}")
 
     async def process_fdo_script(self, fdo_script: str, stream_id: int = 0, token: str = 'AT') -> Dict[str, Any]:
         """
@@ -58,7 +74,7 @@ class FdoChunker:
 
         Returns:
             Dict containing:
-            - 'chunks': List of P3 payload bytes
+            - 'chunks': P3PacketBuffer holding the P3 payloads (indexes/iterates as bytes)
             - 'chunk_info': List of dicts with continuation metadata
             These are ready for P3 to wrap with header/CRC
 
@@ -72,7 +88,8 @@ class FdoChunker:
 
         # Parse FDO preserving action blocks as atomic units
         try:
-            atom_units = self.parser.parse_preserving_actions(fdo_script)
+            with span("parse"):
+                atom_units = self.parser.parse_preserving_actions(fdo_script, exact_split=self.exact_split)
         except Exception as e:
             raise FdoChunkingError(f"Failed to parse FDO script: {e}")
 
@@ -80,11 +97,6 @@ class FdoChunker:
             logger.warning("No atom units found in FDO script")
             return []
 
-        # Initialize packet assembly
-        current_packet_data = bytearray()
-        packets = []
-        chunk_info = []  # Track continuation metadata
-
         # Header size is constant for all packets with same token
         header_size = self.payload_builder.get_header_size(token)
         max_payload_per_packet = P3PayloadBuilder.MAX_OUTBOUND_SIZE - header_size
@@ -113,7 +125,8 @@ class FdoChunker:
             # Compile all units in parallel
             if units_to_compile:
                 try:
-                    compiled_list = await self._compile_units_parallel(units_to_compile)
+                    with span("compile"):
+                        compiled_list = await self._compile_units_parallel(units_to_compile)
 
                     # Map results back to unit indices
                     for idx, compiled_data in zip(compile_indices, compiled_list):
@@ -127,36 +140,27 @@ class FdoChunker:
                     compiled_results = {}
 
         # PHASE 2: Process each atom unit (using pre-compiled results or compiling sequentially)
+        assemble_start = time.perf_counter()
+        # Packets are assembled in place in one buffer, sized for the compiled data
+        # plus roughly one packet header per max_payload_per_packet bytes
+        compiled_size = sum(len(data) for data in compiled_results.values())
+        packets = P3PacketBuffer(
+            stream_id, token,
+            capacity=4096 + compiled_size + compiled_size // max_payload_per_packet * (header_size + 8)
+        )
+        sequential_compile_time = 0.0
         for i, unit in enumerate(atom_units):
             try:
                 # Check if this is a raw_data atom (needs multi-frame splitting)
                 if unit.get('is_raw_data'):
                     # Flush any pending data before adding raw_data packets
-                    if current_packet_data:
-                        packet = self.payload_builder.build_packet(
-                            bytes(current_packet_data), stream_id, token
-                        )
-                        packets.append(packet)
-                        chunk_info.append({
-                            'size': len(packet),
-                            'is_continuation': in_segmented_sequence,
-                            'sequence_index': len(packets) - 1
-                        })
-                        logger.debug(f"Flushed packet {len(packets)} before raw_data: {len(packet)} bytes")
-                        current_packet_data = bytearray()
+                    if packets.pending_size:
+                        size = packets.end(in_segmented_sequence)
+                        logger.debug(f"Flushed packet {len(packets)} before raw_data: {size} bytes")
 
                     # raw_data atoms split into multiple independent frames
-                    # Each frame gets 000576 prefix
-                    raw_data_packets = self._compile_raw_data_to_chunks(unit, stream_id, token)
-
-                    # Add all packets (each is already complete with headers)
-                    for packet in raw_data_packets:
-                        packets.append(packet)
-                        chunk_info.append({
-                            'size': len(packet),
-                            'is_continuation': False,  # Independent frames
-                            'sequence_index': len(packets) - 1
-                        })
+                    # Each frame gets 000576 prefix (not continuations)
+                    self._compile_raw_data_to_chunks(unit, packets, token)
 
                     # Skip normal processing for this unit
                     continue
@@ -168,99 +172,180 @@ class FdoChunker:
                     logger.debug(f"Using pre-compiled result for unit {i}")
                 else:
                     # Sequential compilation (fallback or parallel disabled)
+                    compile_start = time.perf_counter()
                     compiled_data = await self._compile_unit(unit)
-
-                # Check if this atom is too large to ever fit (warn but continue)
-                if unit['is_action'] and len(compiled_data) > P3PayloadBuilder.MAX_SEGMENT_SIZE:
-                    logger.warning(
-                        f"Action block at line {unit['line_start']} exceeds {P3PayloadBuilder.MAX_SEGMENT_SIZE} "
-                        f"bytes ({len(compiled_data)} bytes): {unit['content'][:50]}..."
-                    )
-
-                # Segment if needed (with continuation markers)
-                segments = self.payload_builder.segment_data_if_needed(compiled_data)
-                logger.debug(f"Unit {i}: {len(compiled_data)} bytes -> {len(segments)} segments")
-
-                # Handle segments based on whether they have continuation markers
-                if len(segments) > 1:
-                    # Unit was segmented - each segment must become its own packet
-                    # First flush any existing packet data
-                    if current_packet_data:
-                        packet = self.payload_builder.build_packet(
-                            bytes(current_packet_data), stream_id, token
+                    sequential_compile_time += time.perf_counter() - compile_start
+
+                compiled_atoms = [compiled_data]
+                if unit.get('data_atom'):
+                    layout = self._data_atom_layout(compiled_data)
+                    if layout is not None:
+                        # Split on the compiled bytes, filling the current packet
+                        pieces = self._pack_data_atom(packets, *layout, unit['data_atom'] == 'text',
+                                                      in_segmented_sequence, max_payload_per_packet)
+                        logger.debug(f"Unit {i}: {len(compiled_data)} bytes -> {pieces} data atoms")
+                        continue
+                    if len(unit['split_lines']) > 1:
+                        # Not a plain header + payload atom; fall back to the fixed-limit split
+                        logger.warning(f"Unexpected compiled layout for data atom at line {unit['line_start']}, "
+                                       f"using fixed-limit split")
+                        compile_start = time.perf_counter()
+                        compiled_atoms = [
+                            await self._compile_unit({**unit, 'content': line}) for line in unit['split_lines']
+                        ]
+                        sequential_compile_time += time.perf_counter() - compile_start
+
+                for compiled_data in compiled_atoms:
+                    # Check if this atom is too large to ever fit (warn but continue)
+                    if unit['is_action'] and len(compiled_data) > P3PayloadBuilder.MAX_SEGMENT_SIZE:
+                        logger.warning(
+                            f"Action block at line {unit['line_start']} exceeds {P3PayloadBuilder.MAX_SEGMENT_SIZE} "
+                            f"bytes ({len(compiled_data)} bytes): {unit['content'][:50]}..."
                         )
-                        packets.append(packet)
-                        chunk_info.append({
-                            'size': len(packet),
-                            'is_continuation': in_segmented_sequence,
-                            'sequence_index': len(packets) - 1
-                        })
-                        logger.debug(f"Flushed packet {len(packets)} before segmented unit: {len(packet)} bytes")
-                        current_packet_data = bytearray()
-
-                    # Each segment becomes its own packet
-                    for j, segment in enumerate(segments):
-                        packet = self.payload_builder.build_packet(segment, stream_id, token)
-                        packets.append(packet)
-
-                        # First segment starts a new sequence, subsequent segments are continuations
-                        is_continuation = j > 0 or in_segmented_sequence
-                        chunk_info.append({
-                            'size': len(packet),
-                            'is_continuation': is_continuation,
-                            'sequence_index': len(packets) - 1
-                        })
-                        logger.debug(f"Segmented packet {len(packets)} (segment {j}): {len(packet)} bytes, continuation: {is_continuation}")
-
-                    # After segmentation, we're in a segmented sequence
-                    in_segmented_sequence = True
-                else:
-                    # Single segment - try to pack with other data
-                    segment = segments[0]
-                    space_needed = len(current_packet_data) + len(segment)
-
-                    if space_needed > max_payload_per_packet:
-                        # Must flush current packet
-                        if current_packet_data:
-                            packet = self.payload_builder.build_packet(
-                                bytes(current_packet_data), stream_id, token
-                            )
-                            packets.append(packet)
-                            chunk_info.append({
-                                'size': len(packet),
-                                'is_continuation': in_segmented_sequence,
-                                'sequence_index': len(packets) - 1
-                            })
-                            logger.debug(f"Flushed packet {len(packets)}: {len(packet)} bytes, continuation: {in_segmented_sequence}")
-                            current_packet_data = bytearray()
-
-                    # Add segment to current packet
-                    current_packet_data.extend(segment)
 
+                    # Segment if needed (with continuation markers)
+                    segments = self.payload_builder.segment_data_if_needed(compiled_data)
+                    logger.debug(f"Unit {i}: {len(compiled_data)} bytes -> {len(segments)} segments")
+
+                    # Handle segments based on whether they have continuation markers
+                    if len(segments) > 1:
+                        # Unit was segmented - each segment must become its own packet
+                        # First flush any existing packet data
+                        if packets.pending_size:
+                            size = packets.end(in_segmented_sequence)
+                            logger.debug(f"Flushed packet {len(packets)} before segmented unit: {size} bytes")
+
+                        # Each segment becomes its own packet
+                        for j, segment in enumerate(segments):
+                            # First segment starts a new sequence, subsequent segments are continuations
+                            is_continuation = j > 0 or in_segmented_sequence
+                            size = packets.append(segment, is_continuation)
+                            logger.debug(f"Segmented packet {len(packets)} (segment {j}): {size} bytes, continuation: {is_continuation}")
+
+                        # After segmentation, we're in a segmented sequence
+                        in_segmented_sequence = True
+                    else:
+                        # Single segment - try to pack with other data
+                        segment = segments[0]
+                        space_needed = packets.pending_size + len(segment)
+
+                        if space_needed > max_payload_per_packet:
+                            # Must flush current packet
+                            if packets.pending_size:
+                                size = packets.end(in_segmented_sequence)
+                                logger.debug(f"Flushed packet {len(packets)}: {size} bytes, continuation: {in_segmented_sequence}")
+
+                        # Add segment to current packet
+                        packets.write(segment)
+
+            except PoolOverloadedError:
+                raise
             except FdoDaemonError as e:
                 raise FdoChunkingError(f"Compilation failed for atom at line {unit['line_start']}: {e}")
             except Exception as e:
                 raise FdoChunkingError(f"Processing failed for atom at line {unit['line_start']}: {e}")
 
         # Flush any remaining data
-        if current_packet_data:
-            packet = self.payload_builder.build_packet(
-                bytes(current_packet_data), stream_id, token
-            )
-            packets.append(packet)
-            chunk_info.append({
-                'size': len(packet),
-                'is_continuation': in_segmented_sequence,
-                'sequence_index': len(packets) - 1
-            })
-            logger.debug(f"Final packet {len(packets)}: {len(packet)} bytes, continuation: {in_segmented_sequence}")
+        if packets.pending_size:
+            size = packets.end(in_segmented_sequence)
+            logger.debug(f"Final packet {len(packets)}: {size} bytes, continuation: {in_segmented_sequence}")
+
+        if sequential_compile_time:
+            add_phase("compile", sequential_compile_time)
+        add_phase("assemble", time.perf_counter() - assemble_start - sequential_compile_time)
 
         logger.info(f"Chunking complete: {len(packets)} packets generated")
         return {
             'chunks': packets,
-            'chunk_info': chunk_info
+            'chunk_info': packets.chunk_info
         }
 
+    @staticmethod
+    def _data_atom_layout(compiled: bytes) -> Optional[Tuple[bytes, bytes]]:
+        """
+        Split a compiled data atom into its protocol/atom prefix and payload.
+
+        Standalone data atoms compile to [protocol][atom][length][payload], with
+        lengths of 0x80 and above as two bytes (0x80 | high, low).
+
+        Returns:
+            (2-byte prefix, payload), or None if compiled is not laid out that way
+        """
+        if len(compiled) < 4:
+            return None
+        if compiled[2] & 0x80:
+            header_size = 4
+            length = ((compiled[2] & 0x7F) << 8) | compiled[3]
+        else:
+            header_size = 3
+            length = compiled[2]
+        if length == 0 or header_size + length != len(compiled):
+            return None
+        return bytes(compiled[:2]), bytes(compiled[header_size:])
+
+    @staticmethod
+    def _data_atom_header(prefix: bytes, length: int) -> bytes:
+        if length < 0x80:
+            return prefix + bytes((length,))
+        return prefix + bytes((0x80 | (length >> 8), length & 0xFF))
+
+    @staticmethod
+    def _data_capacity(room: int) -> int:
+        """Largest payload whose compiled data atom fits in room bytes."""
+        length = room - 3
+        if length >= 0x80:
+            length = room - 4
+        return max(length, 0)
+
+    def _pack_data_atom(self, packets: P3PacketBuffer, prefix: bytes, data: bytes, is_text: bool,
+                        in_segmented_sequence: bool, max_payload_per_packet: int) -> int:
+        """
+        Append a compiled data atom, split into as many atoms of the same type as needed.
+
+        Each piece is sized to the space left in the current packet. Text is
+        split after a space (never inside a UTF-8 character); a piece that would
+        have to break a word goes to a fresh packet instead, and is only split
+        mid-word when no space fits in a whole packet.
+
+        Returns:
+            Number of data atoms written
+        """
+        offset = 0
+        pieces = 0
+        while offset < len(data):
+            rest = len(data) - offset
+            room = max_payload_per_packet - packets.pending_size
+            if rest + len(self._data_atom_header(prefix, rest)) <= room:
+                cut = rest
+            else:
+                capacity = self._data_capacity(room)
+                cut = self._data_split_point(data, offset, capacity, is_text) if capacity >= self.MIN_SPLIT_DATA_BYTES else 0
+                if not cut:
+                    if packets.pending_size:
+                        # Not worth splitting here; continue in a fresh packet
+                        packets.end(in_segmented_sequence)
+                        continue
+                    cut = self._data_split_point(data, offset, capacity, is_text, mid_word=True)
+
+            packets.write(self._data_atom_header(prefix, cut))
+            packets.write(data[offset:offset + cut])
+            offset += cut
+            pieces += 1
+        return pieces
+
+    @staticmethod
+    def _data_split_point(data: bytes, offset: int, capacity: int, is_text: bool, mid_word: bool = False) -> int:
+        """Payload bytes to take from offset (at most capacity); 0 if text has no space to split after."""
+        if not is_text:
+            return capacity
+        if not mid_word:
+            space = data.rfind(b' ', offset, offset + capacity)
+            return space - offset + 1 if space >= 0 else 0
+        cut = capacity
+        while cut > 0 and 0x80 <= data[offset + cut] < 0xC0:  # UTF-8 continuation byte
+            cut -= 1
+        return cut or capacity
+
     async def _compile_unit(self, unit: Dict[str, Any]) -> bytes:
         """
         Compile atom unit using FDO daemon.
@@ -292,9 +377,13 @@ class FdoChunker:
         Uses semaphore-based parallelism to maintain constant pool utilization rather than
         batch-wait-batch-wait pattern. This keeps all daemons busy at all times.
 
+        In pool mode the semaphore only bounds this request's outstanding checkouts
+        to what its lane could ever run at once; sharing daemons with other
+        concurrent requests is left to the pool scheduler's per-request fair share.
+
         Args:
             units: List of atom units to compile
-            batch_size: Maximum concurrent compilations (default: pool size or 30)
+            batch_size: Maximum concurrent compilations (default: lane capacity or 30)
 
         Returns:
             List of compiled binary data in same order as input units
@@ -309,8 +398,8 @@ class FdoChunker:
         max_concurrent = batch_size
         if max_concurrent is None:
             if hasattr(self.daemon_client, 'pool_manager'):
-                max_concurrent = self.daemon_client.pool_manager.pool_size
-                logger.debug(f"Using pool size for max_concurrent: {max_concurrent}")
+                max_concurrent = self.daemon_client.pool_manager.scheduler.max_concurrency()
+                logger.debug(f"Using lane capacity for max_concurrent: {max_concurrent}")
             else:
                 max_concurrent = 30  # Default for single daemon or unknown
                 logger.debug(f"No pool detected, using default max_concurrent: {max_concurrent}")
@@ -354,9 +443,10 @@ class FdoChunker:
         logger.info(f"Parallel compilation complete: {len(compiled_units)} units compiled")
         return compiled_units
 
-    def _compile_raw_data_to_chunks(self, unit: Dict[str, Any], stream_id: int, token: str) -> List[bytes]:
+    def _compile_raw_data_to_chunks(self, unit: Dict[str, Any], packets: P3PacketBuffer, token: str) -> int:
         """
-        Compile raw_data atom into multiple P3 packets (≤128 bytes payload each).
+        Compile raw_data atom into multiple P3 packets (≤128 bytes payload each),
+        appended to the packet buffer.
         Each packet independently has the 000576 NON-FDO prefix.
 
         Based on wire format analysis:
@@ -365,11 +455,11 @@ class FdoChunker:
 
         Args:
             unit: Atom unit with raw_data content
-            stream_id: Stream ID for P3 packets
+            packets: Packet buffer to append to (carries the stream ID)
             token: Token type for P3 packets
 
         Returns:
-            List of complete P3 packet bytes
+            Number of packets appended
 
         Raises:
             FdoChunkingError: If format is invalid
@@ -404,7 +494,7 @@ class FdoChunker:
             )
 
         # Split raw_binary into chunks, each gets 000576 prefix
-        packets = []
+        frames = 0
         offset = 0
 
         while offset < len(raw_binary):
@@ -412,26 +502,26 @@ class FdoChunker:
             chunk_size = min(max_data_per_frame, len(raw_binary) - offset)
             chunk = raw_binary[offset:offset + chunk_size]
 
-            # Add 000576 prefix to THIS chunk (each frame is independent)
-            prefixed_chunk = b'\x00\x05\x76' + chunk
-
-            # Build P3 packet (adds token + stream_id header)
-            packet = self.payload_builder.build_packet(prefixed_chunk, stream_id, token)
-            packets.append(packet)
+            # Add 000576 prefix to THIS chunk (each frame is independent);
+            # the buffer adds the token + stream_id header
+            packets.write(b'\x00\x05\x76')
+            packets.write(chunk)
+            size = packets.end(False)
+            frames += 1
 
             offset += chunk_size
 
             logger.debug(
-                f"raw_data frame {len(packets)}: {len(chunk)} bytes + 3-byte prefix "
-                f"= {len(prefixed_chunk)} bytes payload → {len(packet)} bytes packet"
+                f"raw_data frame {frames}: {len(chunk)} bytes + 3-byte prefix "
+                f"= {len(chunk) + prefix_size} bytes payload → {size} bytes packet"
             )
 
         logger.info(
             f"Split raw_data at line {unit['line_start']}: {len(raw_binary)} bytes → "
-            f"{len(packets)} frames (max {max_data_per_frame} bytes/frame)"
+            f"{frames} frames (max {max_data_per_frame} bytes/frame)"
         )
 
-        return packets
+        return frames
 
     async def validate_script(self, fdo_script: str) -> Dict[str, Any]:
         """
@@ -459,6 +549,8 @@ class FdoChunker:
             }
             logger.info(f"Script validation successful: {len(compiled_data)} bytes")
 
+        except PoolOverloadedError:
+            raise
         except FdoDaemonError as e:
             compilation_result['error'] = f"Compilation failed: {e}"
             logger.warning(f"Script validation failed: {e}")
@@ -534,7 +626,8 @@ class FdoChunker:
         try:
             # Optional pre-validation
             if validate_first:
-                validation = await self.validate_script(fdo_script)
+                with span("validate"):
+                    validation = await self.validate_script(fdo_script)
                 result['validation'] = validation
 
                 if not validation['overall_valid']:
@@ -549,12 +642,12 @@ class FdoChunker:
             # Calculate statistics
             stats = {
                 'chunk_count': len(chunks),
-                'total_size': sum(len(chunk) for chunk in chunks),
-                'average_chunk_size': sum(len(chunk) for chunk in chunks) / len(chunks) if chunks else 0,
+                'total_size': chunks.payload_size,
+                'average_chunk_size': chunks.payload_size / len(chunks) if chunks else 0,
                 'header_size': self.payload_builder.get_header_size(token),
                 'token': token,
                 'stream_id': stream_id,
-                'continuation_count': sum(1 for info in chunk_info if info['is_continuation'])
+                'continuation_count': chunks.continuation_count
             }
 
             result.update({
@@ -566,6 +659,9 @@ class FdoChunker:
 
             logger.info(f"Chunking completed successfully: {stats['chunk_count']} chunks, {stats['total_size']} total bytes")
 
+        except PoolOverloadedError:
+            # Surfaced as 429 by the endpoint rather than a chunking failure
+            raise
         except Exception as e:
             result['error'] = str(e)
             logger.error(f"Chunking workflow failed: {e}")
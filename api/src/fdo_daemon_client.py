@@ -5,16 +5,25 @@ Speaks the vendor-documented HTTP interface:
   - POST /compile    (Content-Type: text/plain) -> application/octet-stream
   - POST /decompile  (Content-Type: application/octet-stream) -> text/plain
   - GET  /health     -> JSON
+
+Compile and decompile go through httpx by default, or through the lean
+keep-alive transport in fdo_daemon_transport when fast_transport is set.
 """
 
 from __future__ import annotations
 
 import base64
 import json
-from typing import Optional, Dict, Any
+import time
+from typing import Optional, Dict, Any, Union
 
 import httpx
 
+from metrics import DAEMON_SERVICE_SECONDS, DAEMON_ERRORS, COMPILED_BYTES, DECOMPILED_BYTES, classify_error
+from request_timing import add_phase, record_daemon
+from adaptive_timeouts import AdaptiveTimeouts
+from fdo_daemon_transport import DaemonResponse, DaemonTransport
+
 
 class FdoDaemonError(Exception):
     def __init__(self, status_code: int, content_type: str, text: str, body_bytes: bytes, json_obj: Optional[Dict[str, Any]] = None):
@@ -34,9 +43,14 @@ class FdoDaemonClient:
         base_url: str,
         token: Optional[str] = None,
         timeout_seconds: float = 10.0,
+        daemon_id: str = "daemon",
+        timeouts: Optional[AdaptiveTimeouts] = None,
+        fast_transport: bool = False,
     ) -> None:
         self.base_url = base_url.rstrip("/")
+        self.daemon_id = daemon_id  # Metrics label
         self.timeout_seconds = timeout_seconds
+        self.timeouts = timeouts  # Per-request timeouts from size and observed latency (flat timeout if None)
         self.headers: Dict[str, str] = {}
         if token:
             self.headers["Authorization"] = f"Bearer {token}"
@@ -51,9 +65,13 @@ class FdoDaemonClient:
                 keepalive_expiry=30.0,  # Keep connections alive for 30 seconds
             ),
         )
+        # Compile/decompile bypass httpx when set; health checks always use httpx
+        self._transport = DaemonTransport(self.base_url, self.headers) if fast_transport else None
 
     async def close(self) -> None:
         """Close the HTTP client and clean up resources."""
+        if self._transport is not None:
+            await self._transport.close()
         await self._client.aclose()
 
     async def health(self) -> Dict[str, Any]:
@@ -61,14 +79,13 @@ class FdoDaemonClient:
         r.raise_for_status()
         return r.json()
 
-    async def compile_source(self, source_text: str) -> bytes:
+    async def compile_source(self, source_text: str, timeout: Optional[float] = None) -> bytes:
         """Compile FDO source text to binary via daemon.
 
         Daemon expects raw text/plain body, returns application/octet-stream.
         """
-        headers = {"Content-Type": "text/plain", **self.headers}
         data = source_text.encode("utf-8")
-        r = await self._client.post(f"{self.base_url}/compile", headers=headers, content=data)
+        r = await self._post("compile", "text/plain", data, timeout)
         if r.status_code >= 400:
             json_obj: Optional[Dict[str, Any]] = None
             try:
@@ -79,16 +96,16 @@ class FdoDaemonClient:
                     json_obj = json.loads(r.text)
                 except Exception:
                     json_obj = None
-            raise FdoDaemonError(r.status_code, r.headers.get("Content-Type", ""), r.text, r.content, json_obj)
+            self._raise_error(r, json_obj, "compile")
+        COMPILED_BYTES.inc(amount=len(r.content))
         return r.content
 
-    async def decompile_binary(self, binary_data: bytes) -> str:
+    async def decompile_binary(self, binary_data: bytes, timeout: Optional[float] = None) -> str:
         """Decompile binary to source via daemon.
 
         Daemon expects application/octet-stream body, returns text/plain.
         """
-        headers = {"Content-Type": "application/octet-stream", **self.headers}
-        r = await self._client.post(f"{self.base_url}/decompile", headers=headers, content=binary_data)
+        r = await self._post("decompile", "application/octet-stream", binary_data, timeout)
         if r.status_code >= 400:
             json_obj: Optional[Dict[str, Any]] = None
             try:
@@ -98,7 +115,44 @@ class FdoDaemonClient:
                     json_obj = json.loads(r.text)
                 except Exception:
                     json_obj = None
-            raise FdoDaemonError(r.status_code, r.headers.get("Content-Type", ""), r.text, r.content, json_obj)
+            self._raise_error(r, json_obj, "decompile")
+        DECOMPILED_BYTES.inc(amount=len(binary_data))
         return r.text
 
+    def timeout_for(self, op: str, size: int) -> float:
+        """Timeout for a request of this operation and input size."""
+        if self.timeouts is None:
+            return self.timeout_seconds
+        return self.timeouts.timeout_for(op, size)
+
+    async def _post(self, op: str, content_type: str, content: bytes,
+                    timeout: Optional[float] = None) -> Union[httpx.Response, DaemonResponse]:
+        """POST to a daemon endpoint, recording round trip time and transport errors."""
+        if timeout is None:
+            timeout = self.timeout_for(op, len(content))
+        record_daemon(self.daemon_id)
+        start = time.perf_counter()
+        try:
+            if self._transport is not None:
+                r = await self._transport.post(f"/{op}", content_type, content, timeout)
+            else:
+                headers = {"Content-Type": content_type, **self.headers}
+                r = await self._client.post(f"{self.base_url}/{op}", headers=headers, content=content,
+                                            timeout=timeout)
+        except Exception as e:
+            add_phase("daemon", time.perf_counter() - start)
+            DAEMON_ERRORS.inc(self.daemon_id, op, classify_error(e))
+            raise
+        duration = time.perf_counter() - start
+        add_phase("daemon", duration)
+        DAEMON_SERVICE_SECONDS.observe(self.daemon_id, op, value=duration)
+        if self.timeouts is not None:
+            self.timeouts.record(op, len(content), duration)
+        return r
+
+    def _raise_error(self, r: Union[httpx.Response, DaemonResponse], json_obj: Optional[Dict[str, Any]], op: str) -> None:
+        error = FdoDaemonError(r.status_code, r.headers.get("content-type", ""), r.text, r.content, json_obj)
+        DAEMON_ERRORS.inc(self.daemon_id, op, classify_error(error))
+        raise error
+
 
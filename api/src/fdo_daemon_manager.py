@@ -10,12 +10,16 @@ import os
 import shutil
 import socket
 import subprocess
+import sys
 import time
 import logging
-from typing import Optional
+from typing import Dict, List, Optional
 
 import httpx
 
+from daemon_resources import process_tree
+from cgroup_resources import pin_pids
+
 logger = logging.getLogger(__name__)
 
 
@@ -35,17 +39,35 @@ class FdoDaemonManager:
         bind_host: str = "127.0.0.1",
         port: Optional[int] = None,
         startup_timeout_seconds: float = 30.0,  # Increased for Wine + Ada32 initialization
+        env: Optional[Dict[str, str]] = None,  # Extra environment, e.g. a per-shard WINEPREFIX
+        cpus: Optional[List[int]] = None,  # Pin the daemon and its Wine children to these CPUs
+        threads: int = 1,  # Concurrent requests the daemon accepts (--threads)
     ) -> None:
         self.exe_path = exe_path
         self.bind_host = bind_host
         self.port = port or _pick_free_port(bind_host)
         self.startup_timeout_seconds = startup_timeout_seconds
+        self.env = env
+        self.cpus = cpus
+        self.threads = threads
         self._proc: Optional[subprocess.Popen] = None
 
     @property
     def base_url(self) -> str:
         return f"http://{self.bind_host}:{self.port}"
 
+    @property
+    def pid(self) -> Optional[int]:
+        """PID of the running daemon process, or None if not running."""
+        if self._proc is None or self._proc.poll() is not None:
+            return None
+        return self._proc.pid
+
+    def process_tree(self) -> List[int]:
+        """PIDs of the daemon process and its descendants (Wine loader children), root first."""
+        pid = self.pid
+        return process_tree(pid) if pid is not None else []
+
     def health_check(self) -> bool:
         """
         Perform a health check on the daemon.
@@ -62,8 +84,14 @@ class FdoDaemonManager:
         if self._proc is not None and self._proc.poll() is None:
             return  # already running
 
-        wine = os.environ.get("WINE", "wine")
-        cmd = [wine, self.exe_path, "--host", self.bind_host, "--port", str(self.port)]
+        if self.exe_path.endswith(".py"):
+            # Python stand-in (e.g. bench/mock_fdo_daemon.py) - no Wine needed
+            cmd = [sys.executable, self.exe_path, "--host", self.bind_host, "--port", str(self.port)]
+        else:
+            wine = os.environ.get("WINE", "wine")
+            cmd = [wine, self.exe_path, "--host", self.bind_host, "--port", str(self.port)]
+        if self.threads > 1:
+            cmd += ["--threads", str(self.threads)]
 
         # Ensure daemon runs with its DLLs present by setting cwd to exe directory
         cwd = os.path.dirname(self.exe_path) or None
@@ -77,7 +105,11 @@ class FdoDaemonManager:
         logger.info(f"Logs: /tmp/fdo_daemon_stdout.log and /tmp/fdo_daemon_stderr.log")
 
         # Start process with redirected output
-        self._proc = subprocess.Popen(cmd, cwd=cwd, stdout=stdout_log, stderr=stderr_log)
+        env = {**os.environ, **self.env} if self.env else None
+        self._proc = subprocess.Popen(cmd, cwd=cwd, stdout=stdout_log, stderr=stderr_log, env=env)
+        if self.cpus:
+            # Children started from here on inherit the mask; the whole tree is re-pinned once healthy
+            pin_pids([self._proc.pid], self.cpus)
 
         # Wait until health endpoint responds
         deadline = time.time() + self.startup_timeout_seconds
@@ -86,6 +118,8 @@ class FdoDaemonManager:
                 r = httpx.get(f"{self.base_url}/health", timeout=0.5)
                 if r.status_code == 200:
                     logger.info(f"Daemon healthy on {self.base_url}")
+                    if self.cpus:
+                        pin_pids(self.process_tree(), self.cpus)
                     return
             except Exception as e:
                 logger.debug(f"Health check failed: {e}")
@@ -7,14 +7,49 @@ Provides same interface as FdoDaemonClient for backward compatibility.
 """
 
 import time
+import asyncio
 import logging
-from typing import Dict, Any, Callable, Optional, Awaitable
+from typing import Dict, Any, Callable, Optional, Awaitable, Tuple
+
+import httpx
 
 from fdo_daemon_client import FdoDaemonClient, FdoDaemonError
-from fdo_daemon_pool_manager import FdoDaemonPoolManager, DaemonInstance
+from fdo_daemon_pool_manager import FdoDaemonPoolManager, DaemonInstance, DaemonSlot
+from metrics import DAEMON_CHECKOUT_WAIT_SECONDS, DAEMON_CHECKOUT_TIMEOUTS, DAEMON_RETRIES, DAEMON_HEDGES
+from request_timing import add_phase
+from pool_scheduler import PoolOverloadedError
 
 logger = logging.getLogger(__name__)
 
+# Extra time past a request's own timeout before the health monitor treats it as stuck
+STUCK_REQUEST_GRACE = 5.0
+
+
+class HedgeBudget:
+    """
+    Token bucket capping hedged requests to a fraction of all requests.
+
+    Every request earns `ratio` tokens (up to `burst`); a hedge spends one.
+    Only touched from the event loop.
+    """
+
+    def __init__(self, ratio: float, burst: float = 10.0):
+        self.ratio = ratio
+        self.burst = burst
+        self.tokens = burst
+
+    def earn(self) -> None:
+        self.tokens = min(self.burst, self.tokens + self.ratio)
+
+    def take(self) -> bool:
+        if self.tokens < 1.0:
+            return False
+        self.tokens -= 1.0
+        return True
+
+    def refund(self) -> None:
+        self.tokens = min(self.burst, self.tokens + 1.0)
+
 
 class FdoDaemonPoolClient:
     """
@@ -29,6 +64,10 @@ class FdoDaemonPoolClient:
         pool_manager: FdoDaemonPoolManager,
         max_retries: int = 3,
         timeout_seconds: float = 10.0,
+        hedging: bool = False,
+        hedge_quantile: float = 0.95,
+        hedge_budget: float = 0.05,
+        fast_transport: bool = False,
     ):
         """
         Initialize pool client.
@@ -37,16 +76,28 @@ class FdoDaemonPoolClient:
             pool_manager: FdoDaemonPoolManager instance
             max_retries: Maximum retry attempts per request
             timeout_seconds: Timeout for individual daemon requests
+            hedging: Send a second copy of slow requests to another idle daemon
+            hedge_quantile: Hedge once a request has run longer than this latency quantile
+            hedge_budget: Maximum hedged requests as a fraction of all requests
+            fast_transport: Use the lean keep-alive transport instead of httpx for daemon requests
         """
         self.pool_manager = pool_manager
         self.max_retries = max_retries
         self.timeout_seconds = timeout_seconds
+        self.fast_transport = fast_transport
+        self.hedging = hedging
+        self.hedge_quantile = hedge_quantile
+        self._hedge_budget = HedgeBudget(hedge_budget)
 
         # Cache of FdoDaemonClient instances (one per daemon) to reuse connections
         # Key: daemon_id, Value: FdoDaemonClient instance
         self._client_cache: Dict[str, FdoDaemonClient] = {}
 
-        logger.info(f"Initialized FdoDaemonPoolClient: max_retries={max_retries}, timeout={timeout_seconds}s")
+        logger.info(
+            f"Initialized FdoDaemonPoolClient: max_retries={max_retries}, timeout={timeout_seconds}s, "
+            f"hedging={'p%g/%g%%' % (hedge_quantile * 100, hedge_budget * 100) if hedging else 'off'}"
+            f", transport={'fast' if fast_transport else 'httpx'}"
+        )
 
     def _get_or_create_client(self, instance: DaemonInstance) -> FdoDaemonClient:
         """
@@ -61,15 +112,33 @@ class FdoDaemonPoolClient:
         Returns:
             FdoDaemonClient for this daemon instance
         """
-        if instance.id not in self._client_cache:
+        base_url = f"http://{instance.bind_host}:{instance.port}"
+        client = self._client_cache.get(instance.id)
+        if client is None or client.base_url != base_url:
+            if client is not None:
+                # Daemon was replaced by a rolling recycle on a new port. Requests still
+                # draining on the old process hold their own reference, so close it later.
+                grace = self.pool_manager.timeouts.max_timeout + STUCK_REQUEST_GRACE
+                asyncio.get_running_loop().call_later(grace, lambda old=client: asyncio.ensure_future(old.close()))
+
             # Create new client with connection pooling
-            self._client_cache[instance.id] = FdoDaemonClient(
-                base_url=f"http://{instance.bind_host}:{instance.port}",
-                timeout_seconds=self.timeout_seconds
+            client = self._client_cache[instance.id] = FdoDaemonClient(
+                base_url=base_url,
+                timeout_seconds=self.timeout_seconds,
+                daemon_id=instance.id,
+                timeouts=self.pool_manager.timeouts,
+                fast_transport=self.fast_transport
             )
-            logger.debug(f"Created new client for {instance.id}")
+            logger.debug(f"Created new client for {instance.id} on port {instance.port}")
 
-        return self._client_cache[instance.id]
+        return client
+
+    def _drop_client(self, instance: DaemonInstance) -> None:
+        """Discard a daemon's cached client so no pooled connection to the old process is reused."""
+        client = self._client_cache.get(instance.id)
+        if client is not None and client.base_url == f"http://{instance.bind_host}:{instance.port}":
+            del self._client_cache[instance.id]
+            asyncio.ensure_future(client.close())
 
     async def close(self) -> None:
         """Close all cached HTTP clients and clean up resources."""
@@ -119,8 +188,8 @@ class FdoDaemonPoolClient:
         Raises:
             RuntimeError: If all retry attempts fail
         """
-        async def operation(client: FdoDaemonClient) -> bytes:
-            result = await client.compile_source(source_text)
+        async def operation(client: FdoDaemonClient, timeout: float) -> bytes:
+            result = await client.compile_source(source_text, timeout=timeout)
             if isinstance(result, dict) and result.get('success'):
                 # Convert from dict response to bytes
                 return bytes.fromhex(result['binary_data'])
@@ -129,7 +198,7 @@ class FdoDaemonPoolClient:
             else:
                 raise FdoDaemonError(500, "application/json", f"Unexpected compile response: {type(result)}", b"", None)
 
-        return await self._execute_with_retry(operation)
+        return await self._execute_with_retry(operation, "compile", len(source_text))
 
     async def decompile_binary(self, binary_data: bytes) -> str:
         """
@@ -144,8 +213,8 @@ class FdoDaemonPoolClient:
         Raises:
             RuntimeError: If all retry attempts fail
         """
-        async def operation(client: FdoDaemonClient) -> str:
-            result = await client.decompile_binary(binary_data)
+        async def operation(client: FdoDaemonClient, timeout: float) -> str:
+            result = await client.decompile_binary(binary_data, timeout=timeout)
             if isinstance(result, dict) and result.get('success'):
                 return result['source_text']
             elif isinstance(result, str):
@@ -153,103 +222,97 @@ class FdoDaemonPoolClient:
             else:
                 raise FdoDaemonError(500, "application/json", f"Unexpected decompile response: {type(result)}", b"", None)
 
-        return await self._execute_with_retry(operation)
+        return await self._execute_with_retry(operation, "decompile", len(binary_data))
 
-    async def _execute_with_retry(self, operation: Callable[[FdoDaemonClient], Awaitable[Any]]) -> Any:
+    async def _execute_with_retry(self, operation: Callable[[FdoDaemonClient, float], Awaitable[Any]],
+                                  op: str = "request", size: int = 0) -> Any:
         """
         Execute operation with automatic retry and failover.
 
         Args:
-            operation: Async function that takes FdoDaemonClient and returns result
+            operation: Async function that takes FdoDaemonClient and a timeout and returns result
+            op: Operation name used as a metrics label
+            size: Input size in bytes, used to route large inputs to their own lane and size the timeout
 
         Returns:
             Result from successful operation
 
         Raises:
-            RuntimeError: If no healthy daemons or all retries fail
+            PoolOverloadedError: If no daemon could be checked out within the lane's checkout timeout
+            RuntimeError: If all retries fail
         """
         attempts = 0
         last_error = None
         attempted_instances = set()
+        scheduler = self.pool_manager.scheduler
+        lane = scheduler.resolve_lane(size=size)
+        timeout = self.pool_manager.timeouts.timeout_for(op, size)
+        if self.hedging:
+            self._hedge_budget.earn()
 
         while attempts < self.max_retries:
-            # Get next healthy daemon instance (wait up to 5 seconds if pool is busy)
-            instance = await self.pool_manager.get_healthy_instance_async(timeout=5.0)
-
-            if not instance:
-                raise RuntimeError(
-                    f"No healthy daemon instances available after 5s wait "
+            # Get next healthy daemon instance (waits in the lane's queue if the pool is busy)
+            checkout_start = time.perf_counter()
+            # Prefer daemons this request has not failed on yet
+            slot = await self.pool_manager.get_healthy_instance_async(
+                timeout=scheduler.checkout_timeout(lane), avoid=attempted_instances, lane=lane, size=size
+            )
+            checkout_wait = time.perf_counter() - checkout_start
+            DAEMON_CHECKOUT_WAIT_SECONDS.observe(lane, value=checkout_wait)
+            add_phase("checkout", checkout_wait)
+
+            if not slot:
+                DAEMON_CHECKOUT_TIMEOUTS.inc(lane)
+                raise PoolOverloadedError(
+                    lane, checkout_wait, scheduler.retry_after(lane),
+                    f"No healthy daemon instances available after {checkout_wait:.1f}s wait "
                     f"(attempted {len(attempted_instances)} instances, pool exhausted)"
                 )
 
-            # Skip if we've already tried this instance
-            if instance.id in attempted_instances:
-                attempts += 1
-                continue
-
+            instance = slot.instance
             attempted_instances.add(instance.id)
+            slot.deadline = time.time() + timeout + STUCK_REQUEST_GRACE
 
             # Get cached client for this daemon instance (reuses HTTP connections)
             client = self._get_or_create_client(instance)
 
+            # Execute operation
+            logger.debug(f"Executing operation on {instance.id} (attempt {attempts + 1}/{self.max_retries})")
+
             try:
-                # Execute operation
-                logger.debug(f"Executing operation on {instance.id} (attempt {attempts + 1}/{self.max_retries})")
-
-                try:
-                    result = await operation(client)
-
-                    # Success - update metrics
-                    async with self.pool_manager.async_lock:
-                        instance.total_requests += 1
-                        instance.consecutive_failures = 0
-
-                        # Close circuit breaker if it was open
-                        if instance.circuit_breaker_open:
-                            instance.circuit_breaker_open = False
-                            logger.info(f"Circuit breaker closed for {instance.id} (successful request)")
-
-                    logger.debug(f"Operation successful on {instance.id}")
-                    return result
-
-                except Exception as e:
-                    # Failure - update metrics and circuit breaker
-                    async with self.pool_manager.async_lock:
-                        instance.total_requests += 1
-                        instance.failed_requests += 1
-                        instance.consecutive_failures += 1
-
-                        # Open circuit breaker if threshold exceeded
-                        if instance.consecutive_failures >= self.pool_manager.circuit_breaker_threshold:
-                            instance.circuit_breaker_open = True
-                            instance.state = "unhealthy"
-                            logger.warning(
-                                f"Circuit breaker opened for {instance.id} "
-                                f"({instance.consecutive_failures} consecutive failures)"
-                            )
-
-                    last_error = e
-                    attempts += 1
-
-                    logger.warning(f"Operation failed on {instance.id}: {e}")
-
-                    # Exponential backoff before retry (except on last attempt)
-                    if attempts < self.max_retries:
-                        import asyncio
-                        backoff_delay = 0.1 * (2 ** attempts)
-                        logger.debug(f"Retry backoff: {backoff_delay:.2f}s")
-                        await asyncio.sleep(backoff_delay)
-
-                finally:
-                    # Always clear processing flag when done (success or failure)
-                    async with self.pool_manager.async_lock:
-                        instance.is_processing = False
-                        instance.request_started_at = None
-
-            except Exception:
-                # Outer try-except catches any unexpected errors
-                # Processing flag already cleared in inner finally
-                raise
+                started = time.perf_counter()
+                if self.hedging:
+                    result, primary_error = await self._run_hedged(instance, client, operation, timeout, op, size, lane)
+                else:
+                    result, primary_error = await operation(client, timeout), None
+
+                if primary_error is not None:
+                    # This daemon failed but a hedge still answered
+                    await self._record_failure(instance, primary_error, op, timeout, size)
+                else:
+                    # If a hedge won, the elapsed time is a lower bound on this daemon's service time
+                    await self.pool_manager.record_request_result(instance, True, time.perf_counter() - started)
+
+                logger.debug(f"Operation successful on {instance.id}")
+                return result
+
+            except Exception as e:
+                # Failure - update metrics and circuit breaker
+                await self._record_failure(instance, e, op, timeout, size)
+
+                last_error = e
+                attempts += 1
+
+            finally:
+                # Always free the slot when done (success or failure)
+                await self.pool_manager.release_slot(slot)
+
+            # Exponential backoff before retry (except on last attempt); the daemon is already released
+            if attempts < self.max_retries:
+                DAEMON_RETRIES.inc(op)
+                backoff_delay = 0.1 * (2 ** attempts)
+                logger.debug(f"Retry backoff: {backoff_delay:.2f}s")
+                await asyncio.sleep(backoff_delay)
 
         # All retries exhausted
         raise RuntimeError(
@@ -257,6 +320,108 @@ class FdoDaemonPoolClient:
             f"Last error: {last_error}"
         )
 
+    async def _record_failure(self, instance: DaemonInstance, error: Exception, op: str,
+                              timeout: float, size: int) -> None:
+        """Count a failed attempt against a daemon, recycling it if the request timed out."""
+        await self.pool_manager.record_request_result(instance, False)
+        logger.warning(f"Operation failed on {instance.id}: {error}")
+
+        if isinstance(error, httpx.TimeoutException):
+            # No answer within the adaptive timeout: the daemon is likely wedged, recycle it now
+            logger.warning(f"{op} timed out on {instance.id} after {timeout:.2f}s ({size} bytes)")
+            self._drop_client(instance)
+            self.pool_manager.recycle_instance(instance, reason="request_timeout")
+
+    async def _run_hedged(self, instance: DaemonInstance, client: FdoDaemonClient,
+                          operation: Callable[[FdoDaemonClient, float], Awaitable[Any]],
+                          timeout: float, op: str, size: int, lane: str) -> Tuple[Any, Optional[Exception]]:
+        """
+        Run an operation on a checked-out daemon, hedging to a second idle daemon
+        if no answer has arrived by the observed hedge quantile for this
+        operation and input size. The first successful answer wins and the other
+        attempt is cancelled.
+
+        Hedges are only sent while the budget allows and another daemon has a
+        free slot with nothing queued, so they never delay other requests.
+
+        Returns:
+            (result, primary_error): primary_error is set if the primary daemon
+            failed before the hedge answered
+
+        Raises:
+            Exception: The primary daemon's error if no attempt succeeded
+        """
+        primary = asyncio.ensure_future(operation(client, timeout))
+        delay = self.pool_manager.timeouts.observed_quantile(op, size, self.hedge_quantile)
+        if delay is None or delay >= timeout:
+            return await primary, None
+
+        try:
+            done, _ = await asyncio.wait({primary}, timeout=delay)
+        except asyncio.CancelledError:
+            primary.cancel()
+            raise
+        if done:
+            return primary.result(), None
+
+        if not self._hedge_budget.take():
+            DAEMON_HEDGES.inc(op, "no_budget")
+            return await primary, None
+
+        hedge_slot = await self.pool_manager.try_checkout(lane, avoid={instance.id})
+        if hedge_slot is None:
+            self._hedge_budget.refund()
+            DAEMON_HEDGES.inc(op, "no_daemon")
+            return await primary, None
+
+        DAEMON_HEDGES.inc(op, "sent")
+        logger.debug(f"Hedging {op} from {instance.id} to {hedge_slot.instance.id} after {delay * 1000:.1f}ms")
+        hedge = asyncio.ensure_future(self._hedge_attempt(hedge_slot, operation, timeout, op, size))
+
+        winner = None
+        pending = {primary, hedge}
+        try:
+            while pending and winner is None:
+                done, pending = await asyncio.wait(pending, return_when=asyncio.FIRST_COMPLETED)
+                for task in done:
+                    if task.exception() is None:
+                        winner = task
+                        break
+        finally:
+            for task in pending:
+                task.cancel()
+
+        if winner is None:
+            DAEMON_HEDGES.inc(op, "failed")
+            raise primary.exception()
+
+        if winner is hedge:
+            DAEMON_HEDGES.inc(op, "won")
+            primary_error = primary.exception() if primary.done() and not primary.cancelled() else None
+            return hedge.result(), primary_error
+
+        DAEMON_HEDGES.inc(op, "lost")
+        return primary.result(), None
+
+    async def _hedge_attempt(self, slot: DaemonSlot,
+                             operation: Callable[[FdoDaemonClient, float], Awaitable[Any]],
+                             timeout: float, op: str, size: int) -> Any:
+        """Run the hedge copy of a request on its own daemon, with full bookkeeping."""
+        instance = slot.instance
+        slot.deadline = time.time() + timeout + STUCK_REQUEST_GRACE
+        started = time.perf_counter()
+        try:
+            result = await operation(self._get_or_create_client(instance), timeout)
+            await self.pool_manager.record_request_result(instance, True, time.perf_counter() - started)
+            return result
+        except asyncio.CancelledError:
+            raise
+        except Exception as e:
+            await self._record_failure(instance, e, op, timeout, size)
+            raise
+        finally:
+            await self.pool_manager.release_slot(slot)
+
     def __repr__(self) -> str:
         pool_status = self.pool_manager.get_pool_status()
         healthy = pool_status["instances_healthy"]
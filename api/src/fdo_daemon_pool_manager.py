@@ -11,12 +11,22 @@ import time
 import threading
 import asyncio
 import logging
-from typing import List, Dict, Any, Optional
+import statistics
+from typing import List, Dict, Any, Optional, Set, Tuple
 from dataclasses import dataclass, field
 from pathlib import Path
 import shutil
+import subprocess
 
 from fdo_daemon_manager import FdoDaemonManager
+from pool_scheduler import PoolScheduler
+from adaptive_timeouts import AdaptiveTimeouts
+from daemon_resources import DaemonResourceCollector, read_process
+from cgroup_resources import cpu_quota, memory_limit, default_pool_size, core_sets, pin_pids
+from metrics import (
+    DAEMON_RESTARTS, DAEMON_EJECTIONS, CIRCUIT_BREAKER_TRANSITIONS, POOL_INSTANCES, POOL_BUSY_INSTANCES,
+    POOL_LANE_WAITING, POOL_LANE_BUSY, DAEMON_RSS_BYTES, DAEMON_CPU_SECONDS, DAEMON_CONTEXT_SWITCHES
+)
 
 logger = logging.getLogger(__name__)
 
@@ -29,6 +39,8 @@ class DaemonInstance:
     working_dir: str                  # Isolated directory path
     bind_host: str                    # Bind address
     manager: Optional[FdoDaemonManager] = None  # Underlying daemon manager
+    wine_prefix: Optional[str] = None  # Sharded WINEPREFIX (None: inherited shared prefix)
+    cpus: Optional[List[int]] = None  # CPU affinity of the daemon's process tree (None: unpinned)
 
     # Health and state
     state: str = "initializing"       # "healthy", "unhealthy", "crashed", "restarting"
@@ -37,13 +49,56 @@ class DaemonInstance:
 
     # Metrics
     restart_count: int = 0            # Total restarts
+    restart_times: List[float] = field(default_factory=list)  # Restarts within the restart window
+    restart_pending: Optional[str] = None  # Reason of a restart refused by the window budget, retried by the health sweep
     consecutive_failures: int = 0     # Current failure streak
     total_requests: int = 0           # Request counter
     failed_requests: int = 0          # Failed request counter
 
     # Request tracking for load balancing
-    is_processing: bool = False       # True when actively processing a request
-    request_started_at: Optional[float] = None  # Timestamp when request started
+    slots: int = 1                    # Requests the daemon processes concurrently (--threads)
+    active: List["DaemonSlot"] = field(default_factory=list)  # In-flight requests, one per occupied slot
+
+    # Latency-aware selection
+    ewma_service_time: Optional[float] = None  # Smoothed successful request time (seconds)
+    latency_samples: int = 0          # Samples folded into the EWMA since (re)start
+    ejected_until: float = 0.0        # Excluded from selection until this timestamp
+    ejection_count: int = 0           # Times ejected as a latency outlier
+
+    # Rolling recycling
+    started_at: float = field(default_factory=time.time)  # Current process start time
+    requests_since_start: int = 0     # Requests served by the current process
+    rss_bytes: Optional[int] = None   # Process tree resident memory at the last resource sample
+    recycle_count: int = 0            # Planned replacements (not counted as restarts)
+    recycling: Optional[str] = None   # Reason while a replacement is starting
+
+    def reset_latency(self) -> None:
+        """Forget latency history (new process or ejection served)."""
+        self.ewma_service_time = None
+        self.latency_samples = 0
+
+    @property
+    def in_flight(self) -> int:
+        return len(self.active)
+
+    @property
+    def is_processing(self) -> bool:
+        """True while at least one request is in flight."""
+        return bool(self.active)
+
+    @property
+    def has_free_slot(self) -> bool:
+        return len(self.active) < self.slots
+
+
+@dataclass(eq=False)
+class DaemonSlot:
+    """One checked-out request slot on a daemon; released with FdoDaemonPoolManager.release_slot."""
+    instance: DaemonInstance
+    index: int                        # Slot number on the daemon (0..slots-1)
+    lane: Optional[str] = None        # Scheduling lane of the request
+    started_at: float = field(default_factory=time.time)
+    deadline: Optional[float] = None  # Request counts as stuck after this timestamp
 
 
 class FdoDaemonPoolManager:
@@ -51,11 +106,16 @@ class FdoDaemonPoolManager:
     Manages a pool of FDO daemon instances with load balancing and health monitoring.
 
     Features:
-    - Round-robin load balancing
+    - Priority lanes with reserved capacity and weighted checkout (PoolScheduler)
+    - Multiple concurrent request slots per daemon (fdo_daemon --threads)
+    - Latency-aware load balancing (fastest idle daemon by EWMA service time)
+    - Temporary ejection of latency outliers
     - Automatic health monitoring
     - Circuit breaker per daemon
     - Automatic restart on failure
+    - Rolling recycling by request count, RSS or age, surging a replacement first
     - Isolated working directories with symlinked DLLs
+    - Optional sharded Wine prefixes, one wineserver per group of daemons
     """
 
     def __init__(
@@ -67,20 +127,58 @@ class FdoDaemonPoolManager:
         restart_delay: float = 2.0,
         health_interval: float = 10.0,
         max_restart_attempts: int = 5,
+        restart_window: float = 600.0,
         circuit_breaker_threshold: int = 3,
+        ewma_alpha: float = 0.2,
+        eject_factor: float = 3.0,
+        eject_max_fraction: float = 0.2,
+        eject_duration: float = 30.0,
+        eject_min_samples: int = 20,
+        stuck_request_timeout: float = 30.0,
+        timeouts: Optional[AdaptiveTimeouts] = None,
+        recycle_max_requests: int = 0,
+        recycle_max_rss_mb: float = 0.0,
+        recycle_max_age: float = 0.0,
+        recycle_max_fraction: float = 0.2,
+        resource_interval: float = 5.0,
+        wine_prefix_shards: int = 0,
+        cpu_affinity: bool = False,
+        reserved_cpus: int = 1,
+        memory_fraction: float = 0.8,
+        slots_per_daemon: int = 1,
     ):
         """
         Initialize daemon pool manager.
 
         Args:
             exe_path: Path to fdo_daemon.exe
-            pool_size: Number of daemon instances (1-100 by default, configurable via FDO_DAEMON_POOL_MAX_SIZE)
+            pool_size: Number of daemon instances (1-100 by default, configurable via FDO_DAEMON_POOL_MAX_SIZE),
+                or 0 to size the pool from the cgroup CPU quota, memory limit and the first daemon's measured RSS
             base_port: Starting port number
             bind_host: Host address to bind daemons
             restart_delay: Delay before restarting crashed daemon (seconds)
             health_interval: Health check frequency (seconds)
-            max_restart_attempts: Maximum restart attempts per daemon
+            max_restart_attempts: Maximum restarts per daemon within restart_window
+            restart_window: Seconds over which a daemon's restarts are counted
             circuit_breaker_threshold: Failures before opening circuit breaker
+            ewma_alpha: Weight of the newest sample in the service time EWMA
+            eject_factor: Eject a daemon whose EWMA exceeds this multiple of the pool median
+            eject_max_fraction: Maximum fraction of the pool ejected at once
+            eject_duration: Seconds an ejected daemon sits out before being re-probed
+            eject_min_samples: Samples required before a daemon can be ejected
+            stuck_request_timeout: Stuck threshold for checkouts made without a request deadline (seconds)
+            timeouts: Per-request timeout model shared by the pool's clients (default: from environment)
+            recycle_max_requests: Replace a daemon after this many requests (0 disables)
+            recycle_max_rss_mb: Replace a daemon whose RSS exceeds this many MiB (0 disables)
+            recycle_max_age: Replace a daemon after this many seconds (0 disables)
+            recycle_max_fraction: Maximum fraction of the pool being replaced at once (at least one daemon)
+            resource_interval: Seconds between /proc samples of daemon RSS, CPU time and context switches
+            wine_prefix_shards: Split daemons across this many cloned Wine prefixes, each with its own
+                wineserver (0 or 1: all daemons share the inherited WINEPREFIX)
+            cpu_affinity: Pin each daemon's process tree to its own core set
+            reserved_cpus: CPUs kept free of daemons for the API process (sizing and pinning)
+            memory_fraction: Share of the container memory limit daemons may use when auto-sizing
+            slots_per_daemon: Concurrent requests per daemon; daemons are started with --threads N
         """
         # Validation
         if not os.path.exists(exe_path):
@@ -88,10 +186,16 @@ class FdoDaemonPoolManager:
 
         # Configurable pool size limit (default: 100, can be overridden via FDO_DAEMON_POOL_MAX_SIZE)
         max_pool_size = int(os.getenv("FDO_DAEMON_POOL_MAX_SIZE", "100"))
+        self.auto_size = pool_size == 0
+        if self.auto_size:
+            # Upper bound from CPUs alone; start() narrows it by measured daemon RSS
+            pool_size = default_pool_size(None, reserved_cpus, memory_fraction, max_pool_size)
         if not (1 <= pool_size <= max_pool_size):
             raise ValueError(f"Pool size must be 1-{max_pool_size}, got: {pool_size}")
 
-        if base_port + pool_size > 65535:
+        # Replacements start on spare ports above the pool's own range
+        surge_ports = 2 * max(1, int(pool_size * recycle_max_fraction))
+        if base_port + pool_size + surge_ports > 65535:
             raise ValueError(f"Port range exceeds maximum (base={base_port}, size={pool_size})")
 
         self.exe_path = exe_path
@@ -102,17 +206,42 @@ class FdoDaemonPoolManager:
         self.restart_delay = restart_delay
         self.health_interval = health_interval
         self.max_restart_attempts = max_restart_attempts
+        self.restart_window = restart_window
         self.circuit_breaker_threshold = circuit_breaker_threshold
+        self.slots_per_daemon = max(1, slots_per_daemon)
+        self.ewma_alpha = ewma_alpha
+        self.eject_factor = eject_factor
+        self.eject_max_fraction = eject_max_fraction
+        self.eject_duration = eject_duration
+        self.eject_min_samples = eject_min_samples
+        self.stuck_request_timeout = stuck_request_timeout
+        self.timeouts = timeouts or AdaptiveTimeouts.from_env()
+        self.recycle_max_requests = recycle_max_requests
+        self.recycle_max_rss_bytes = int(recycle_max_rss_mb * 1024 * 1024)
+        self.recycle_max_age = recycle_max_age
+        self.recycle_max_fraction = recycle_max_fraction
 
         # Pool state
         self.instances: List[DaemonInstance] = []
-        self.current_index = 0  # Round-robin counter
+        self.current_index = 0  # Rotating start point for tie-breaking between equally fast daemons
 
         # Dual-lock system to handle both threaded health checks and async requests
         self.sync_lock = threading.RLock()  # For health monitor thread
         self.async_lock = asyncio.Lock()     # For async request path (prevents serialization)
         self.lock = self.sync_lock  # Backward compatibility alias for health monitor
 
+        # Lane-aware checkout queueing
+        self.scheduler = PoolScheduler(self)
+
+        # Rolling recycling: replaced daemons finishing their last request, ports held by starting replacements
+        self.draining: List[DaemonInstance] = []
+        self._reserved_ports: Set[int] = set()
+        self._replacements: List[FdoDaemonManager] = []  # Replacements still starting
+        self._recycle_threads: List[threading.Thread] = []
+
+        # Per-daemon resource accounting from the spawned process trees
+        self.resources = DaemonResourceCollector(self, interval=resource_interval)
+
         # Health monitoring
         self.health_monitor_thread: Optional[threading.Thread] = None
         self.shutdown_event = threading.Event()
@@ -120,7 +249,55 @@ class FdoDaemonPoolManager:
         # Pool root directory
         self.pool_root = "/tmp/fdo_daemon_pool"
 
-        logger.info(f"Initialized FdoDaemonPoolManager: size={pool_size}, ports={base_port}-{base_port + pool_size - 1}")
+        # Wine prefix sharding: clones of the pre-initialized prefix from the image
+        self.wine_prefix_shards = min(wine_prefix_shards, pool_size) if wine_prefix_shards > 1 else 0
+        self.base_wine_prefix = os.environ.get("WINEPREFIX", os.path.expanduser("~/.wine"))
+        self.prefix_root = os.path.join(self.pool_root, "prefixes")
+
+        # Cgroup-aware sizing and CPU pinning
+        self.cpu_affinity = cpu_affinity
+        self.reserved_cpus = reserved_cpus
+        self.memory_fraction = memory_fraction
+        self.measured_daemon_rss: Optional[int] = None
+        self._core_sets: List[List[int]] = []
+
+        logger.info(
+            f"Initialized FdoDaemonPoolManager: size={pool_size}, ports={base_port}-{base_port + pool_size - 1}, "
+            f"wine_prefix_shards={self.wine_prefix_shards or 'shared'}"
+        )
+
+    @classmethod
+    def from_env(cls, exe_path: str, bind_host: str = "127.0.0.1") -> "FdoDaemonPoolManager":
+        """Build from FDO_DAEMON_* environment variables (FDO_DAEMON_POOL_SIZE=auto sizes from cgroup limits)."""
+        pool_size_setting = os.getenv("FDO_DAEMON_POOL_SIZE", "5")
+        return cls(
+            exe_path=exe_path,
+            pool_size=0 if pool_size_setting.lower() == "auto" else int(pool_size_setting),
+            base_port=int(os.getenv("FDO_DAEMON_POOL_BASE_PORT", "8080")),
+            bind_host=bind_host,
+            restart_delay=float(os.getenv("FDO_DAEMON_RESTART_DELAY", "2.0")),
+            health_interval=float(os.getenv("FDO_DAEMON_HEALTH_INTERVAL", "10.0")),
+            max_restart_attempts=int(os.getenv("FDO_DAEMON_MAX_RESTART_ATTEMPTS", "5")),
+            restart_window=float(os.getenv("FDO_DAEMON_RESTART_WINDOW", "600")),
+            circuit_breaker_threshold=int(os.getenv("FDO_DAEMON_CIRCUIT_BREAKER_THRESHOLD", "3")),
+            ewma_alpha=float(os.getenv("FDO_DAEMON_EWMA_ALPHA", "0.2")),
+            eject_factor=float(os.getenv("FDO_DAEMON_EJECT_FACTOR", "3.0")),
+            eject_max_fraction=float(os.getenv("FDO_DAEMON_EJECT_MAX_FRACTION", "0.2")),
+            eject_duration=float(os.getenv("FDO_DAEMON_EJECT_DURATION", "30.0")),
+            eject_min_samples=int(os.getenv("FDO_DAEMON_EJECT_MIN_SAMPLES", "20")),
+            stuck_request_timeout=float(os.getenv("FDO_DAEMON_STUCK_REQUEST_TIMEOUT", "30.0")),
+            timeouts=AdaptiveTimeouts.from_env(),
+            recycle_max_requests=int(os.getenv("FDO_DAEMON_RECYCLE_MAX_REQUESTS", "0")),
+            recycle_max_rss_mb=float(os.getenv("FDO_DAEMON_RECYCLE_MAX_RSS_MB", "0")),
+            recycle_max_age=float(os.getenv("FDO_DAEMON_RECYCLE_MAX_AGE", "0")),
+            recycle_max_fraction=float(os.getenv("FDO_DAEMON_RECYCLE_MAX_FRACTION", "0.2")),
+            resource_interval=float(os.getenv("FDO_DAEMON_RESOURCE_INTERVAL", "5.0")),
+            wine_prefix_shards=int(os.getenv("FDO_WINE_PREFIX_SHARDS", "0")),
+            cpu_affinity=os.getenv("FDO_DAEMON_CPU_AFFINITY", "false").lower() == "true",
+            reserved_cpus=int(os.getenv("FDO_API_RESERVED_CPUS", "1")),
+            memory_fraction=float(os.getenv("FDO_DAEMON_MEMORY_FRACTION", "0.8")),
+            slots_per_daemon=int(os.getenv("FDO_DAEMON_SLOTS", "1"))
+        )
 
     def start(self) -> None:
         """
@@ -134,14 +311,20 @@ class FdoDaemonPoolManager:
         # Create pool root directory
         os.makedirs(self.pool_root, exist_ok=True)
 
-        # Start each daemon instance
+        if self.cpu_affinity and not self.auto_size:
+            self._core_sets = core_sets(self.pool_size, self.reserved_cpus)
+
+        # Start each daemon instance (with auto sizing, the pool size is fixed once daemon_0 is measured)
         successful_starts = 0
-        for i in range(self.pool_size):
+        i = 0
+        while i < self.pool_size:
             try:
                 instance = self._create_and_start_instance(i)
                 self.instances.append(instance)
                 successful_starts += 1
                 logger.info(f"Started {instance.id} on port {instance.port}")
+                if i == 0 and self.auto_size:
+                    self._auto_size_pool(instance)
             except Exception as e:
                 logger.error(f"Failed to start daemon_{i}: {e}")
                 # Create placeholder instance in failed state
@@ -150,9 +333,11 @@ class FdoDaemonPoolManager:
                     port=self.base_port + i,
                     working_dir="",
                     bind_host=self.bind_host,
-                    state="crashed"
+                    state="crashed",
+                    slots=self.slots_per_daemon
                 )
                 self.instances.append(instance)
+            i += 1
 
         # Validate startup success rate
         success_rate = successful_starts / self.pool_size
@@ -172,6 +357,10 @@ class FdoDaemonPoolManager:
         self.health_monitor_thread.start()
         logger.info("Health monitoring thread started")
 
+        self.resources.start()
+
+        self.register_metrics()
+
     def stop(self) -> None:
         """Stop all daemons and health monitor."""
         logger.info("Stopping daemon pool...")
@@ -180,10 +369,19 @@ class FdoDaemonPoolManager:
         self.shutdown_event.set()
         if self.health_monitor_thread:
             self.health_monitor_thread.join(timeout=5.0)
+        self.resources.stop()
 
-        # Stop all daemon instances
+        # Stop replacements still starting, and wait for their recycle threads to see it
         with self.lock:
-            for instance in self.instances:
+            replacements = list(self._replacements)
+        for manager in replacements:
+            manager.stop()
+        for thread in self._recycle_threads:
+            thread.join(timeout=5.0)
+
+        # Stop all daemon instances, including replaced ones still draining
+        with self.lock:
+            for instance in self.instances + self.draining:
                 if instance.manager:
                     try:
                         instance.manager.stop()
@@ -191,6 +389,8 @@ class FdoDaemonPoolManager:
                     except Exception as e:
                         logger.error(f"Error stopping {instance.id}: {e}")
 
+        self._stop_wineservers()
+
         # Cleanup pool directories
         try:
             if os.path.exists(self.pool_root):
@@ -201,131 +401,328 @@ class FdoDaemonPoolManager:
 
         logger.info("Daemon pool stopped")
 
-    async def get_healthy_instance(self) -> Optional[DaemonInstance]:
+    def capacity(self) -> int:
+        """Total request slots across the pool."""
+        return sum(instance.slots for instance in self.instances)
+
+    def idle_instances(self) -> List[DaemonInstance]:
         """
-        Get next idle daemon, preferring daemons not currently processing requests.
+        Healthy daemons with a free slot and a closed circuit breaker that are not ejected.
 
-        This ensures requests are distributed to idle daemons when available,
-        preventing queue buildup on busy daemons.
+        Ejections that have expired are cleared here, so the daemon is re-probed
+        with fresh latency history.
+        """
+        now = time.time()
+        idle = []
+        for instance in self.instances:
+            if (instance.state != "healthy" or
+                instance.circuit_breaker_open or
+                not instance.has_free_slot):
+                continue
+
+            if instance.ejected_until:
+                if instance.ejected_until > now:
+                    continue
+                # Ejection served - re-probe with fresh latency history
+                instance.ejected_until = 0.0
+                instance.reset_latency()
+                logger.info(f"{instance.id} returned from latency ejection")
 
-        Uses async lock to prevent event loop blocking and enable true parallelization.
+            idle.append(instance)
+        return idle
+
+    def select_idle_instance(self, idle: List[DaemonInstance],
+                             avoid: Optional[Set[str]] = None) -> DaemonInstance:
+        """
+        Pick the least loaded, then fastest, of the given idle daemons.
+
+        Load is the number of occupied slots; speed is the EWMA service time.
+        Daemons without latency history score zero so they are probed first.
+        Ties are broken by a rotating start index so equally fast daemons
+        share load.
+
+        Args:
+            idle: Candidates from idle_instances() (must not be empty)
+            avoid: Daemon ids to use only if no other daemon is idle (e.g. ones a retry already failed on)
+        """
+        count = len(self.instances)
+        positions = {id(instance): index for index, instance in enumerate(self.instances)}
+        best = None
+        best_rank = None
+
+        for instance in idle:
+            position = (positions[id(instance)] - self.current_index) % count
+            # Avoided daemons rank after every other idle daemon
+            rank = (instance.id in avoid if avoid else False, instance.in_flight,
+                    instance.ewma_service_time or 0.0, position)
+            if best is None or rank < best_rank:
+                best, best_rank = instance, rank
+
+        self.current_index = (self.current_index + best_rank[-1] + 1) % count
+        return best
+
+    def acquire_slot(self, instance: DaemonInstance, lane: Optional[str] = None) -> DaemonSlot:
+        """Occupy a free slot on a daemon (caller checked has_free_slot). Runs on the event loop."""
+        used = {slot.index for slot in instance.active}
+        index = next(i for i in range(instance.slots) if i not in used)
+        slot = DaemonSlot(instance=instance, index=index, lane=lane)
+        instance.active.append(slot)
+        return slot
+
+    def free_slot(self, slot: DaemonSlot) -> None:
+        """Give a slot back without waking waiters (no-op if the daemon was reset meanwhile)."""
+        slot.instance.active = [s for s in slot.instance.active if s is not slot]
+
+    async def get_healthy_instance(self, avoid: Optional[Set[str]] = None) -> Optional[DaemonSlot]:
+        """
+        Check out a slot on the best idle daemon without waiting.
+
+        Bypasses the scheduling lanes; the request path uses
+        get_healthy_instance_async instead.
+
+        Args:
+            avoid: Daemon ids to use only if no other daemon is idle
 
         Returns:
-            DaemonInstance if idle daemon available, None otherwise
+            DaemonSlot if a daemon has a free slot, None otherwise
         """
         async with self.async_lock:
-            if not self.instances:
+            idle = self.idle_instances()
+            if not idle:
                 return None
 
-            # First pass: Try to find an idle daemon (not currently processing)
-            # Start from current_index for fair distribution
-            for _ in range(len(self.instances)):
-                instance = self.instances[self.current_index]
-                self.current_index = (self.current_index + 1) % len(self.instances)
-
-                # Check if instance is healthy, idle, and circuit breaker is closed
-                if (instance.state == "healthy" and
-                    not instance.circuit_breaker_open and
-                    not instance.is_processing):
-                    # Mark as busy before returning
-                    instance.is_processing = True
-                    instance.request_started_at = time.time()
-                    return instance
-
-            # No idle daemon available
-            return None
+            return self.acquire_slot(self.select_idle_instance(idle, avoid))
+
+    async def try_checkout(self, lane: str, avoid: Optional[Set[str]] = None) -> Optional[DaemonSlot]:
+        """Check out a slot only if one is free with nothing queued (see PoolScheduler.try_checkout)."""
+        async with self.async_lock:
+            return self.scheduler.try_checkout(lane, avoid)
+
+    async def release_slot(self, slot: DaemonSlot) -> None:
+        """Free a checked-out slot and hand it to the next waiting request."""
+        async with self.async_lock:
+            self.scheduler.record_release(slot)
+            self.free_slot(slot)
+            self.scheduler.dispatch()
+
+    async def record_request_result(self, instance: DaemonInstance, success: bool,
+                                    service_time: Optional[float] = None) -> None:
+        """
+        Update request counters, circuit breaker and latency score for a finished request.
 
-    async def get_healthy_instance_async(self, timeout: float = 5.0) -> Optional[DaemonInstance]:
+        Args:
+            instance: Daemon that served the request
+            success: Whether the request succeeded
+            service_time: Round trip time in seconds (successful requests feed the EWMA)
         """
-        Get next idle daemon, waiting if all are busy.
+        async with self.async_lock:
+            instance.total_requests += 1
+            instance.requests_since_start += 1
 
-        This method polls for available daemons with a brief sleep between attempts,
-        allowing requests to queue gracefully when the pool is temporarily saturated.
+            if success:
+                instance.consecutive_failures = 0
+
+                # Close circuit breaker if it was open
+                if instance.circuit_breaker_open:
+                    instance.circuit_breaker_open = False
+                    CIRCUIT_BREAKER_TRANSITIONS.inc(instance.id, "closed")
+                    logger.info(f"Circuit breaker closed for {instance.id} (successful request)")
+
+                if service_time is not None:
+                    self._update_latency(instance, service_time)
+                return
+
+            instance.failed_requests += 1
+            instance.consecutive_failures += 1
+
+            # Open circuit breaker if threshold exceeded
+            if instance.consecutive_failures >= self.circuit_breaker_threshold:
+                if not instance.circuit_breaker_open:
+                    CIRCUIT_BREAKER_TRANSITIONS.inc(instance.id, "open")
+                instance.circuit_breaker_open = True
+                instance.state = "unhealthy"
+                logger.warning(
+                    f"Circuit breaker opened for {instance.id} "
+                    f"({instance.consecutive_failures} consecutive failures)"
+                )
+
+    def _update_latency(self, instance: DaemonInstance, service_time: float) -> None:
+        """Fold a sample into the instance EWMA and eject it if it has become an outlier."""
+        if instance.ewma_service_time is None:
+            instance.ewma_service_time = service_time
+        else:
+            instance.ewma_service_time += self.ewma_alpha * (service_time - instance.ewma_service_time)
+        instance.latency_samples += 1
+
+        if instance.latency_samples < self.eject_min_samples or self.eject_factor <= 0:
+            return
+
+        median = self._median_service_time()
+        if not median or instance.ewma_service_time <= self.eject_factor * median:
+            return
+
+        now = time.time()
+        ejected = sum(1 for i in self.instances if i.ejected_until > now)
+        if ejected >= self._max_ejected():
+            return
+
+        instance.ejected_until = now + self.eject_duration
+        instance.ejection_count += 1
+        DAEMON_EJECTIONS.inc(instance.id)
+        logger.warning(
+            f"Ejecting {instance.id} for {self.eject_duration:.0f}s: EWMA service time "
+            f"{instance.ewma_service_time * 1000:.1f}ms vs pool median {median * 1000:.1f}ms"
+        )
+
+    def _median_service_time(self) -> Optional[float]:
+        """Median EWMA across daemons with enough samples to be trusted."""
+        scores = [i.ewma_service_time for i in self.instances
+                  if i.ewma_service_time is not None and i.latency_samples >= self.eject_min_samples]
+        return statistics.median(scores) if len(scores) >= 2 else None
+
+    def _max_ejected(self) -> int:
+        """Ejection budget: a fraction of the pool, at least one daemon for pools of three or more."""
+        count = len(self.instances)
+        if count < 3:
+            return 0
+        return max(1, int(count * self.eject_max_fraction))
+
+    async def get_healthy_instance_async(self, timeout: float = 5.0,
+                                         avoid: Optional[Set[str]] = None,
+                                         lane: Optional[str] = None,
+                                         size: int = 0) -> Optional[DaemonSlot]:
+        """
+        Check out a daemon slot, waiting in a scheduling lane if none can be granted.
+
+        Waiters are woken as daemons are released rather than polling; see
+        PoolScheduler for how lanes share the pool.
 
         Args:
             timeout: Maximum time to wait for an available daemon (seconds)
+            avoid: Daemon ids to use only if no other daemon is idle
+            lane: Scheduling lane (defaults to the lane set for the current request)
+            size: Input size in bytes; large inputs are scheduled in the large lane
 
         Returns:
-            DaemonInstance if available within timeout, None otherwise
+            DaemonSlot if available within timeout, None otherwise
         """
-        import asyncio
-
+        lane = self.scheduler.resolve_lane(lane, size)
         start_time = time.time()
-        poll_interval = 0.01  # 10ms between checks (reduced from 50ms for faster batch transitions)
-        attempts = 0
-
-        while time.time() - start_time < timeout:
-            attempts += 1
-
-            # Try to get an idle daemon
-            instance = await self.get_healthy_instance()
-            if instance:
-                elapsed = time.time() - start_time
-                if elapsed > 0.1:  # Log if we had to wait
-                    logger.info(
-                        f"Daemon {instance.id} available after {elapsed:.2f}s wait "
-                        f"({attempts} attempts)"
-                    )
-                return instance
 
-            # No daemon available - wait briefly before retrying
-            await asyncio.sleep(poll_interval)
+        slot = await self.scheduler.checkout(lane, avoid, timeout, size)
 
-        # Timeout reached
         elapsed = time.time() - start_time
+        if slot:
+            if elapsed > 0.1:  # Log if we had to wait
+                logger.info(f"Daemon {slot.instance.id} available after {elapsed:.2f}s wait (lane={lane})")
+            return slot
+
         logger.warning(
             f"No healthy daemon available after {elapsed:.2f}s timeout "
-            f"({attempts} attempts, pool_size={len(self.instances)})"
+            f"(lane={lane}, pool_size={len(self.instances)})"
         )
         return None
 
-    def restart_instance(self, instance: DaemonInstance) -> bool:
+    def recycle_instance(self, instance: DaemonInstance, reason: str) -> None:
+        """
+        Take a daemon out of rotation now and restart it in the background.
+
+        Used when a request to it timed out: the daemon is most likely wedged
+        in Ada32, so it is restarted right away instead of on the next health
+        sweep. Must be called from the event loop.
+
+        Args:
+            instance: Daemon to recycle
+            reason: Why the restart happened (metrics label)
+        """
+        if instance.state == "restarting" or not self._in_pool(instance):
+            return  # Already restarting, or replaced by a rolling recycle and draining
+        instance.state = "restarting"  # Not dispatched again until the restart completes
+        logger.warning(f"Recycling {instance.id} ({reason})")
+        asyncio.get_running_loop().run_in_executor(None, self.restart_instance, instance, reason)
+
+    def restart_instance(self, instance: DaemonInstance, reason: str = "manual") -> bool:
         """
         Restart a specific daemon instance.
 
+        The lock is only held to mark the instance and to swap in the new
+        process; stopping, the restart delay and startup run without it so
+        status reads and checkouts are not blocked. A restart over the window
+        budget marks the daemon crashed and leaves it to the health sweep,
+        which retries once the window allows.
+
         Args:
             instance: DaemonInstance to restart
+            reason: Why the restart happened (metrics label)
 
         Returns:
             True if restart successful, False otherwise
         """
         with self.lock:
-            if instance.restart_count >= self.max_restart_attempts:
-                logger.error(f"Max restart attempts reached for {instance.id}")
+            if not self._restart_allowed(instance):
+                if instance.restart_pending is None:
+                    logger.error(
+                        f"Restart of {instance.id} refused: {self.max_restart_attempts} restarts "
+                        f"within {self.restart_window:.0f}s, retrying when the window allows"
+                    )
+                instance.state = "crashed"
+                instance.restart_pending = reason
                 return False
 
             instance.state = "restarting"
+            instance.restart_pending = None
             instance.restart_count += 1
+            instance.restart_times.append(time.time())
+            instance.active = []  # Requests on the old process fail; their releases become no-ops
+            old_manager = instance.manager
+            DAEMON_RESTARTS.inc(instance.id, reason)
 
-            logger.info(f"Restarting {instance.id} (attempt {instance.restart_count}/{self.max_restart_attempts})...")
+        logger.info(f"Restarting {instance.id} (attempt {len(instance.restart_times)}/{self.max_restart_attempts})...")
 
-            try:
-                # Stop existing manager
-                if instance.manager:
-                    instance.manager.stop()
+        manager = None
+        try:
+            # Stop existing manager
+            if old_manager:
+                old_manager.stop()
 
-                # Wait before restart
-                time.sleep(self.restart_delay)
+            # Wait before restart
+            time.sleep(self.restart_delay)
 
-                # Start new manager
-                instance.manager = FdoDaemonManager(
-                    exe_path=self.exe_path,
-                    bind_host=instance.bind_host,
-                    port=instance.port
-                )
-                instance.manager.start()
+            # Start new manager
+            manager = self._daemon_manager(instance.port, instance.wine_prefix, instance.cpus)
+            manager.start()
 
-                instance.state = "healthy"
-                instance.consecutive_failures = 0
+        except Exception as e:
+            logger.error(f"Failed to restart {instance.id}: {e}")
+            with self.lock:
+                instance.manager = manager or old_manager
+                instance.state = "crashed"
+            return False
+
+        with self.lock:
+            instance.manager = manager
+            instance.active = []
+            instance.state = "healthy"
+            instance.consecutive_failures = 0
+            instance.ejected_until = 0.0
+            instance.started_at = time.time()
+            instance.requests_since_start = 0
+            instance.rss_bytes = None
+            instance.reset_latency()
+            if instance.circuit_breaker_open:
                 instance.circuit_breaker_open = False
+                CIRCUIT_BREAKER_TRANSITIONS.inc(instance.id, "closed")
 
-                logger.info(f"Successfully restarted {instance.id}")
-                return True
+        if self.shutdown_event.is_set():
+            manager.stop()  # The pool stopped while this daemon was starting
+        logger.info(f"Successfully restarted {instance.id}")
+        return True
 
-            except Exception as e:
-                logger.error(f"Failed to restart {instance.id}: {e}")
-                instance.state = "crashed"
-                return False
+    def _restart_allowed(self, instance: DaemonInstance) -> bool:
+        """Whether the daemon's restarts within the window leave room for another."""
+        cutoff = time.time() - self.restart_window
+        instance.restart_times = [t for t in instance.restart_times if t > cutoff]
+        return len(instance.restart_times) < self.max_restart_attempts
 
     def get_pool_status(self) -> Dict[str, Any]:
         """
@@ -346,9 +743,14 @@ class FdoDaemonPoolManager:
             total_restarts = sum(i.restart_count for i in self.instances)
 
             # Load balancing metrics
-            concurrent_requests = sum(1 for i in self.instances if i.is_processing)
+            now = time.time()
+            concurrent_requests = sum(i.in_flight for i in self.instances)
             idle_daemons = sum(1 for i in self.instances
                              if i.state == "healthy" and not i.is_processing)
+            free_slots = sum(i.slots - i.in_flight for i in self.instances if i.state == "healthy")
+            ejected_instances = sum(1 for i in self.instances if i.ejected_until > now)
+            median = self._median_service_time()
+            recycling = sum(1 for i in self.instances if i.recycling)
 
             return {
                 "pool_size": self.pool_size,
@@ -360,24 +762,97 @@ class FdoDaemonPoolManager:
                 "daemon_restarts": total_restarts,
                 "concurrent_requests": concurrent_requests,
                 "idle_daemons": idle_daemons,
+                "slots_per_daemon": self.slots_per_daemon,
+                "free_slots": free_slots,
+                "ejected_instances": ejected_instances,
+                "median_service_ms": round(median * 1000, 3) if median else None,
                 "instances_by_state": instances_by_state,
+                "lanes": self.scheduler.get_status(),
+                "request_timeouts": self.timeouts.get_status(),
+                "sizing": {
+                    "auto": self.auto_size,
+                    "cpu_quota": cpu_quota(),
+                    "memory_limit_mb": round(memory_limit() / 1024 / 1024, 1) if memory_limit() else None,
+                    "measured_daemon_rss_mb": (round(self.measured_daemon_rss / 1024 / 1024, 1)
+                                               if self.measured_daemon_rss else None),
+                    "cpu_affinity": self.cpu_affinity,
+                    "reserved_cpus": self.reserved_cpus
+                },
+                "recycling": {
+                    "in_progress": recycling,
+                    "draining": len(self.draining),
+                    "max_concurrent": self._max_recycling(),
+                    "max_requests": self.recycle_max_requests or None,
+                    "max_rss_mb": round(self.recycle_max_rss_bytes / 1024 / 1024, 1) if self.recycle_max_rss_bytes else None,
+                    "max_age_s": self.recycle_max_age or None
+                },
                 "instances": [
                     {
                         "id": instance.id,
                         "port": instance.port,
                         "state": instance.state,
                         "restart_count": instance.restart_count,
+                        "restart_pending": instance.restart_pending,
                         "consecutive_failures": instance.consecutive_failures,
                         "total_requests": instance.total_requests,
                         "failed_requests": instance.failed_requests,
                         "circuit_breaker_open": instance.circuit_breaker_open,
                         "last_health_check": instance.last_health_check,
-                        "is_processing": instance.is_processing
+                        "is_processing": instance.is_processing,
+                        "slots": instance.slots,
+                        "in_flight": instance.in_flight,
+                        "lanes": [slot.lane for slot in instance.active],
+                        "wine_prefix": instance.wine_prefix,
+                        "cpus": instance.cpus,
+                        "ewma_service_ms": (round(instance.ewma_service_time * 1000, 3)
+                                            if instance.ewma_service_time is not None else None),
+                        "latency_samples": instance.latency_samples,
+                        "ejected": instance.ejected_until > now,
+                        "ejected_until": instance.ejected_until or None,
+                        "ejection_count": instance.ejection_count,
+                        "age_s": round(now - instance.started_at, 1),
+                        "requests_since_start": instance.requests_since_start,
+                        "rss_mb": round(instance.rss_bytes / 1024 / 1024, 1) if instance.rss_bytes else None,
+                        "recycle_count": instance.recycle_count,
+                        "recycling": instance.recycling
                     }
                     for instance in self.instances
                 ]
             }
 
+    def register_metrics(self) -> None:
+        """Export pool state gauges, evaluated at scrape time."""
+        def instances_by_state():
+            counts: Dict[str, int] = {}
+            for instance in list(self.instances):
+                counts[instance.state] = counts.get(instance.state, 0) + 1
+            return [((state,), count) for state, count in counts.items()]
+
+        POOL_INSTANCES.set_function(instances_by_state)
+        POOL_BUSY_INSTANCES.set_function(
+            lambda: [((), sum(1 for i in list(self.instances) if i.is_processing))]
+        )
+        POOL_LANE_WAITING.set_function(
+            lambda: [((lane,), status["waiting"]) for lane, status in self.scheduler.get_status().items()]
+        )
+        POOL_LANE_BUSY.set_function(
+            lambda: [((lane,), status["busy"]) for lane, status in self.scheduler.get_status().items()]
+        )
+
+        DAEMON_RSS_BYTES.set_function(
+            lambda: [((daemon_id,), stats["rss_bytes"])
+                     for daemon_id, stats in self.resources.snapshot()["daemons"].items()]
+        )
+        DAEMON_CPU_SECONDS.set_function(
+            lambda: [((daemon_id,), stats["cpu_seconds"])
+                     for daemon_id, stats in self.resources.snapshot()["daemons"].items()]
+        )
+        DAEMON_CONTEXT_SWITCHES.set_function(
+            lambda: [((daemon_id, kind), stats[f"{kind}_ctxt_switches"])
+                     for daemon_id, stats in self.resources.snapshot()["daemons"].items()
+                     for kind in ("voluntary", "involuntary")]
+        )
+
     def reset_circuit_breakers(self) -> int:
         """
         Reset all circuit breakers.
@@ -392,6 +867,7 @@ class FdoDaemonPoolManager:
                     instance.circuit_breaker_open = False
                     instance.consecutive_failures = 0
                     instance.state = "healthy"
+                    CIRCUIT_BREAKER_TRANSITIONS.inc(instance.id, "closed")
                     count += 1
                     logger.info(f"Reset circuit breaker for {instance.id}")
 
@@ -409,15 +885,14 @@ class FdoDaemonPoolManager:
             id=f"daemon_{instance_id}",
             port=port,
             working_dir=working_dir,
-            bind_host=self.bind_host
+            bind_host=self.bind_host,
+            wine_prefix=self._provision_wine_prefix(instance_id),
+            slots=self.slots_per_daemon,
+            cpus=self._core_sets[instance_id] if instance_id < len(self._core_sets) else None
         )
 
         # Create and start daemon manager
-        manager = FdoDaemonManager(
-            exe_path=self.exe_path,
-            bind_host=self.bind_host,
-            port=port
-        )
+        manager = self._daemon_manager(port, instance.wine_prefix, instance.cpus)
         manager.start()
 
         instance.manager = manager
@@ -468,6 +943,90 @@ class FdoDaemonPoolManager:
         logger.debug(f"Provisioned daemon directory: {daemon_dir}")
         return daemon_dir
 
+    def _daemon_manager(self, port: int, wine_prefix: Optional[str],
+                        cpus: Optional[List[int]] = None) -> FdoDaemonManager:
+        """Daemon process manager for a port, running under a sharded prefix and CPU set if given."""
+        return FdoDaemonManager(
+            exe_path=self.exe_path,
+            bind_host=self.bind_host,
+            port=port,
+            env={"WINEPREFIX": wine_prefix} if wine_prefix else None,
+            cpus=cpus,
+            threads=self.slots_per_daemon
+        )
+
+    def _auto_size_pool(self, first: DaemonInstance) -> None:
+        """
+        Fix the pool size from the cgroup limits and the first daemon's measured
+        RSS, then assign core sets (pinning the already running first daemon).
+        """
+        pids = first.manager.process_tree() if first.manager else []
+        samples = [sample for sample in (read_process(pid) for pid in pids) if sample]
+        self.measured_daemon_rss = sum(sample.rss_bytes for sample in samples) or None
+
+        upper_bound = self.pool_size
+        self.pool_size = default_pool_size(self.measured_daemon_rss, self.reserved_cpus,
+                                           self.memory_fraction, upper_bound)
+        logger.info(
+            f"Auto-sized pool to {self.pool_size} daemons (cpu_quota={cpu_quota()}, "
+            f"memory_limit={memory_limit()}, daemon_rss={self.measured_daemon_rss})"
+        )
+
+        if self.cpu_affinity:
+            self._core_sets = core_sets(self.pool_size, self.reserved_cpus)
+            first.cpus = first.manager.cpus = self._core_sets[0]
+            pin_pids(first.manager.process_tree(), first.cpus)
+
+    def _provision_wine_prefix(self, instance_id: int) -> Optional[str]:
+        """
+        Wine prefix for a daemon when prefixes are sharded.
+
+        Daemons are assigned to shards round-robin. Each shard is a copy of the
+        pre-initialized base prefix (so no wineboot on startup) and gets its own
+        wineserver, removing cross-shard contention on wineserver's global lock.
+
+        Args:
+            instance_id: Instance number
+
+        Returns:
+            Prefix path, or None when sharding is disabled
+        """
+        if not self.wine_prefix_shards:
+            return None
+
+        shard = instance_id % self.wine_prefix_shards
+        prefix = os.path.join(self.prefix_root, f"shard_{shard}")
+        if os.path.isdir(prefix):
+            return prefix
+
+        os.makedirs(self.prefix_root, exist_ok=True)
+        if os.path.isdir(self.base_wine_prefix):
+            staging = f"{prefix}.tmp"
+            shutil.rmtree(staging, ignore_errors=True)
+            # symlinks=True keeps dosdevices (c: -> ../drive_c, z: -> /) relative to the clone
+            shutil.copytree(self.base_wine_prefix, staging, symlinks=True)
+            os.rename(staging, prefix)
+            logger.info(f"Cloned Wine prefix {self.base_wine_prefix} -> {prefix}")
+        else:
+            # Nothing to clone; Wine initializes the prefix on first use
+            logger.warning(f"Base Wine prefix {self.base_wine_prefix} not found, {prefix} starts empty")
+            os.makedirs(prefix, exist_ok=True)
+        return prefix
+
+    def _stop_wineservers(self) -> None:
+        """Shut down the wineservers of sharded prefixes before their directories are removed."""
+        if not self.wine_prefix_shards or not shutil.which("wineserver"):
+            return
+        for shard in range(self.wine_prefix_shards):
+            prefix = os.path.join(self.prefix_root, f"shard_{shard}")
+            if not os.path.isdir(prefix):
+                continue
+            try:
+                subprocess.run(["wineserver", "-k"], env={**os.environ, "WINEPREFIX": prefix},
+                               timeout=10, check=False, capture_output=True)
+            except (OSError, subprocess.TimeoutExpired) as e:
+                logger.warning(f"Failed to stop wineserver for {prefix}: {e}")
+
     def _health_monitor_loop(self) -> None:
         """Background thread for continuous health checks."""
         logger.info("Health monitor loop started")
@@ -479,6 +1038,7 @@ class FdoDaemonPoolManager:
                     break  # Shutdown requested
 
                 self._perform_health_checks()
+                self._schedule_recycles()
 
             except Exception as e:
                 logger.error(f"Error in health monitor loop: {e}", exc_info=True)
@@ -486,33 +1046,44 @@ class FdoDaemonPoolManager:
         logger.info("Health monitor loop stopped")
 
     def _perform_health_checks(self) -> None:
-        """Perform health checks on all daemon instances."""
+        """Perform health checks on all daemon instances, then restart the ones that need it."""
+        restarts: List[Tuple[DaemonInstance, str]] = []
         with self.lock:
             for instance in self.instances:
-                if not instance.manager:
+                if not instance.manager or instance.state == "restarting":
                     continue
 
-                # Check for stuck requests (timeout detection)
-                if instance.is_processing and instance.request_started_at:
-                    elapsed = time.time() - instance.request_started_at
-                    request_timeout = 30.0  # 30 second timeout for requests
-
-                    if elapsed > request_timeout:
-                        logger.warning(
-                            f"Request timeout detected on {instance.id}: "
-                            f"request running for {elapsed:.1f}s (timeout: {request_timeout}s)"
-                        )
-                        # Clear processing flag - request is considered failed
-                        instance.is_processing = False
-                        instance.request_started_at = None
-                        instance.state = "unhealthy"
-                        instance.consecutive_failures += 1
+                # A restart refused by the window budget is retried here; until then the daemon stays out
+                if instance.restart_pending:
+                    restarts.append((instance, instance.restart_pending))
+                    continue
+
+                # Check for stuck requests (backstop: timed-out requests recycle their daemon immediately)
+                now = time.time()
+                stuck = [slot for slot in list(instance.active)
+                         if now > (slot.deadline or slot.started_at + self.stuck_request_timeout)]
+                if stuck:
+                    slot = stuck[0]
+                    logger.warning(
+                        f"Request timeout detected on {instance.id} slot {slot.index}: "
+                        f"request running for {now - slot.started_at:.1f}s"
+                    )
+                    # Every slot's request is considered failed: the restart kills them all
+                    instance.active = []
+                    instance.state = "unhealthy"
+                    instance.consecutive_failures += 1
+
+                    logger.info(f"Attempting automatic restart of {instance.id} due to stuck request...")
+                    restarts.append((instance, "stuck_request"))
+                    continue
 
-                        # Trigger restart if needed
-                        if instance.restart_count < self.max_restart_attempts:
-                            logger.info(f"Attempting automatic restart of {instance.id} due to stuck request...")
-                            self.restart_instance(instance)
-                        continue
+                # A daemon that exited (e.g. Ada32 crashed) only fails health checks; restart it
+                if instance.manager.pid is None:
+                    instance.state = "crashed"
+                    instance.active = []
+                    logger.warning(f"Daemon process for {instance.id} has exited")
+                    restarts.append((instance, "crash"))
+                    continue
 
                 try:
                     # Quick health check via daemon manager
@@ -527,6 +1098,7 @@ class FdoDaemonPoolManager:
                         if instance.circuit_breaker_open:
                             instance.circuit_breaker_open = False
                             instance.consecutive_failures = 0
+                            CIRCUIT_BREAKER_TRANSITIONS.inc(instance.id, "closed")
                             logger.info(f"Circuit breaker closed for {instance.id} (health check passed)")
                     else:
                         # Daemon unhealthy
@@ -539,6 +1111,144 @@ class FdoDaemonPoolManager:
                     logger.warning(f"Health check failed for {instance.id}: {e}")
 
                     # Attempt automatic restart
-                    if instance.restart_count < self.max_restart_attempts:
-                        logger.info(f"Attempting automatic restart of {instance.id}...")
-                        self.restart_instance(instance)
+                    logger.info(f"Attempting automatic restart of {instance.id}...")
+                    restarts.append((instance, "health_check"))
+
+        for instance, reason in restarts:
+            if self._in_pool(instance) and not self.shutdown_event.is_set():
+                self.restart_instance(instance, reason=reason)
+
+    # Rolling recycling
+
+    def _in_pool(self, instance: DaemonInstance) -> bool:
+        """Whether the instance is still a pool member (not replaced and draining)."""
+        return any(member is instance for member in self.instances)
+
+    def _max_recycling(self) -> int:
+        """Recycle budget: a fraction of the pool, at least one daemon."""
+        return max(1, int(len(self.instances) * self.recycle_max_fraction))
+
+    def _recycle_reason(self, instance: DaemonInstance, now: float) -> Optional[str]:
+        """Which recycle limit a daemon has passed, if any."""
+        if self.recycle_max_requests and instance.requests_since_start >= self.recycle_max_requests:
+            return "max_requests"
+        if self.recycle_max_rss_bytes and instance.rss_bytes and instance.rss_bytes >= self.recycle_max_rss_bytes:
+            return "max_rss"
+        if self.recycle_max_age and now - instance.started_at >= self.recycle_max_age:
+            return "max_age"
+        return None
+
+    def _schedule_recycles(self) -> None:
+        """
+        Start replacements for daemons past a recycle limit, oldest first,
+        within the concurrent recycle budget.
+        """
+        if not (self.recycle_max_requests or self.recycle_max_rss_bytes or self.recycle_max_age):
+            return
+
+        now = time.time()
+        with self.lock:
+            budget = self._max_recycling() - sum(1 for i in self.instances if i.recycling)
+            candidates = sorted(
+                (i for i in self.instances if i.state == "healthy" and not i.recycling and i.manager),
+                key=lambda i: i.started_at
+            )
+            for instance in candidates:
+                if budget <= 0:
+                    break
+                reason = self._recycle_reason(instance, now)
+                if reason is None:
+                    continue
+                port = self._spare_port()
+                if port is None:
+                    break
+                instance.recycling = reason
+                self._reserved_ports.add(port)
+                budget -= 1
+                thread = threading.Thread(
+                    target=self._replace_instance,
+                    args=(instance, port, reason),
+                    name=f"PoolRecycle-{instance.id}",
+                    daemon=True
+                )
+                self._recycle_threads = [t for t in self._recycle_threads if t.is_alive()] + [thread]
+                thread.start()
+
+    def _spare_port(self) -> Optional[int]:
+        """Lowest port in the pool's range not used by a member, draining daemon or starting replacement."""
+        used = {i.port for i in self.instances} | {i.port for i in self.draining} | self._reserved_ports
+        for port in range(self.base_port, self.base_port + self.pool_size + self._max_recycling() * 2):
+            if port not in used and port <= 65535:
+                return port
+        return None
+
+    def _replace_instance(self, old: DaemonInstance, port: int, reason: str) -> None:
+        """
+        Surge-replace a daemon: start the replacement on a spare port while the
+        old process keeps serving, swap it into the pool once healthy, then stop
+        the old process after its in-flight request finishes.
+        """
+        logger.info(f"Recycling {old.id} ({reason}): starting replacement on port {port}")
+        manager = self._daemon_manager(port, old.wine_prefix, old.cpus)
+        with self.lock:
+            self._replacements.append(manager)
+        try:
+            if self.shutdown_event.is_set():
+                raise RuntimeError("pool is stopping")
+            manager.start()
+        except Exception as e:
+            logger.error(f"Replacement for {old.id} failed to start, keeping current process: {e}")
+            manager.stop()
+            with self.lock:
+                self._replacements.remove(manager)
+                self._reserved_ports.discard(port)
+                old.recycling = None
+            return
+
+        with self.lock:
+            self._replacements.remove(manager)
+            self._reserved_ports.discard(port)
+            old.recycling = None
+            index = next((n for n, member in enumerate(self.instances) if member is old), None)
+            if index is None or self.shutdown_event.is_set():
+                manager.stop()
+                return
+
+            replacement = DaemonInstance(
+                id=old.id,
+                port=port,
+                working_dir=old.working_dir,
+                bind_host=old.bind_host,
+                manager=manager,
+                wine_prefix=old.wine_prefix,
+                cpus=old.cpus,
+                slots=old.slots,
+                state="healthy",
+                last_health_check=time.time(),
+                restart_count=old.restart_count,
+                restart_times=old.restart_times,
+                total_requests=old.total_requests,
+                failed_requests=old.failed_requests,
+                ejection_count=old.ejection_count,
+                recycle_count=old.recycle_count + 1
+            )
+            # Old process stops taking new work; a request it is serving completes normally
+            self.instances[index] = replacement
+            old.state = "draining"
+            self.draining.append(old)
+            DAEMON_RESTARTS.inc(old.id, f"recycle_{reason}")
+
+        logger.info(f"Recycled {old.id} ({reason}): port {old.port} -> {port} after {old.requests_since_start} requests")
+
+        # A checkout that read the old state just before the swap completes within one event loop step
+        time.sleep(0.1)
+        deadline = max((slot.deadline or slot.started_at + self.stuck_request_timeout for slot in old.active),
+                       default=time.time())
+        while old.is_processing and time.time() < deadline and not self.shutdown_event.is_set():
+            time.sleep(0.05)
+
+        with self.lock:
+            if old.manager:
+                old.manager.stop()
+            self.draining = [i for i in self.draining if i is not old]
+        logger.info(f"Stopped replaced {old.id} process on port {old.port}")
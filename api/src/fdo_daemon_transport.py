@@ -0,0 +1,184 @@
+#!/usr/bin/env python3
+"""
+FDO Daemon Transport
+Minimal keep-alive HTTP/1.1 client for the daemon's fixed protocol.
+
+The daemon only ever sees POST /compile and POST /decompile with a single
+content type each, and answers with a Content-Length body. This transport
+keeps a small pool of persistent asyncio stream connections per daemon and:
+
+  - sends a request head preformatted per endpoint (only Content-Length is
+    filled in per call), with the body handed to the socket as-is rather
+    than copied into a joined buffer
+  - parses just the status line, Content-Length, Content-Type and
+    Connection from the response head
+  - returns the body as bytes; text decoding and JSON parsing only happen
+    if the caller asks for them
+
+Errors are raised as the httpx exception classes the rest of the daemon path
+already handles (timeouts recycle the daemon, everything else counts as a
+failed attempt), so FdoDaemonClient can switch transports without callers
+noticing. Enabled with FDO_DAEMON_FAST_TRANSPORT=true.
+"""
+
+from __future__ import annotations
+
+import asyncio
+import json
+from collections import deque
+from typing import Any, Deque, Dict, Optional, Tuple
+from urllib.parse import urlsplit
+
+import httpx
+
+# Longest response head accepted before the connection is considered broken
+MAX_HEAD_BYTES = 16384
+
+_Connection = Tuple[asyncio.StreamReader, asyncio.StreamWriter]
+
+
+class DaemonResponse:
+    """Response with the subset of httpx.Response used on the daemon path."""
+
+    __slots__ = ("status_code", "content", "headers")
+
+    def __init__(self, status_code: int, content: bytes, headers: Dict[str, str]):
+        self.status_code = status_code
+        self.content = content
+        self.headers = headers  # Lower-cased names
+
+    @property
+    def text(self) -> str:
+        return self.content.decode("utf-8", errors="replace")
+
+    def json(self) -> Any:
+        return json.loads(self.content)
+
+
+class DaemonTransport:
+    """Persistent-connection POST client for one daemon."""
+
+    def __init__(self, base_url: str, headers: Optional[Dict[str, str]] = None, max_connections: int = 50,
+                 max_idle: int = 20):
+        """
+        Args:
+            base_url: Daemon URL (http://host:port)
+            headers: Extra headers sent with every request (e.g. Authorization)
+            max_connections: Concurrent requests (and open connections) allowed
+            max_idle: Idle connections kept open for reuse
+        """
+        parts = urlsplit(base_url)
+        self.host = parts.hostname or "127.0.0.1"
+        self.port = parts.port or 80
+        self.max_idle = max_idle
+        self._extra = "".join(f"{name}: {value}\r\n" for name, value in (headers or {}).items())
+        self._templates: Dict[Tuple[str, str], bytes] = {}
+        self._idle: Deque[_Connection] = deque()
+        self._slots = asyncio.Semaphore(max_connections)
+        self._closed = False
+
+    def _head(self, path: str, content_type: str) -> bytes:
+        """Request head up to the Content-Length value, built once per endpoint."""
+        key = (path, content_type)
+        head = self._templates.get(key)
+        if head is None:
+            head = self._templates[key] = (
+                f"POST {path} HTTP/1.1\r\n"
+                f"Host: {self.host}:{self.port}\r\n"
+                f"Content-Type: {content_type}\r\n"
+                f"{self._extra}"
+                f"Content-Length: "
+            ).encode("latin-1")
+        return head
+
+    async def post(self, path: str, content_type: str, body: bytes, timeout: float) -> DaemonResponse:
+        """
+        POST a body and read the full response.
+
+        Raises:
+            httpx.ReadTimeout: No complete response within timeout
+            httpx.ConnectError: Daemon not accepting connections
+            httpx.RemoteProtocolError: Connection dropped or malformed response
+        """
+        if self._closed:
+            raise httpx.ConnectError("Daemon transport is closed")
+        async with self._slots:
+            try:
+                return await asyncio.wait_for(self._exchange(path, content_type, body), timeout)
+            except asyncio.TimeoutError:
+                raise httpx.ReadTimeout(f"No response from {self.host}:{self.port}{path} within {timeout:.2f}s")
+
+    async def _exchange(self, path: str, content_type: str, body: bytes) -> DaemonResponse:
+        head = self._head(path, content_type)
+        length = str(len(body)).encode("ascii")
+
+        while True:
+            reused = bool(self._idle)
+            reader, writer = self._idle.pop() if reused else await self._connect()
+            try:
+                writer.writelines((head, length, b"\r\n\r\n", body))
+                await writer.drain()
+                response, keep_alive = await self._read_response(reader)
+            except BaseException as e:
+                writer.close()
+                # A reused connection the daemon closed while idle fails before any response: retry fresh
+                if reused and isinstance(e, (ConnectionError, asyncio.IncompleteReadError)) and \
+                        not getattr(e, "partial", b""):
+                    continue
+                if isinstance(e, (ConnectionError, asyncio.IncompleteReadError, asyncio.LimitOverrunError)):
+                    raise httpx.RemoteProtocolError(f"Daemon connection failed: {e!r}") from e
+                raise
+
+            if keep_alive and not self._closed and len(self._idle) < self.max_idle:
+                self._idle.append((reader, writer))
+            else:
+                writer.close()
+            return response
+
+    async def _connect(self) -> _Connection:
+        try:
+            return await asyncio.open_connection(self.host, self.port, limit=MAX_HEAD_BYTES)
+        except OSError as e:
+            raise httpx.ConnectError(f"Cannot connect to {self.host}:{self.port}: {e}") from e
+
+    @staticmethod
+    async def _read_response(reader: asyncio.StreamReader) -> Tuple[DaemonResponse, bool]:
+        """Parse a Content-Length (or chunked) response; returns it and whether the connection is reusable."""
+        head = await reader.readuntil(b"\r\n\r\n")
+        lines = head[:-4].split(b"\r\n")
+        try:
+            version, status = lines[0].split(b" ", 2)[:2]
+            status_code = int(status)
+        except ValueError:
+            raise httpx.RemoteProtocolError(f"Malformed daemon status line: {lines[0][:64]!r}")
+
+        headers: Dict[str, str] = {}
+        for line in lines[1:]:
+            name, _, value = line.partition(b":")
+            headers[name.strip().lower().decode("latin-1")] = value.strip().decode("latin-1")
+
+        keep_alive = headers.get("connection", "").lower() != "close" and version != b"HTTP/1.0"
+        if "content-length" in headers:
+            content = await reader.readexactly(int(headers["content-length"]))
+        elif headers.get("transfer-encoding", "").lower() == "chunked":
+            parts = []
+            while True:
+                size = int((await reader.readuntil(b"\r\n")).split(b";", 1)[0], 16)
+                if size == 0:
+                    await reader.readuntil(b"\r\n")
+                    break
+                parts.append(await reader.readexactly(size))
+                await reader.readexactly(2)
+            content = b"".join(parts)
+        else:
+            content = await reader.read()  # Body runs to connection close
+            keep_alive = False
+
+        return DaemonResponse(status_code, content, headers), keep_alive
+
+    async def close(self) -> None:
+        """Close idle connections; connections in use close when their request finishes."""
+        self._closed = True
+        while self._idle:
+            _, writer = self._idle.pop()
+            writer.close()
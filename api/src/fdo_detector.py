@@ -5,11 +5,13 @@ Auto-detection engine for identifying and extracting FDO data from P3 frames.
 Combines P3 frame parsing with payload token analysis for real-time UI hints.
 """
 
-from typing import Dict, Any, Optional
+from typing import Dict, Any, List, Optional
+import os
 import logging
 import base64
 
 from p3_frame_parser import P3FrameParser, P3FrameParseError
+from p3_frame_scanner import P3FrameScanner
 from p3_payload_builder import P3PayloadBuilder
 
 logger = logging.getLogger(__name__)
@@ -18,12 +20,21 @@ class FdoDetectionError(Exception):
     """Errors specific to FDO detection operations"""
     pass
 
+class FdoBatchTooLargeError(FdoDetectionError):
+    """A batch detection request exceeds the frame or byte limit"""
+    pass
+
 class FdoDetector:
     """
     Auto-detection engine for FDO data within P3 frames.
     Optimized for real-time hint systems in frontend applications.
     """
 
+    # Maximum frames accepted by a single batch detection request
+    MAX_BATCH_FRAMES = int(os.getenv('FDO_DETECT_MAX_BATCH_FRAMES', '10000'))
+    # Maximum body size of a batch detection request (bytes)
+    MAX_BATCH_BYTES = int(os.getenv('FDO_DETECT_MAX_BATCH_BYTES', str(16 * 1024 * 1024)))
+
     @classmethod
     def detect_fdo_in_p3_frame(cls, frame_bytes: bytes) -> Dict[str, Any]:
         """
@@ -190,6 +201,36 @@ class FdoDetector:
                 'fdo_data': None
             }
 
+    @classmethod
+    def detect_fdo_in_buffer(cls, buffer: bytes, validate_crc: bool = False) -> Dict[str, Any]:
+        """
+        Scan a contiguous buffer of P3 frames and report FDO-carrying frames.
+
+        Uses the batch scanner, so no per-frame result dicts are built.
+        Frames failing CRC validation are dropped before any FDO parsing.
+
+        Args:
+            buffer: Bytes containing one or more complete P3 frames
+            validate_crc: Validate each frame's CRC16
+
+        Returns:
+            Dict with the columnar scan result and indices of FDO frames
+        """
+        scan = P3FrameScanner.scan(buffer, validate_crc=validate_crc, final=True)
+        fdo_indices = [i for i in range(len(scan)) if scan.header_sizes[i]]
+
+        logger.debug(f"Buffer scan: {len(scan)} frames, {len(fdo_indices)} with FDO, "
+                     f"{scan.crc_failures} CRC failures, {scan.skipped_bytes} bytes skipped")
+
+        return {
+            'scan': scan,
+            'frames_found': len(scan),
+            'fdo_indices': fdo_indices,
+            'crc_failures': scan.crc_failures,
+            'skipped_bytes': scan.skipped_bytes,
+            'trailing_bytes': len(scan.buffer) - scan.consumed
+        }
+
     @classmethod
     def quick_fdo_check(cls, frame_bytes: bytes) -> bool:
         """
@@ -202,13 +243,13 @@ class FdoDetector:
             True if frame likely contains FDO data
         """
         try:
-            # Quick P3 validation
+            # Quick P3 validation (guarantees exact frame size, so the payload can be sliced directly)
             if not P3FrameParser.quick_validate(frame_bytes):
                 return False
 
-            # Extract payload
-            payload_data = P3FrameParser.extract_data_only(frame_bytes)
-            if not payload_data or len(payload_data) < 5:  # Minimum for token + stream_id
+            # Extract payload without a full parse
+            payload_data = frame_bytes[8:-1]
+            if len(payload_data) < 5:  # Minimum for token + stream_id
                 return False
 
             # Quick token check - see if first 2 bytes look like a known token
@@ -226,6 +267,95 @@ class FdoDetector:
         except Exception:
             return False
 
+    @classmethod
+    def split_length_prefixed(cls, buffer: bytes, max_frames: Optional[int] = None) -> List[bytes]:
+        """
+        Split a binary batch body into frames.
+
+        Each frame is preceded by its size as a big-endian u32.
+
+        Args:
+            buffer: Concatenated length-prefixed frames
+            max_frames: Stop with FdoBatchTooLargeError at this many frames (None: no limit)
+
+        Returns:
+            List of frame bytes
+
+        Raises:
+            FdoDetectionError: If a length prefix runs past the end of the buffer
+            FdoBatchTooLargeError: If the buffer holds more than max_frames frames
+        """
+        frames = []
+        view = memoryview(buffer)
+        pos = 0
+        n = len(buffer)
+        while pos < n:
+            if max_frames is not None and len(frames) >= max_frames:
+                raise FdoBatchTooLargeError(f"Batch has more than {max_frames} frames")
+            if n - pos < 4:
+                raise FdoDetectionError(f"Truncated length prefix at offset {pos}")
+            size = int.from_bytes(view[pos:pos + 4], 'big')
+            pos += 4
+            if size > n - pos:
+                raise FdoDetectionError(f"Frame at offset {pos - 4} claims {size} bytes, only {n - pos} remain")
+            frames.append(bytes(view[pos:pos + size]))
+            pos += size
+        return frames
+
+    @classmethod
+    def detect_batch(cls, frames: List[bytes], include_data: bool = False) -> Dict[str, Any]:
+        """
+        Detect FDO data in many P3 frames with a cheap prefilter.
+
+        quick_fdo_check rejects most non-FDO frames; full extraction runs only
+        on the remaining candidates. Results are compact per-frame dicts
+        suited to high-rate hint systems.
+
+        Args:
+            frames: List of complete P3 frame bytes
+            include_data: Include base64-encoded FDO data for detected frames
+
+        Returns:
+            Dict with per-frame results and batch counters
+        """
+        results = []
+        candidates = 0
+        detected = 0
+
+        for index, frame_bytes in enumerate(frames):
+            if not cls.quick_fdo_check(frame_bytes):
+                results.append({'i': index, 'fdo': False})
+                continue
+
+            candidates += 1
+            extracted = P3FrameScanner.extract_fdo(frame_bytes)
+            if not extracted:
+                results.append({'i': index, 'fdo': False, 'type': frame_bytes[7] & 0x7F})
+                continue
+
+            token, stream_id, fdo_data = extracted
+            detected += 1
+            entry = {
+                'i': index,
+                'fdo': True,
+                'type': frame_bytes[7] & 0x7F,
+                'token': token,
+                'stream_id': stream_id,
+                'fdo_size': len(fdo_data)
+            }
+            if include_data:
+                entry['fdo_data'] = base64.b64encode(fdo_data).decode('ascii')
+            results.append(entry)
+
+        logger.debug(f"Batch detection: {len(frames)} frames, {candidates} candidates, {detected} with FDO")
+
+        return {
+            'frame_count': len(frames),
+            'candidates': candidates,
+            'fdo_detected': detected,
+            'results': results
+        }
+
     @classmethod
     def get_detection_summary(cls, detection_result: Dict[str, Any]) -> str:
         """
@@ -181,6 +181,14 @@ class FdoToolsManager:
     # --- New helpers for daemon-first integration ---
     def get_daemon_exe_path(self) -> Optional[str]:
         """Return path to fdo_daemon.exe for the selected release or backend drop."""
+        # Explicit override (e.g. bench/mock_fdo_daemon.py for Wine-free load testing)
+        override = os.environ.get("FDO_DAEMON_EXE")
+        if override:
+            if os.path.exists(override):
+                return os.path.abspath(override)
+            logger.warning(f"FDO_DAEMON_EXE not found: {override}")
+            return None
+
         # Only support the current backend layout
         if self.selected_release:
             candidate = os.path.join(self.selected_release, "bin", "fdo_daemon.exe")
@@ -6,14 +6,17 @@ Processes JSONL files containing P3 frame data to extract and reassemble FDO str
 
 import json
 import logging
+import os
 import time
 import psutil
-from typing import List, Dict, Any, Optional, Tuple
+from typing import List, Dict, Any, Optional, Tuple, Callable
 from dataclasses import dataclass
 
-from fdo_detector import FdoDetector
 from fdo_daemon_client import FdoDaemonClient, FdoDaemonError
+from p3_frame_scanner import P3FrameScanner
 from p3_payload_builder import P3PayloadBuilder
+from metrics import DAEMON_RESTARTS
+from pool_scheduler import PoolOverloadedError
 
 logger = logging.getLogger(__name__)
 
@@ -25,6 +28,7 @@ class P3Frame:
     token: Optional[str] = None
     direction: Optional[str] = None
     original_line: Dict[str, Any] = None
+    frame_bytes: Optional[bytes] = None  # Raw frame when ingested without hex encoding
 
 @dataclass
 class FdoExtraction:
@@ -39,6 +43,10 @@ class JsonlProcessingError(Exception):
     """Errors specific to JSONL processing operations"""
     pass
 
+class DecompressedSizeError(JsonlProcessingError):
+    """A compressed upload expands beyond the decompressed size limit"""
+    pass
+
 class JsonlProcessor:
     """
     Processor for JSONL files containing P3 frame data.
@@ -50,7 +58,10 @@ class JsonlProcessor:
     MAX_PROCESSING_TIME = 1800         # Maximum processing time in seconds (30 minutes)
     MAX_MEMORY_MB = 4096               # Maximum memory usage in MB (4GB)
     MEMORY_CHECK_INTERVAL = 1000       # Check memory every N frames
-    PROGRESS_LOG_INTERVAL = 10000      # Log progress every N frames
+    PROGRESS_LOG_INTERVAL = 10000      # Log (and report) progress every N frames
+
+    # Drop frames with a bad CRC16 before they reach a daemon (off by default)
+    VALIDATE_CRC = os.getenv('FDO_P3_VALIDATE_CRC', 'false').lower() == 'true'
 
     @staticmethod
     def _hex_to_fdo_format(hex_string: str, remove_prefix_bytes: int = 0) -> str:
@@ -198,31 +209,25 @@ class JsonlProcessor:
 
                 frame_bytes = bytes.fromhex(frame.full_hex)
 
-                # Use existing FDO detector
-                detection_result = FdoDetector.detect_fdo_in_p3_frame(frame_bytes)
+                # Scanner fast path (same acceptance rules as FdoDetector)
+                extracted = P3FrameScanner.extract_fdo(frame_bytes, validate_crc=cls.VALIDATE_CRC)
 
-                if detection_result['success'] and detection_result['fdo_detected']:
-                    fdo_metadata = detection_result['fdo_metadata']
-                    fdo_data_raw = detection_result['fdo_data']
-
-                    # FDO data from detect_fdo_in_p3_frame is already raw bytes, not base64
-                    fdo_data = fdo_data_raw if isinstance(fdo_data_raw, bytes) else bytes(fdo_data_raw)
+                if extracted:
+                    token, stream_id, fdo_data = extracted
 
                     extraction = FdoExtraction(
                         frame=frame,
                         fdo_data=fdo_data,
-                        token=fdo_metadata['token'],
-                        stream_id=fdo_metadata['stream_id'],
-                        fdo_size=fdo_metadata['fdo_size']
+                        token=token,
+                        stream_id=stream_id,
+                        fdo_size=len(fdo_data)
                     )
 
                     extractions.append(extraction)
                     logger.debug(f"Extracted FDO from frame: token={extraction.token}, "
                                f"stream_id={extraction.stream_id}, size={extraction.fdo_size}")
                 else:
-                    # Log why detection failed (if we have error info)
-                    if detection_result.get('error'):
-                        logger.debug(f"Frame timestamp {frame.timestamp}: {detection_result['error']}")
+                    logger.debug(f"Frame timestamp {frame.timestamp}: no FDO data in P3 frame")
 
             except Exception as e:
                 logger.warning(f"Frame timestamp {frame.timestamp}: FDO extraction failed - {e}")
@@ -264,7 +269,8 @@ class JsonlProcessor:
         return bytes(reassembled_data)
 
     @classmethod
-    def stream_process_file(cls, file_lines_iterator_factory) -> Dict[str, Any]:
+    def stream_process_file(cls, file_lines_iterator_factory,
+                            progress: Optional[Callable[[int], None]] = None) -> Dict[str, Any]:
         """
         Memory-efficient streaming processing of JSONL file.
         Processes frames one at a time without loading entire file into memory.
@@ -272,6 +278,7 @@ class JsonlProcessor:
 
         Args:
             file_lines_iterator_factory: Function that returns an iterator yielding JSONL lines
+            progress: Called with the number of frames processed so far every PROGRESS_LOG_INTERVAL frames
 
         Returns:
             Processing results with FDO data and metadata
@@ -307,7 +314,7 @@ class JsonlProcessor:
             # Pass 2: Stream through file and process frames in order
             logger.info("Pass 2: Processing frames and extracting FDO data...")
             fdo_frames, processed_count, fdo_count, supported_tokens, early_termination = cls._stream_extract_fdo_data(
-                file_lines_iterator_factory(), chronological_order, start_time
+                file_lines_iterator_factory(), chronological_order, start_time, progress=progress
             )
 
             if early_termination:
@@ -337,6 +344,8 @@ class JsonlProcessor:
             logger.info(f"Streaming processing complete: {fdo_count} FDO frames from {processed_count} total frames, "
                        f"time: {processing_time:.3f}s, peak memory: {peak_memory:.1f} MB")
 
+        except DecompressedSizeError:
+            raise  # Rejected upload, not a processing failure
         except Exception as e:
             result['error'] = str(e)
             processing_time = time.time() - start_time
@@ -346,6 +355,84 @@ class JsonlProcessor:
 
         return result
 
+    @classmethod
+    def stream_process_frames(cls, frames_iterator,
+                              progress: Optional[Callable[[int], None]] = None) -> Dict[str, Any]:
+        """
+        Streaming processing of P3 frames that are already framed as raw bytes.
+
+        Used for raw P3 byte streams and pcap/pcapng captures. Frames arrive in
+        capture order, so no order-detection pass and no JSON/hex round trip.
+
+        Args:
+            frames_iterator: Iterator yielding CapturedFrame objects (timestamp, frame_bytes, direction)
+            progress: Called with the number of frames processed so far every PROGRESS_LOG_INTERVAL frames
+
+        Returns:
+            Processing results with the same shape as stream_process_file
+        """
+        result = {
+            'success': False,
+            'fdo_frames': None,
+            'frames_processed': 0,
+            'fdo_frames_found': 0,
+            'total_fdo_bytes': 0,
+            'chronological_order': 'oldest_first',
+            'supported_tokens': set(),
+            'error': None,
+            'processing_time': None,
+            'peak_memory_mb': None,
+            'terminated_early': False
+        }
+
+        start_time = time.time()
+        process = psutil.Process()
+        peak_memory = process.memory_info().rss / 1024 / 1024  # MB
+
+        try:
+            logger.info("Processing raw P3 frames (capture order)...")
+
+            p3_frames = (
+                P3Frame(
+                    timestamp=captured.timestamp,
+                    full_hex='',
+                    direction=captured.direction,
+                    frame_bytes=captured.frame_bytes
+                )
+                for captured in frames_iterator
+            )
+
+            fdo_frames, processed_count, fdo_count, supported_tokens, early_termination = cls._stream_extract_fdo_data(
+                p3_frames, 'oldest_first', start_time, preparsed=True, progress=progress
+            )
+
+            if early_termination:
+                result['terminated_early'] = True
+                result['error'] = early_termination
+
+            peak_memory = max(peak_memory, process.memory_info().rss / 1024 / 1024)
+
+            result.update({
+                'success': True,
+                'fdo_frames': fdo_frames,
+                'frames_processed': processed_count,
+                'fdo_frames_found': fdo_count,
+                'total_fdo_bytes': sum(len(frame['data']) for frame in fdo_frames),
+                'supported_tokens': list(supported_tokens)
+            })
+
+            processing_time = time.time() - start_time
+            logger.info(f"Raw frame processing complete: {fdo_count} FDO frames from {processed_count} total frames, "
+                       f"time: {processing_time:.3f}s, peak memory: {peak_memory:.1f} MB")
+
+        except Exception as e:
+            result['error'] = str(e)
+            logger.error(f"Raw P3 frame processing failed: {e}", exc_info=True)
+
+        result['processing_time'] = f"{time.time() - start_time:.3f}s"
+        result['peak_memory_mb'] = f"{peak_memory:.1f} MB"
+        return result
+
     @classmethod
     def _determine_order_from_samples(cls, file_lines_iterator) -> tuple[str, int]:
         """
@@ -392,12 +479,16 @@ class JsonlProcessor:
             return "newest_first", sample_count
 
     @classmethod
-    def _stream_extract_fdo_data(cls, file_lines_iterator, chronological_order: str, start_time: float) -> tuple[list, int, int, set, str]:
+    def _stream_extract_fdo_data(cls, file_lines_iterator, chronological_order: str, start_time: float,
+                                 preparsed: bool = False,
+                                 progress: Optional[Callable[[int], None]] = None) -> tuple[list, int, int, set, str]:
         """
         Stream through file and extract FDO data frame by frame.
         Returns individual FDO frames for frame-by-frame decompilation.
         Includes safety monitoring and early termination.
 
+        When preparsed is True the iterator yields P3Frame objects instead of JSONL lines.
+
         Returns:
             Tuple of (fdo_frames_list, frames_processed, fdo_frames_found, supported_tokens, early_termination_reason)
         """
@@ -445,13 +536,15 @@ class JsonlProcessor:
                     elapsed = time.time() - start_time
                     memory_mb = process.memory_info().rss / 1024 / 1024
                     logger.info(f"Processed {frames_processed:,} frames... ({elapsed:.1f}s, {memory_mb:.1f} MB)")
+                    if progress:
+                        progress(frames_processed)
 
                 # Safety checks
                 if check_safety_limits():
                     logger.warning(f"Early termination: {early_termination}")
                     break
 
-                frame = cls._parse_single_line(line, frames_processed)
+                frame = line if preparsed else cls._parse_single_line(line, frames_processed)
                 if frame:
                     fdo_data = cls._extract_fdo_from_single_frame(frame)
                     if fdo_data:
@@ -471,13 +564,15 @@ class JsonlProcessor:
                     elapsed = time.time() - start_time
                     memory_mb = process.memory_info().rss / 1024 / 1024
                     logger.info(f"Processed {frames_processed:,} frames... ({elapsed:.1f}s, {memory_mb:.1f} MB)")
+                    if progress:
+                        progress(frames_processed)
 
                 # Safety checks
                 if check_safety_limits():
                     logger.warning(f"Early termination: {early_termination}")
                     break
 
-                frame = cls._parse_single_line(line, frames_processed)
+                frame = line if preparsed else cls._parse_single_line(line, frames_processed)
                 if frame:
                     fdo_data = cls._extract_fdo_from_single_frame(frame)
                     if fdo_data:
@@ -528,25 +623,28 @@ class JsonlProcessor:
     def _extract_fdo_from_single_frame(cls, frame: P3Frame) -> Optional[Dict[str, Any]]:
         """Extract FDO data from a single frame."""
         try:
-            if len(frame.full_hex) % 2 != 0:
+            if frame.frame_bytes is not None:
+                frame_bytes = frame.frame_bytes
+            elif len(frame.full_hex) % 2 != 0:
                 return None
+            else:
+                frame_bytes = bytes.fromhex(frame.full_hex)
 
-            frame_bytes = bytes.fromhex(frame.full_hex)
-            detection_result = FdoDetector.detect_fdo_in_p3_frame(frame_bytes)
-
-            if detection_result['success'] and detection_result['fdo_detected']:
-                fdo_metadata = detection_result['fdo_metadata']
-                fdo_data_raw = detection_result['fdo_data']
-
-                # FDO data is already raw bytes
-                fdo_data = fdo_data_raw if isinstance(fdo_data_raw, bytes) else bytes(fdo_data_raw)
-
-                return {
-                    'token': fdo_metadata['token'],
-                    'stream_id': fdo_metadata['stream_id'],
-                    'data': fdo_data,
-                    'original_frame_hex': frame.full_hex
+            # Scanner fast path: same acceptance rules as FdoDetector, no result dicts
+            extracted = P3FrameScanner.extract_fdo(frame_bytes, validate_crc=cls.VALIDATE_CRC)
+            if extracted:
+                token, stream_id, fdo_data = extracted
+                fdo_info = {
+                    'token': token,
+                    'stream_id': stream_id,
+                    'data': fdo_data
                 }
+                # Raw frames keep bytes; hex is only rendered if the frame fails
+                if frame.frame_bytes is not None:
+                    fdo_info['original_frame'] = frame_bytes
+                else:
+                    fdo_info['original_frame_hex'] = frame.full_hex
+                return fdo_info
 
         except Exception:
             pass
@@ -612,6 +710,10 @@ class JsonlProcessor:
                 if (i + 1) % 100 == 0:
                     logger.info(f"Decompiled {i + 1}/{len(fdo_frames)} frames successfully...")
 
+            except PoolOverloadedError:
+                # Pool exhausted: fail the job with 429 instead of timing out every remaining frame
+                raise
+
             except FdoDaemonError as e:
                 # Daemon returned error (HTTP 4xx/5xx)
                 # HTTP 422 = unprocessable (non-FDO data like images, text)
@@ -631,7 +733,7 @@ class JsonlProcessor:
                     'size_bytes': data_size,
                     'data_preview': data_preview,
                     'full_hex': fdo_data.hex(),
-                    'original_frame_hex': frame_info.get('original_frame_hex', '')
+                    'original_frame_hex': cls._original_frame_hex(frame_info)
                 })
 
                 # Continue processing - daemon auto-reinitializes after crashes
@@ -659,7 +761,7 @@ class JsonlProcessor:
                         'size_bytes': data_size,
                         'data_preview': data_preview,
                         'full_hex': fdo_data.hex(),
-                        'original_frame_hex': frame_info.get('original_frame_hex', '')
+                        'original_frame_hex': cls._original_frame_hex(frame_info)
                     })
 
                     # Attempt daemon restart for true process crashes only
@@ -680,7 +782,7 @@ class JsonlProcessor:
                         'error': error_str,
                         'size_bytes': data_size,
                         'data_preview': data_preview,
-                        'original_frame_hex': frame_info.get('original_frame_hex', '')
+                        'original_frame_hex': cls._original_frame_hex(frame_info)
                     })
 
                 frames_failed_decompilation += 1
@@ -778,6 +880,14 @@ class JsonlProcessor:
             logger.debug(f"Daemon health check failed at frame {frame_index}: {e}")
             return False
 
+    @classmethod
+    def _original_frame_hex(cls, frame_info: dict) -> str:
+        """Hex of the source P3 frame (rendered lazily for raw-ingested frames)."""
+        if 'original_frame_hex' in frame_info:
+            return frame_info['original_frame_hex']
+        original = frame_info.get('original_frame')
+        return original.hex().upper() if original else ''
+
     @classmethod
     def _is_daemon_crash_error(cls, error_str: str) -> bool:
         """Determine if error indicates daemon crashed vs normal failure."""
@@ -796,6 +906,7 @@ class JsonlProcessor:
         """Attempt to restart crashed daemon."""
         try:
             logger.info("Stopping crashed daemon...")
+            DAEMON_RESTARTS.inc("daemon", "crash")
             daemon_manager.stop()
 
             logger.info("Starting fresh daemon...")
@@ -0,0 +1,346 @@
+#!/usr/bin/env python3
+"""
+Metrics
+Minimal in-process metrics registry with Prometheus text exposition.
+Counters, gauges and histograms are cheap enough to leave on in production:
+an update is a dict lookup plus an uncontended lock around a few additions.
+"""
+
+import math
+import threading
+import logging
+from bisect import bisect_left
+from typing import Callable, Dict, Iterable, List, Optional, Sequence, Tuple
+
+logger = logging.getLogger(__name__)
+
+# Latency buckets (seconds) covering sub-millisecond parsing up to stuck daemon requests
+DEFAULT_LATENCY_BUCKETS = (
+    0.0005, 0.001, 0.0025, 0.005, 0.01, 0.025, 0.05, 0.1,
+    0.25, 0.5, 1.0, 2.5, 5.0, 10.0, 30.0
+)
+
+
+def _format_value(value: float) -> str:
+    if value == math.inf:
+        return "+Inf"
+    if value == -math.inf:
+        return "-Inf"
+    if isinstance(value, int) or float(value).is_integer():
+        return str(int(value))
+    return repr(float(value))
+
+
+def _escape_label(value: str) -> str:
+    return value.replace("\\", "\\\\").replace("\n", "\\n").replace('"', '\\"')
+
+
+def _format_labels(names: Sequence[str], values: Sequence[str], extra: Optional[Tuple[str, str]] = None) -> str:
+    pairs = [f'{name}="{_escape_label(value)}"' for name, value in zip(names, values)]
+    if extra:
+        pairs.append(f'{extra[0]}="{extra[1]}"')
+    return "{" + ",".join(pairs) + "}" if pairs else ""
+
+
+class _Metric:
+    """Base class: a named metric family with optional label dimensions."""
+
+    TYPE = "untyped"
+
+    def __init__(self, name: str, documentation: str, labelnames: Sequence[str] = ()):
+        self.name = name
+        self.documentation = documentation
+        self.labelnames = tuple(labelnames)
+        self._lock = threading.Lock()
+        self._children: Dict[Tuple[str, ...], object] = {}
+
+    def _key(self, labels: Tuple) -> Tuple[str, ...]:
+        if len(labels) != len(self.labelnames):
+            raise ValueError(f"{self.name} expects labels {self.labelnames}, got {labels}")
+        return tuple(str(label) for label in labels)
+
+    def render(self) -> List[str]:
+        lines = [f"# HELP {self.name} {self.documentation}", f"# TYPE {self.name} {self.TYPE}"]
+        with self._lock:
+            items = list(self._children.items())
+        for key, child in items:
+            lines.extend(self._render_child(key, child))
+        return lines
+
+    def _render_child(self, key: Tuple[str, ...], child) -> List[str]:
+        raise NotImplementedError
+
+
+class Counter(_Metric):
+    """Monotonically increasing counter."""
+
+    TYPE = "counter"
+
+    def inc(self, *labels, amount: float = 1) -> None:
+        key = self._key(labels)
+        with self._lock:
+            self._children[key] = self._children.get(key, 0) + amount
+
+    def value(self, *labels) -> float:
+        return self._children.get(self._key(labels), 0)
+
+    def _render_child(self, key, child) -> List[str]:
+        return [f"{self.name}{_format_labels(self.labelnames, key)} {_format_value(child)}"]
+
+
+class Gauge(_Metric):
+    """
+    Value that can go up and down.
+
+    A gauge may instead be backed by a collect function, evaluated at scrape
+    time, returning (label values, value) pairs. Pool state is exported this way
+    so the request path never has to maintain it.
+    """
+
+    TYPE = "gauge"
+
+    def __init__(self, name: str, documentation: str, labelnames: Sequence[str] = ()):
+        super().__init__(name, documentation, labelnames)
+        self._collect: Optional[Callable[[], Iterable[Tuple[Tuple, float]]]] = None
+
+    def set(self, *labels, value: float) -> None:
+        key = self._key(labels)
+        with self._lock:
+            self._children[key] = value
+
+    def inc(self, *labels, amount: float = 1) -> None:
+        key = self._key(labels)
+        with self._lock:
+            self._children[key] = self._children.get(key, 0) + amount
+
+    def dec(self, *labels, amount: float = 1) -> None:
+        self.inc(*labels, amount=-amount)
+
+    def set_function(self, collect: Optional[Callable[[], Iterable[Tuple[Tuple, float]]]]) -> None:
+        self._collect = collect
+
+    def render(self) -> List[str]:
+        if self._collect is None:
+            return super().render()
+
+        lines = [f"# HELP {self.name} {self.documentation}", f"# TYPE {self.name} {self.TYPE}"]
+        try:
+            for labels, value in self._collect():
+                lines.extend(self._render_child(self._key(tuple(labels)), value))
+        except Exception as e:
+            logger.warning(f"Metric collector for {self.name} failed: {e}")
+        return lines
+
+    def _render_child(self, key, child) -> List[str]:
+        return [f"{self.name}{_format_labels(self.labelnames, key)} {_format_value(child)}"]
+
+
+class _HistogramChild:
+    __slots__ = ("counts", "sum", "count")
+
+    def __init__(self, bucket_count: int):
+        self.counts = [0] * bucket_count
+        self.sum = 0.0
+        self.count = 0
+
+
+class Histogram(_Metric):
+    """Cumulative-bucket histogram (buckets are stored per-bucket and summed on render)."""
+
+    TYPE = "histogram"
+
+    def __init__(self, name: str, documentation: str, labelnames: Sequence[str] = (),
+                 buckets: Sequence[float] = DEFAULT_LATENCY_BUCKETS):
+        super().__init__(name, documentation, labelnames)
+        self.buckets = tuple(sorted(buckets))
+
+    def observe(self, *labels, value: float) -> None:
+        key = self._key(labels)
+        index = bisect_left(self.buckets, value)
+        with self._lock:
+            child = self._children.get(key)
+            if child is None:
+                child = self._children[key] = _HistogramChild(len(self.buckets) + 1)
+            child.counts[index] += 1
+            child.sum += value
+            child.count += 1
+
+    def _render_child(self, key, child) -> List[str]:
+        lines = []
+        cumulative = 0
+        for bound, count in zip(self.buckets + (math.inf,), child.counts):
+            cumulative += count
+            labels = _format_labels(self.labelnames, key, ("le", _format_value(bound)))
+            lines.append(f"{self.name}_bucket{labels} {cumulative}")
+        labels = _format_labels(self.labelnames, key)
+        lines.append(f"{self.name}_sum{labels} {_format_value(child.sum)}")
+        lines.append(f"{self.name}_count{labels} {child.count}")
+        return lines
+
+
+class MetricsRegistry:
+    """Holds metric families and renders them in Prometheus text format 0.0.4."""
+
+    CONTENT_TYPE = "text/plain; version=0.0.4; charset=utf-8"
+
+    def __init__(self):
+        self._metrics: Dict[str, _Metric] = {}
+        self._lock = threading.Lock()
+
+    def _register(self, metric: _Metric) -> _Metric:
+        with self._lock:
+            existing = self._metrics.get(metric.name)
+            if existing is not None:
+                return existing
+            self._metrics[metric.name] = metric
+            return metric
+
+    def counter(self, name: str, documentation: str, labelnames: Sequence[str] = ()) -> Counter:
+        return self._register(Counter(name, documentation, labelnames))
+
+    def gauge(self, name: str, documentation: str, labelnames: Sequence[str] = ()) -> Gauge:
+        return self._register(Gauge(name, documentation, labelnames))
+
+    def histogram(self, name: str, documentation: str, labelnames: Sequence[str] = (),
+                  buckets: Sequence[float] = DEFAULT_LATENCY_BUCKETS) -> Histogram:
+        return self._register(Histogram(name, documentation, labelnames, buckets))
+
+    def render(self, include: Optional[Iterable[str]] = None, exclude: Iterable[str] = (),
+               labels: Optional[Dict[str, str]] = None) -> str:
+        """
+        Render all families, or only those named in include, skipping those named in exclude.
+        labels are added to every sample (e.g. the worker process a series comes from).
+        """
+        with self._lock:
+            metrics = list(self._metrics.values())
+        include = set(include) if include is not None else None
+        exclude = set(exclude)
+        lines = []
+        for metric in metrics:
+            if (include is None or metric.name in include) and metric.name not in exclude:
+                lines.extend(metric.render())
+        if labels:
+            pairs = ",".join(f'{name}="{_escape_label(str(value))}"' for name, value in labels.items())
+            lines = [_add_labels(line, pairs) for line in lines]
+        return "\n".join(lines) + "\n"
+
+
+def _add_labels(line: str, pairs: str) -> str:
+    if line.startswith("#"):
+        return line
+    if "{" in line.split(" ", 1)[0]:
+        return line.replace("{", "{" + pairs + ",", 1)
+    name, _, value = line.partition(" ")
+    return f"{name}{{{pairs}}} {value}"
+
+
+def merge_expositions(texts: Iterable[str]) -> str:
+    """
+    Merge Prometheus text from several registries (e.g. one per worker process)
+    into one exposition: each family's HELP/TYPE once, followed by the samples
+    of every source. Sources must label their series apart.
+    """
+    families: Dict[str, List[str]] = {}
+    for text in texts:
+        family: List[str] = []
+        for line in text.splitlines():
+            if line.startswith("# HELP "):
+                name = line.split(" ", 3)[2]
+                family = families.get(name)
+                if family is None:
+                    family = families[name] = [line]
+            elif line.startswith("# TYPE "):
+                if len(family) == 1:
+                    family.append(line)
+            elif line:
+                family.append(line)
+    return "".join(line + "\n" for family in families.values() for line in family)
+
+
+REGISTRY = MetricsRegistry()
+
+# HTTP layer
+HTTP_REQUESTS = REGISTRY.counter(
+    "atomforge_http_requests_total", "HTTP requests by route template and status code",
+    ("method", "route", "status"))
+HTTP_REQUEST_SECONDS = REGISTRY.histogram(
+    "atomforge_http_request_duration_seconds", "HTTP request latency by route template",
+    ("method", "route"))
+
+# Daemon pool
+DAEMON_CHECKOUT_WAIT_SECONDS = REGISTRY.histogram(
+    "atomforge_daemon_checkout_wait_seconds", "Time spent waiting for an idle daemon by scheduling lane",
+    ("lane",))
+DAEMON_CHECKOUT_TIMEOUTS = REGISTRY.counter(
+    "atomforge_daemon_checkout_timeouts_total", "Checkouts that gave up waiting for an idle daemon",
+    ("lane",))
+POOL_ADMISSION_REJECTIONS = REGISTRY.counter(
+    "atomforge_pool_admission_rejections_total", "Requests rejected with 429 because the lane's queue wait would exceed its budget",
+    ("lane",))
+DAEMON_SERVICE_SECONDS = REGISTRY.histogram(
+    "atomforge_daemon_service_seconds", "Daemon round trip time by daemon and operation",
+    ("daemon", "op"))
+DAEMON_ERRORS = REGISTRY.counter(
+    "atomforge_daemon_errors_total", "Daemon request failures by error class",
+    ("daemon", "op", "error_class"))
+DAEMON_HEDGES = REGISTRY.counter(
+    "atomforge_daemon_hedges_total",
+    "Hedged daemon requests by outcome (sent, won, lost, failed, no_budget, no_daemon)", ("op", "outcome"))
+DAEMON_RETRIES = REGISTRY.counter(
+    "atomforge_daemon_retries_total", "Pool requests retried on another daemon", ("op",))
+CIRCUIT_BREAKER_TRANSITIONS = REGISTRY.counter(
+    "atomforge_circuit_breaker_transitions_total", "Circuit breaker state changes",
+    ("daemon", "state"))
+DAEMON_RESTARTS = REGISTRY.counter(
+    "atomforge_daemon_restarts_total", "Daemon restarts by reason", ("daemon", "reason"))
+DAEMON_EJECTIONS = REGISTRY.counter(
+    "atomforge_daemon_ejections_total", "Daemons temporarily ejected as latency outliers", ("daemon",))
+POOL_INSTANCES = REGISTRY.gauge(
+    "atomforge_pool_instances", "Pool daemons by state", ("state",))
+POOL_BUSY_INSTANCES = REGISTRY.gauge(
+    "atomforge_pool_busy_instances", "Pool daemons currently processing a request")
+POOL_LANE_WAITING = REGISTRY.gauge(
+    "atomforge_pool_lane_waiting", "Requests waiting for a daemon by scheduling lane", ("lane",))
+POOL_LANE_BUSY = REGISTRY.gauge(
+    "atomforge_pool_lane_busy", "Daemons checked out by scheduling lane", ("lane",))
+DAEMON_RSS_BYTES = REGISTRY.gauge(
+    "atomforge_daemon_rss_bytes", "Resident memory of each daemon's process tree", ("daemon",))
+DAEMON_CPU_SECONDS = REGISTRY.gauge(
+    "atomforge_daemon_cpu_seconds", "CPU time used by each daemon's current process tree", ("daemon",))
+DAEMON_CONTEXT_SWITCHES = REGISTRY.gauge(
+    "atomforge_daemon_context_switches", "Context switches of each daemon's current process tree",
+    ("daemon", "kind"))
+
+# Throughput
+COMPILED_BYTES = REGISTRY.counter(
+    "atomforge_compiled_bytes_total", "Binary bytes produced by compilation")
+DECOMPILED_BYTES = REGISTRY.counter(
+    "atomforge_decompiled_bytes_total", "Binary bytes consumed by decompilation")
+JSONL_FRAMES = REGISTRY.counter(
+    "atomforge_jsonl_frames_total", "Capture/JSONL frames by processing stage", ("stage",))
+EXTRACTION_JOBS = REGISTRY.gauge(
+    "atomforge_extraction_jobs", "JSONL/capture extractions running in worker processes")
+
+
+def classify_error(error: BaseException) -> str:
+    """
+    Map an exception from the daemon path to a low-cardinality error class.
+
+    Args:
+        error: Exception raised while talking to a daemon
+
+    Returns:
+        Error class label (e.g. "http_4xx", "timeout", "connect")
+    """
+    status_code = getattr(error, "status_code", None)
+    if isinstance(status_code, int):
+        return f"http_{status_code // 100}xx"
+
+    name = type(error).__name__
+    if "Timeout" in name:
+        return "timeout"
+    if "Connect" in name:
+        return "connect"
+    if "Protocol" in name or "Read" in name or "Write" in name:
+        return "transport"
+    return name.lower()
@@ -0,0 +1,447 @@
+#!/usr/bin/env python3
+"""
+P3 Capture Reader
+Reads raw P3 byte streams and pcap/pcapng captures into P3 frames.
+TCP payloads are reassembled per flow direction before frame resynchronization.
+"""
+
+import struct
+from dataclasses import dataclass
+from typing import BinaryIO, Dict, Iterator, Optional, Tuple
+import logging
+
+from p3_frame_scanner import P3FrameScanner
+
+logger = logging.getLogger(__name__)
+
+
+class P3CaptureError(Exception):
+    """Errors specific to capture reading operations"""
+    pass
+
+
+@dataclass
+class CapturedFrame:
+    """A complete P3 frame recovered from a byte stream or capture"""
+    timestamp: float
+    frame_bytes: bytes
+    direction: Optional[str] = None
+
+
+class P3StreamReassembler:
+    """
+    Incremental P3 framer for one byte stream.
+
+    Bytes are appended as they arrive; complete frames are emitted and the
+    trailing partial frame is carried over to the next feed. A carried frame
+    can never exceed 64KB + header (u16 length), so the carry stays bounded;
+    flush() rescans it when the stream ends.
+    """
+
+    def __init__(self, direction: Optional[str] = None, validate_crc: bool = False):
+        self.direction = direction
+        self.validate_crc = validate_crc
+        self._carry = b''
+        self._timestamp = 0.0
+        self.frames_emitted = 0
+        self.bytes_skipped = 0
+
+    def feed(self, data: bytes, timestamp: float = 0.0) -> Iterator[CapturedFrame]:
+        """Append stream bytes and yield every frame completed by them."""
+        buffer = self._carry + data if self._carry else data
+        self._timestamp = timestamp
+        yield from self._scan(buffer, final=False)
+
+    def flush(self) -> Iterator[CapturedFrame]:
+        """
+        End of stream (or an unrecoverable gap): rescan the carried bytes as
+        complete input and yield any frames behind a false sync byte.
+        """
+        if self._carry:
+            yield from self._scan(self._carry, final=True)
+
+    def _scan(self, buffer: bytes, final: bool) -> Iterator[CapturedFrame]:
+        scan = P3FrameScanner.scan(buffer, validate_crc=self.validate_crc, final=final)
+        self.bytes_skipped += scan.skipped_bytes
+        self._carry = buffer[scan.consumed:]
+
+        for i in range(len(scan)):
+            start = scan.offsets[i]
+            self.frames_emitted += 1
+            yield CapturedFrame(self._timestamp, buffer[start:start + scan.lengths[i]], self.direction)
+
+
+class _TcpFlow:
+    """
+    One direction of a TCP connection with in-order reassembly.
+
+    A FIN closes the flow once every byte before it has arrived; an RST (or the
+    end of the capture) closes it right away, delivering buffered segments
+    across their holes. A closed flow ignores late retransmissions until a new
+    SYN reuses its addresses.
+    """
+
+    # Out-of-order segments buffered before declaring a gap
+    MAX_PENDING_SEGMENTS = 256
+
+    def __init__(self, direction: str, validate_crc: bool):
+        self.next_seq: Optional[int] = None
+        self.pending: Dict[int, bytes] = {}
+        self.framer = P3StreamReassembler(direction, validate_crc)
+        self.gaps = 0
+        self.fin_seq: Optional[int] = None  # Sequence number of the FIN, once seen
+        self.closed = False
+        self._timestamp = 0.0
+
+    def add_segment(self, seq: int, payload: bytes, flags: int, timestamp: float) -> Iterator[CapturedFrame]:
+        self._timestamp = timestamp
+        if flags & 0x02:  # SYN
+            self.next_seq = (seq + 1) & 0xFFFFFFFF
+            self.pending.clear()
+            self.fin_seq = None
+            self.closed = False
+            yield from self.framer.flush()
+            seq = self.next_seq
+        elif self.closed:
+            return  # Retransmission after FIN/RST: already delivered
+
+        end = (seq + len(payload)) & 0xFFFFFFFF
+        if payload:
+            yield from self._add_data(seq, payload)
+
+        if flags & 0x04:  # RST
+            yield from self.close()
+            return
+        if flags & 0x01 and self.fin_seq is None:
+            self.fin_seq = end
+        if self.fin_seq is not None and (self.next_seq is None or self._before(self.fin_seq)):
+            yield from self.close()
+
+    def close(self) -> Iterator[CapturedFrame]:
+        """Deliver buffered segments in sequence order, skipping holes, and flush the framer."""
+        while self.pending:
+            seq, payload = self._skip_gap()
+            yield from self.framer.flush()
+            yield from self._deliver(seq, payload)
+        yield from self.framer.flush()
+        self.closed = True
+
+    def _before(self, seq: int) -> bool:
+        """Whether seq is at or before next_seq (every byte up to it has been delivered)."""
+        offset = (seq - self.next_seq) & 0xFFFFFFFF
+        return offset == 0 or offset >= 0x80000000
+
+    def _add_data(self, seq: int, payload: bytes) -> Iterator[CapturedFrame]:
+        if self.next_seq is None:
+            self.next_seq = seq  # Capture started mid-connection
+
+        offset = (seq - self.next_seq) & 0xFFFFFFFF
+        if offset >= 0x80000000:
+            # Segment starts before next_seq: retransmission or overlap
+            overlap = (self.next_seq - seq) & 0xFFFFFFFF
+            if overlap >= len(payload):
+                return
+            payload = payload[overlap:]
+            offset = 0
+
+        if offset > 0:
+            self.pending.setdefault(seq, payload)
+            if len(self.pending) <= self.MAX_PENDING_SEGMENTS:
+                return
+            # Too much buffered behind a hole - skip the missing bytes
+            seq, payload = self._skip_gap()
+            yield from self.framer.flush()
+
+        yield from self._deliver(seq, payload)
+
+    def _skip_gap(self) -> Tuple[int, bytes]:
+        """Give up on the hole before the lowest buffered segment and take that segment."""
+        self.gaps += 1
+        seq = min(self.pending, key=lambda s: (s - self.next_seq) & 0xFFFFFFFF)
+        logger.debug(f"TCP gap in {self.framer.direction}: skipped to seq {seq}")
+        return seq, self.pending.pop(seq)
+
+    def _deliver(self, seq: int, payload: bytes) -> Iterator[CapturedFrame]:
+        yield from self.framer.feed(payload, self._timestamp)
+        self.next_seq = (seq + len(payload)) & 0xFFFFFFFF
+
+        # Drain segments that are now in order
+        while self.pending:
+            ready = None
+            for pending_seq in self.pending:
+                if self._before(pending_seq):
+                    ready = pending_seq
+                    break
+            if ready is None:
+                break
+            data = self.pending.pop(ready)
+            overlap = (self.next_seq - ready) & 0xFFFFFFFF
+            if overlap < len(data):
+                yield from self.framer.feed(data[overlap:], self._timestamp)
+                self.next_seq = (self.next_seq + len(data) - overlap) & 0xFFFFFFFF
+
+
+class P3CaptureReader:
+    """
+    Reader for raw P3 streams and pcap/pcapng capture files.
+
+    Capture format is detected from the leading magic bytes; anything that is
+    not a pcap or pcapng file is treated as a raw P3 byte stream.
+    """
+
+    PCAP_MAGICS = {
+        b'\xd4\xc3\xb2\xa1': ('<', 1e-6),
+        b'\xa1\xb2\xc3\xd4': ('>', 1e-6),
+        b'\x4d\x3c\xb2\xa1': ('<', 1e-9),
+        b'\xa1\xb2\x3c\x4d': ('>', 1e-9),
+    }
+    PCAPNG_SHB = b'\x0a\x0d\x0d\x0a'
+
+    # Link-layer types
+    LINKTYPE_NULL = 0
+    LINKTYPE_ETHERNET = 1
+    LINKTYPE_RAW = 101
+    LINKTYPE_LINUX_SLL = 113
+    LINKTYPE_IPV4 = 228
+    LINKTYPE_IPV6 = 229
+    LINKTYPE_LINUX_SLL2 = 276
+
+    RAW_READ_SIZE = 1 << 20
+
+    @classmethod
+    def detect_format(cls, head: bytes) -> str:
+        """Return 'pcap', 'pcapng' or 'raw' based on leading bytes."""
+        if head[:4] in cls.PCAP_MAGICS:
+            return 'pcap'
+        if head[:4] == cls.PCAPNG_SHB:
+            return 'pcapng'
+        return 'raw'
+
+    @classmethod
+    def read_frames(cls, fileobj: BinaryIO, port: Optional[int] = None,
+                    validate_crc: bool = False) -> Iterator[CapturedFrame]:
+        """
+        Yield P3 frames from a raw stream or capture file, in capture order.
+
+        Args:
+            fileobj: Binary file object positioned at the start of the data
+            port: Only reassemble TCP flows with this source or destination port
+            validate_crc: Drop frames whose CRC16 does not match
+
+        Raises:
+            P3CaptureError: If a capture file is malformed
+        """
+        head = fileobj.read(4)
+        capture_format = cls.detect_format(head)
+        logger.info(f"Reading P3 capture (format: {capture_format})")
+
+        if capture_format == 'raw':
+            yield from cls._read_raw(head, fileobj, validate_crc)
+            return
+
+        packets = cls._iter_pcap(head, fileobj) if capture_format == 'pcap' else cls._iter_pcapng(head, fileobj)
+        yield from cls._reassemble_tcp(packets, port, validate_crc)
+
+    @classmethod
+    def _read_raw(cls, head: bytes, fileobj: BinaryIO, validate_crc: bool) -> Iterator[CapturedFrame]:
+        framer = P3StreamReassembler(validate_crc=validate_crc)
+        yield from framer.feed(head)
+        while True:
+            chunk = fileobj.read(cls.RAW_READ_SIZE)
+            if not chunk:
+                break
+            yield from framer.feed(chunk)
+        yield from framer.flush()
+
+        if framer.bytes_skipped:
+            logger.info(f"Raw P3 stream: {framer.frames_emitted} frames, {framer.bytes_skipped} bytes skipped")
+
+    @classmethod
+    def _read_exact(cls, fileobj: BinaryIO, size: int) -> bytes:
+        data = fileobj.read(size)
+        if len(data) != size:
+            raise P3CaptureError(f"Truncated capture: wanted {size} bytes, got {len(data)}")
+        return data
+
+    @classmethod
+    def _iter_pcap(cls, magic: bytes, fileobj: BinaryIO) -> Iterator[Tuple[int, float, bytes]]:
+        """Yield (link_type, timestamp, packet) from a classic pcap file."""
+        endian, ts_scale = cls.PCAP_MAGICS[magic]
+        header = cls._read_exact(fileobj, 20)
+        link_type = struct.unpack(endian + 'HHiIII', header)[5] & 0x0FFFFFFF
+        record = struct.Struct(endian + 'IIII')
+
+        while True:
+            record_header = fileobj.read(16)
+            if len(record_header) < 16:
+                break
+            ts_sec, ts_frac, incl_len, _ = record.unpack(record_header)
+            data = fileobj.read(incl_len)
+            if len(data) < incl_len:
+                logger.warning("Truncated final pcap record ignored")
+                break
+            yield link_type, ts_sec + ts_frac * ts_scale, data
+
+    @classmethod
+    def _iter_pcapng(cls, first: bytes, fileobj: BinaryIO) -> Iterator[Tuple[int, float, bytes]]:
+        """Yield (link_type, timestamp, packet) from a pcapng file."""
+        endian = '<'
+        interfaces = []  # (link_type, ts_resolution)
+        block_type_bytes = first
+
+        while True:
+            if block_type_bytes is None:
+                block_type_bytes = fileobj.read(4)
+            if len(block_type_bytes) < 4:
+                break
+
+            length_bytes = cls._read_exact(fileobj, 4)
+            if block_type_bytes == cls.PCAPNG_SHB:
+                # Section header: determine byte order from the byte-order magic
+                bom = cls._read_exact(fileobj, 4)
+                endian = '<' if bom == b'\x4d\x3c\x2b\x1a' else '>'
+                block_length = struct.unpack(endian + 'I', length_bytes)[0]
+                cls._read_exact(fileobj, block_length - 12)
+                interfaces = []
+                block_type_bytes = None
+                continue
+
+            block_type = struct.unpack(endian + 'I', block_type_bytes)[0]
+            block_length = struct.unpack(endian + 'I', length_bytes)[0]
+            if block_length < 12:
+                raise P3CaptureError(f"Invalid pcapng block length: {block_length}")
+            body = cls._read_exact(fileobj, block_length - 8)[:-4]
+            block_type_bytes = None
+
+            if block_type == 1:  # Interface Description Block
+                link_type = struct.unpack_from(endian + 'H', body, 0)[0]
+                interfaces.append((link_type, cls._pcapng_ts_resolution(body[8:], endian)))
+            elif block_type == 6:  # Enhanced Packet Block
+                interface_id, ts_high, ts_low, captured_len = struct.unpack_from(endian + 'IIII', body, 0)
+                if interface_id >= len(interfaces):
+                    continue
+                link_type, ts_resolution = interfaces[interface_id]
+                yield link_type, ((ts_high << 32) | ts_low) * ts_resolution, body[20:20 + captured_len]
+            elif block_type == 3 and interfaces:  # Simple Packet Block
+                original_len = struct.unpack_from(endian + 'I', body, 0)[0]
+                yield interfaces[0][0], 0.0, body[4:4 + original_len]
+
+    @classmethod
+    def _pcapng_ts_resolution(cls, options: bytes, endian: str) -> float:
+        """Parse if_tsresol from IDB options (default microseconds)."""
+        offset = 0
+        while offset + 4 <= len(options):
+            code, length = struct.unpack_from(endian + 'HH', options, offset)
+            if code == 0:
+                break
+            if code == 9 and length >= 1:
+                value = options[offset + 4]
+                return 2.0 ** -(value & 0x7F) if value & 0x80 else 10.0 ** -value
+            offset += 4 + ((length + 3) & ~3)
+        return 1e-6
+
+    @classmethod
+    def _extract_ip(cls, link_type: int, packet: bytes) -> Optional[bytes]:
+        """Strip the link-layer header and return the IP packet, or None."""
+        if link_type == cls.LINKTYPE_ETHERNET:
+            offset, ether_type = 14, struct.unpack_from('>H', packet, 12)[0] if len(packet) >= 14 else 0
+            while ether_type in (0x8100, 0x88A8) and len(packet) >= offset + 4:
+                ether_type = struct.unpack_from('>H', packet, offset + 2)[0]
+                offset += 4
+            return packet[offset:] if ether_type in (0x0800, 0x86DD) else None
+        if link_type == cls.LINKTYPE_LINUX_SLL:
+            return packet[16:] if len(packet) >= 16 and packet[14:16] in (b'\x08\x00', b'\x86\xdd') else None
+        if link_type == cls.LINKTYPE_LINUX_SLL2:
+            return packet[20:] if len(packet) >= 20 and packet[0:2] in (b'\x08\x00', b'\x86\xdd') else None
+        if link_type == cls.LINKTYPE_NULL:
+            return packet[4:]
+        if link_type in (cls.LINKTYPE_RAW, cls.LINKTYPE_IPV4, cls.LINKTYPE_IPV6):
+            return packet
+        return None
+
+    @classmethod
+    def _parse_tcp(cls, ip_packet: bytes) -> Optional[Tuple[str, int, str, int, int, int, bytes]]:
+        """Return (src, sport, dst, dport, seq, flags, payload) for TCP packets."""
+        if not ip_packet:
+            return None
+
+        version = ip_packet[0] >> 4
+        if version == 4:
+            if len(ip_packet) < 20:
+                return None
+            header_length = (ip_packet[0] & 0x0F) * 4
+            total_length = struct.unpack_from('>H', ip_packet, 2)[0]
+            fragment = struct.unpack_from('>H', ip_packet, 6)[0]
+            if ip_packet[9] != 6 or fragment & 0x1FFF:
+                return None  # Not TCP, or a non-first fragment
+            src = '.'.join(str(b) for b in ip_packet[12:16])
+            dst = '.'.join(str(b) for b in ip_packet[16:20])
+            segment = ip_packet[header_length:total_length or len(ip_packet)]
+        elif version == 6:
+            if len(ip_packet) < 40:
+                return None
+            next_header = ip_packet[6]
+            payload_length = struct.unpack_from('>H', ip_packet, 4)[0]
+            offset = 40
+            # Skip hop-by-hop, routing and destination option headers
+            while next_header in (0, 43, 60) and len(ip_packet) >= offset + 8:
+                next_header, ext_length = ip_packet[offset], ip_packet[offset + 1]
+                offset += (ext_length + 1) * 8
+            if next_header != 6:
+                return None
+            src = ip_packet[8:24].hex()
+            dst = ip_packet[24:40].hex()
+            segment = ip_packet[offset:40 + payload_length]
+        else:
+            return None
+
+        if len(segment) < 20:
+            return None
+        sport, dport, seq = struct.unpack_from('>HHI', segment, 0)
+        data_offset = (segment[12] >> 4) * 4
+        flags = segment[13]
+        return src, sport, dst, dport, seq, flags, segment[data_offset:]
+
+    @classmethod
+    def _reassemble_tcp(cls, packets: Iterator[Tuple[int, float, bytes]], port: Optional[int],
+                        validate_crc: bool) -> Iterator[CapturedFrame]:
+        flows: Dict[Tuple[str, int, str, int], _TcpFlow] = {}
+        server_ports: Dict[Tuple[str, int, str, int], int] = {}
+        packets_seen = 0
+
+        for link_type, timestamp, packet in packets:
+            packets_seen += 1
+            ip_packet = cls._extract_ip(link_type, packet)
+            if ip_packet is None:
+                continue
+            tcp = cls._parse_tcp(ip_packet)
+            if tcp is None:
+                continue
+
+            src, sport, dst, dport, seq, flags, payload = tcp
+            if port is not None and port not in (sport, dport):
+                continue
+
+            key = (src, sport, dst, dport)
+            flow = flows.get(key)
+            if flow is None:
+                # SYN without ACK marks the client side of the connection
+                connection = (min(key[:2], key[2:]), max(key[:2], key[2:]))
+                if flags & 0x12 == 0x02:
+                    server_ports[connection] = dport
+                server_port = server_ports.get(connection, port)
+                if server_port is not None:
+                    label = 'out' if dport == server_port else 'in'
+                else:
+                    label = f"{src}:{sport}->{dst}:{dport}"
+                flow = _TcpFlow(label, validate_crc)
+                flows[key] = flow
+
+            # Closed flows stay in the table so late retransmissions are recognised
+            yield from flow.add_segment(seq, payload, flags, timestamp)
+
+        open_flows = [flow for flow in flows.values() if not flow.closed]
+        for flow in open_flows:
+            yield from flow.close()
+
+        logger.info(f"Capture reassembly: {packets_seen} packets, {len(open_flows)} open flows at end of capture")
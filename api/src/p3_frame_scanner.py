@@ -0,0 +1,310 @@
+#!/usr/bin/env python3
+"""
+P3 Frame Scanner
+Batch scanner for contiguous buffers of P3 frames with optional CRC16 validation.
+Returns compact columnar results instead of one dict per frame.
+
+CRC16 validation runs in Python, one table lookup per 16 bits of frame, and
+makes a scan several times slower for frames of a few hundred bytes. It is
+off by default (FDO_P3_VALIDATE_CRC) on the capture and JSONL paths.
+"""
+
+import struct
+import sys
+from array import array
+from dataclasses import dataclass, field
+from typing import List, Optional, Tuple
+import logging
+
+from p3_frame_parser import P3FrameParser
+from p3_payload_builder import P3PayloadBuilder
+
+logger = logging.getLogger(__name__)
+
+
+def _build_crc16_table() -> Tuple[int, ...]:
+    """Build lookup table for CRC-16/ARC (reflected polynomial 0xA001)."""
+    table = []
+    for byte in range(256):
+        crc = byte
+        for _ in range(8):
+            crc = (crc >> 1) ^ 0xA001 if crc & 1 else crc >> 1
+        table.append(crc)
+    return tuple(table)
+
+
+def _build_crc16_pair_table(table: Tuple[int, ...]) -> Tuple[int, ...]:
+    """Build lookup table that advances CRC-16/ARC over two bytes at once."""
+    pairs = []
+    for value in range(65536):
+        crc = (value >> 8) ^ table[value & 0xFF]
+        pairs.append((crc >> 8) ^ table[crc & 0xFF])
+    return tuple(pairs)
+
+
+@dataclass
+class P3ScanResult:
+    """
+    Columnar results of scanning a buffer of P3 frames.
+
+    Column i describes the i-th frame found in the buffer. Frame payload
+    (data field) starts at offsets[i] + 8 and is lengths[i] - 9 bytes long.
+    """
+    buffer: bytes
+    offsets: array = field(default_factory=lambda: array('I'))      # Frame start offset in buffer
+    lengths: array = field(default_factory=lambda: array('I'))      # Total frame size (sync..msg_end)
+    types: array = field(default_factory=lambda: array('B'))        # Raw type byte (client bit included)
+    tx_seqs: array = field(default_factory=lambda: array('B'))
+    rx_seqs: array = field(default_factory=lambda: array('B'))
+    tokens: List[Optional[str]] = field(default_factory=list)       # Payload token (DATA packets only)
+    stream_ids: array = field(default_factory=lambda: array('q'))   # Payload stream_id, -1 if absent
+    header_sizes: array = field(default_factory=lambda: array('B')) # Token + stream_id size, 0 if absent
+    crc_checked: bool = False
+    consumed: int = 0                # Bytes fully consumed (start of first incomplete frame)
+    skipped_bytes: int = 0           # Bytes discarded while resynchronizing
+    crc_failures: int = 0            # Candidate frames rejected by CRC validation
+
+    def __len__(self) -> int:
+        return len(self.offsets)
+
+    def packet_type_value(self, index: int) -> int:
+        """Packet type with the client bit removed."""
+        return self.types[index] & 0x7F
+
+    def frame(self, index: int) -> memoryview:
+        """Zero-copy view of the complete frame."""
+        start = self.offsets[index]
+        return memoryview(self.buffer)[start:start + self.lengths[index]]
+
+    def payload(self, index: int) -> memoryview:
+        """Zero-copy view of the P3 data field."""
+        start = self.offsets[index] + 8
+        return memoryview(self.buffer)[start:start + self.lengths[index] - 9]
+
+    def fdo_data(self, index: int) -> Optional[memoryview]:
+        """Zero-copy view of the FDO data after the token/stream_id header, or None."""
+        header_size = self.header_sizes[index]
+        if not header_size:
+            return None
+        start = self.offsets[index] + 8 + header_size
+        end = self.offsets[index] + self.lengths[index] - 1
+        return memoryview(self.buffer)[start:end]
+
+
+class P3FrameScanner:
+    """
+    Batch P3 frame scanner.
+
+    Walks a contiguous buffer, resynchronizing on SYNC_BYTE/MSG_END_BYTE, and
+    records frame metadata into typed arrays. The FDO token and stream_id are
+    decoded inline for DATA packets so callers can skip a second parse.
+    """
+
+    HEADER = struct.Struct('>BHHBBB')   # sync, crc, length, tx_seq, rx_seq, type
+    HEADER_SIZE = 8
+    DATA_PACKET_TYPE = 0x20
+
+    CRC16_TABLE = _build_crc16_table()
+    CRC16_PAIR_TABLE = _build_crc16_pair_table(CRC16_TABLE)
+
+    # Decoded token cache: raw 2-byte token -> (token string, header size)
+    _token_cache: dict = {}
+
+    @classmethod
+    def crc16(cls, data) -> int:
+        """
+        Table-driven CRC-16/ARC over data.
+
+        P3 computes the CRC over the length, tx_seq, rx_seq, type and data
+        fields (everything between the CRC field and msg_end).
+        """
+        data = memoryview(data).cast('B')
+        even = len(data) & ~1
+        words = array('H')
+        words.frombytes(data[:even])
+        if sys.byteorder != 'little':
+            words.byteswap()
+        pairs = cls.CRC16_PAIR_TABLE
+        crc = 0
+        for word in words:
+            crc = pairs[crc ^ word]
+        if even != len(data):
+            crc = (crc >> 8) ^ cls.CRC16_TABLE[(crc ^ data[even]) & 0xFF]
+        return crc
+
+    @classmethod
+    def _decode_token(cls, raw_token: bytes) -> Tuple[str, int]:
+        cached = cls._token_cache.get(raw_token)
+        if cached is None:
+            token = raw_token.rstrip(b'\x00').decode('ascii', errors='ignore')
+            stream_id_size = P3PayloadBuilder.TOKEN_STREAM_ID_SIZES.get(token, P3PayloadBuilder.DEFAULT_STREAM_ID_SIZE)
+            cached = (token, 2 + stream_id_size)
+            cls._token_cache[raw_token] = cached
+        return cached
+
+    @classmethod
+    def scan(cls, buffer: bytes, validate_crc: bool = False, max_frames: Optional[int] = None,
+             final: bool = False) -> P3ScanResult:
+        """
+        Scan a buffer containing zero or more P3 frames.
+
+        Garbage between frames is skipped by searching for the next sync byte.
+        A trailing partial frame is left unconsumed (see P3ScanResult.consumed)
+        so streaming callers can prepend it to the next read.
+
+        Args:
+            buffer: Contiguous bytes holding P3 frames
+            validate_crc: Reject frames whose CRC16 does not match
+            max_frames: Stop after this many frames (None for no limit)
+            final: The buffer is the complete input. A frame running past the
+                end is a false sync byte, so scanning resumes at the next byte
+                instead of stopping there.
+
+        Returns:
+            P3ScanResult with one column entry per frame found
+        """
+        if not isinstance(buffer, bytes):
+            buffer = bytes(buffer)
+
+        result = P3ScanResult(buffer=buffer, crc_checked=validate_crc)
+        offsets = result.offsets
+        lengths = result.lengths
+        types = result.types
+        tx_seqs = result.tx_seqs
+        rx_seqs = result.rx_seqs
+        tokens = result.tokens
+        stream_ids = result.stream_ids
+        header_sizes = result.header_sizes
+
+        unpack_header = cls.HEADER.unpack_from
+        decode_token = cls._decode_token
+        crc16 = cls.crc16
+        sync_byte = bytes([P3FrameParser.SYNC_BYTE])
+        msg_end = P3FrameParser.MSG_END_BYTE
+        data_type = cls.DATA_PACKET_TYPE
+
+        n = len(buffer)
+        pos = 0
+        consumed = 0
+
+        while True:
+            if max_frames is not None and len(offsets) >= max_frames:
+                break
+
+            sync_pos = buffer.find(sync_byte, pos)
+            if sync_pos < 0:
+                result.skipped_bytes += n - pos
+                consumed = n
+                break
+            if sync_pos != pos:
+                result.skipped_bytes += sync_pos - pos
+                pos = sync_pos
+
+            if n - pos < cls.HEADER_SIZE + 1:
+                if final:
+                    # Too short for any frame
+                    result.skipped_bytes += n - pos
+                    consumed = n
+                    break
+                consumed = pos  # Partial header - wait for more data
+                break
+
+            _, crc, length, tx_seq, rx_seq, type_field = unpack_header(buffer, pos)
+            if length < 3:
+                pos += 1
+                result.skipped_bytes += 1
+                continue
+
+            end = pos + length + 5  # Index of msg_end byte
+            if end >= n:
+                if final:
+                    pos += 1
+                    result.skipped_bytes += 1
+                    continue
+                consumed = pos  # Partial frame - wait for more data
+                break
+
+            if buffer[end] != msg_end:
+                pos += 1
+                result.skipped_bytes += 1
+                continue
+
+            if validate_crc and crc16(buffer[pos + 3:end]) != crc:
+                result.crc_failures += 1
+                pos += 1
+                result.skipped_bytes += 1
+                continue
+
+            frame_size = length + 6
+            offsets.append(pos)
+            lengths.append(frame_size)
+            types.append(type_field)
+            tx_seqs.append(tx_seq)
+            rx_seqs.append(rx_seq)
+
+            data_length = length - 3
+            if (type_field & 0x7F) == data_type and data_length >= 2:
+                token, header_size = decode_token(buffer[pos + 8:pos + 10])
+                if data_length >= header_size:
+                    tokens.append(token)
+                    stream_ids.append(int.from_bytes(buffer[pos + 10:pos + 8 + header_size], 'little'))
+                    header_sizes.append(header_size)
+                else:
+                    tokens.append(token)
+                    stream_ids.append(-1)
+                    header_sizes.append(0)
+            else:
+                tokens.append(None)
+                stream_ids.append(-1)
+                header_sizes.append(0)
+
+            pos = end + 1
+            consumed = pos
+
+        result.consumed = consumed
+
+        if result.skipped_bytes or result.crc_failures:
+            logger.debug(f"P3 scan: {len(offsets)} frames, {result.skipped_bytes} bytes skipped, "
+                         f"{result.crc_failures} CRC failures")
+
+        return result
+
+    @classmethod
+    def extract_fdo(cls, frame_bytes: bytes, validate_crc: bool = False) -> Optional[Tuple[str, int, bytes]]:
+        """
+        Fast single-frame FDO extraction.
+
+        Accepts exactly the frames FdoDetector.detect_fdo_in_p3_frame accepts
+        (trailing bytes after msg_end are ignored), without building result dicts.
+
+        Args:
+            frame_bytes: Complete P3 frame bytes
+            validate_crc: Reject the frame if its CRC16 does not match
+
+        Returns:
+            (token, stream_id, fdo_data) for DATA packets carrying FDO, else None
+        """
+        n = len(frame_bytes)
+        if n < P3FrameParser.MIN_FRAME_SIZE or frame_bytes[0] != P3FrameParser.SYNC_BYTE:
+            return None
+
+        _, crc, length, _, _, type_field = cls.HEADER.unpack_from(frame_bytes, 0)
+        if length < 3:
+            return None
+
+        end = length + 5
+        if end >= n or frame_bytes[end] != P3FrameParser.MSG_END_BYTE:
+            return None
+
+        if validate_crc and cls.crc16(frame_bytes[3:end]) != crc:
+            return None
+
+        if (type_field & 0x7F) != cls.DATA_PACKET_TYPE or length - 3 < 2:
+            return None
+
+        token, header_size = cls._decode_token(frame_bytes[8:10])
+        if length - 3 < header_size:
+            return None
+
+        stream_id = int.from_bytes(frame_bytes[10:8 + header_size], 'little')
+        return token, stream_id, frame_bytes[8 + header_size:end]
@@ -6,7 +6,7 @@ Based on reverse engineering of AOLBUF.AOL protocol implementation
 """
 
 import struct
-from typing import Dict, Any
+from typing import Any, Dict, Iterator, List, Optional
 import logging
 
 logger = logging.getLogger(__name__)
@@ -271,4 +271,166 @@ class P3PayloadBuilder:
         if effective_payload_size <= 0:
             return 0
 
-        return (total_data_size + effective_payload_size - 1) // effective_payload_size
\ No newline at end of file
+        return (total_data_size + effective_payload_size - 1) // effective_payload_size
+
+
+class P3PacketBuffer:
+    """
+    P3 packets built back to back into one growable buffer.
+
+    Each packet is written behind a small frame header, so the used part of the
+    buffer is already the compact chunk stream served by /compile-chunk when the
+    client sends Accept: application/vnd.atomforge.p3-chunks:
+
+        stream header  "P3CK", version u8, reserved u8, packet count u32
+        per packet     length u16, flags u8 (bit 0: continuation), sequence index u32,
+                       then the P3 payload (token + stream_id + data)
+
+    All integers are big-endian. Indexing or iterating yields each packet as
+    bytes, for callers that still want one object per packet.
+    """
+
+    MEDIA_TYPE = "application/vnd.atomforge.p3-chunks"
+    MAGIC = b"P3CK"
+    VERSION = 1
+    STREAM_HEADER = struct.Struct(">4sBxI")
+    FRAME_HEADER = struct.Struct(">HBI")
+    FLAG_CONTINUATION = 0x01
+
+    def __init__(self, stream_id: int, token: str, capacity: int = 4096):
+        """
+        Args:
+            stream_id: Stream identifier written into every packet
+            token: 2-byte token written into every packet
+            capacity: Initial buffer size in bytes (grows by doubling)
+
+        Raises:
+            ValueError: If stream_id is out of range for the token
+        """
+        # Validates token/stream_id once, the same way every packet would be
+        self._p3_header = P3PayloadBuilder.build_packet(b'', stream_id, token)
+        self._buf = bytearray(max(capacity, self.STREAM_HEADER.size))
+        self._used = self.STREAM_HEADER.size
+        self._starts: List[int] = []      # Offset of each packet's P3 header
+        self._lengths: List[int] = []
+        self._continuations: List[bool] = []
+        self._open: Optional[int] = None  # Offset of the open packet's frame header
+        self.payload_size = 0
+        self.continuation_count = 0
+
+    @property
+    def pending_size(self) -> int:
+        """Data bytes in the open packet (0 if none is open)."""
+        if self._open is None:
+            return 0
+        return self._used - self._open - self.FRAME_HEADER.size - len(self._p3_header)
+
+    def write(self, data: bytes) -> None:
+        """Append data to the open packet, starting one if none is open."""
+        if not data:
+            return
+        if self._open is None:
+            self._reserve(self.FRAME_HEADER.size + len(self._p3_header))
+            self._open = self._used
+            self._used += self.FRAME_HEADER.size
+            self._put(self._p3_header)
+        self._reserve(len(data))
+        self._put(data)
+
+    def end(self, is_continuation: bool = False) -> int:
+        """
+        Close the open packet.
+
+        Returns:
+            Size of the closed P3 packet in bytes (0 if no packet was open)
+        """
+        if self._open is None:
+            return 0
+        start = self._open + self.FRAME_HEADER.size
+        length = self._used - start
+        if length > 0xFFFF:
+            raise ValueError(f"P3 packet of {length} bytes exceeds the chunk stream frame limit")
+        flags = self.FLAG_CONTINUATION if is_continuation else 0
+        self.FRAME_HEADER.pack_into(self._buf, self._open, length, flags, len(self._starts))
+        self._starts.append(start)
+        self._lengths.append(length)
+        self._continuations.append(is_continuation)
+        self.payload_size += length
+        self.continuation_count += is_continuation
+        self._open = None
+        return length
+
+    def append(self, data: bytes, is_continuation: bool = False) -> int:
+        """Write data as a packet of its own; returns the packet size."""
+        self.end()
+        self.write(data)
+        return self.end(is_continuation)
+
+    @property
+    def chunk_info(self) -> List[Dict[str, Any]]:
+        """Per-packet metadata in FdoChunker's chunk_info format."""
+        return [
+            {'size': length, 'is_continuation': continuation, 'sequence_index': index}
+            for index, (length, continuation) in enumerate(zip(self._lengths, self._continuations))
+        ]
+
+    def to_stream(self) -> bytes:
+        """The compact chunk stream (stream header and framed packets)."""
+        if self._open is not None:
+            raise ValueError("Cannot serialize a P3 packet buffer with an open packet")
+        self.STREAM_HEADER.pack_into(self._buf, 0, self.MAGIC, self.VERSION, len(self._starts))
+        return bytes(memoryview(self._buf)[:self._used])
+
+    @classmethod
+    def parse_stream(cls, data: bytes) -> List[Dict[str, Any]]:
+        """
+        Decode a compact chunk stream.
+
+        Returns:
+            One dict per packet: 'payload' (bytes), 'is_continuation', 'sequence_index'
+
+        Raises:
+            ValueError: If the stream is truncated or not a version 1 chunk stream
+        """
+        if len(data) < cls.STREAM_HEADER.size:
+            raise ValueError("Chunk stream too short for its header")
+        magic, version, count = cls.STREAM_HEADER.unpack_from(data, 0)
+        if magic != cls.MAGIC or version != cls.VERSION:
+            raise ValueError(f"Not a version {cls.VERSION} P3 chunk stream")
+
+        packets = []
+        offset = cls.STREAM_HEADER.size
+        for _ in range(count):
+            if offset + cls.FRAME_HEADER.size > len(data):
+                raise ValueError(f"Chunk stream truncated at packet {len(packets)}")
+            length, flags, sequence_index = cls.FRAME_HEADER.unpack_from(data, offset)
+            offset += cls.FRAME_HEADER.size
+            if offset + length > len(data):
+                raise ValueError(f"Chunk stream truncated at packet {len(packets)}")
+            packets.append({
+                'payload': bytes(data[offset:offset + length]),
+                'is_continuation': bool(flags & cls.FLAG_CONTINUATION),
+                'sequence_index': sequence_index
+            })
+            offset += length
+        return packets
+
+    def _reserve(self, size: int) -> None:
+        needed = self._used + size
+        if needed > len(self._buf):
+            self._buf.extend(bytes(max(needed, 2 * len(self._buf)) - len(self._buf)))
+
+    def _put(self, data: bytes) -> None:
+        self._buf[self._used:self._used + len(data)] = data
+        self._used += len(data)
+
+    def __len__(self) -> int:
+        return len(self._starts)
+
+    def __getitem__(self, index: int) -> bytes:
+        start = self._starts[index]
+        return bytes(self._buf[start:start + self._lengths[index]])
+
+    def __iter__(self) -> Iterator[bytes]:
+        for index in range(len(self._starts)):
+            yield self[index]
@@ -0,0 +1,842 @@
+#!/usr/bin/env python3
+"""
+Pool Broker
+Shares one daemon pool between several API worker processes.
+
+With FDO_API_WORKERS > 1, api_server.main starts this module as a separate
+process before uvicorn forks its workers. The broker owns the
+FdoDaemonPoolManager (daemons, health monitor, recycling, scheduler) and
+hands out request slots over a Unix socket. Each worker talks to the daemon it
+was given directly, so only the control plane crosses processes:
+
+    worker -> broker   {"id", "op": "checkout", "lane", "avoid", "size", "timeout", "flow"}
+    broker -> worker   {"id", "slot": {"token", "daemon", "host", "port", "index", "lane"} | null, "retry_after"}
+    worker -> broker   {"op": "deadline" | "result" | "recycle" | "release", "token", ...}   (no reply)
+    worker -> broker   {"op": "cancel", "id"}                                                (no reply)
+    worker -> broker   {"op": "worker_metrics", "text"}                                      (no reply)
+    broker -> worker   {"op": "state", "state": {...}}                                      (pushed)
+
+Messages are JSON lines. Flows from different workers are kept apart by the
+connection id, so deficit round-robin stays fair across workers. A worker's
+slots are released if its connection drops. A worker that abandons a checkout
+(its caller was cancelled or timed out) sends a cancel for it, and releases a
+slot granted before the cancel arrived.
+
+Workers use PoolBrokerClient in place of FdoDaemonPoolManager. Admission
+control, lane capacity, /health/pool and /health/pool/memory read the latest
+state pushed by the broker (every FDO_POOL_BROKER_STATE_INTERVAL seconds), so
+they may lag the pool by that much. Request timeouts are learned per worker.
+Workers push their own metrics, labelled with their pid, to the broker every
+FDO_POOL_BROKER_METRICS_INTERVAL seconds, so /metrics on any worker covers all
+of them.
+If the broker connection drops, the worker reports the pool unhealthy, fails
+checkouts as overloaded and reconnects with backoff; leases from the old
+connection were released by the broker and are dropped.
+
+With FDO_POOL_SUPERVISOR=true the broker runs detached as a persistent
+supervisor: it outlives the API process and records its pid, socket, pool
+configuration fingerprint and daemon pids in a state file. On startup the API
+reattaches to a running supervisor whose fingerprint matches, replaces one
+whose pool configuration changed, and cleans up daemons left behind by one that
+died, so an API restart keeps the pool warm.
+"""
+
+import asyncio
+import fcntl
+import hashlib
+import itertools
+import json
+import logging
+import math
+import os
+import signal
+import socket
+import subprocess
+import sys
+import time
+from dataclasses import dataclass
+from typing import Any, Dict, Optional, Set
+
+from adaptive_timeouts import AdaptiveTimeouts
+from daemon_resources import process_tree
+from fdo_daemon_pool_manager import FdoDaemonPoolManager, DaemonSlot
+from metrics import (
+    REGISTRY, merge_expositions, POOL_ADMISSION_REJECTIONS, CIRCUIT_BREAKER_TRANSITIONS, DAEMON_RESTARTS, DAEMON_EJECTIONS,
+    POOL_INSTANCES, POOL_BUSY_INSTANCES, POOL_LANE_WAITING, POOL_LANE_BUSY, DAEMON_RSS_BYTES, DAEMON_CPU_SECONDS,
+    DAEMON_CONTEXT_SWITCHES
+)
+from pool_scheduler import (
+    DEFAULT_LANES, LANE_INTERACTIVE, LANE_LARGE, LARGE_INPUT_BYTES, CHECKOUT_TIMEOUT, PoolOverloadedError,
+    parse_lanes, current_lane, current_flow, set_request_flow
+)
+
+logger = logging.getLogger(__name__)
+
+DEFAULT_SOCKET = "/tmp/atomforge_pool_broker.sock"
+
+# Seconds between state pushes to workers
+STATE_INTERVAL = float(os.getenv("FDO_POOL_BROKER_STATE_INTERVAL", "0.25"))
+
+# Seconds between pushes of a worker's own metrics to the broker
+METRICS_INTERVAL = float(os.getenv("FDO_POOL_BROKER_METRICS_INTERVAL", "5.0"))
+
+# Worker reconnect backoff after losing the broker (seconds)
+RECONNECT_MIN_DELAY = 0.5
+RECONNECT_MAX_DELAY = 10.0
+
+# Persistent supervisor: state file recording the running broker, and its log
+SUPERVISOR_STATE = os.getenv("FDO_POOL_SUPERVISOR_STATE", "/tmp/atomforge_pool_supervisor.json")
+SUPERVISOR_LOG = os.getenv("FDO_POOL_SUPERVISOR_LOG", "/tmp/atomforge_pool_supervisor.log")
+
+# Settings that configure the pool; a supervisor started with different values is replaced
+FINGERPRINT_PREFIXES = ("FDO_DAEMON_", "FDO_WINE_", "FDO_POOL_", "FDO_API_RESERVED_CPUS")
+# ...except these, which only affect the API side or the supervisor itself
+FINGERPRINT_EXCLUDED = ("FDO_DAEMON_MAX_RETRIES", "FDO_DAEMON_HEDG", "FDO_DAEMON_FAST_TRANSPORT", "FDO_DAEMON_TOKEN",
+                        "FDO_POOL_BROKER_SOCKET", "FDO_POOL_BROKER_METRICS_INTERVAL", "FDO_POOL_SUPERVISOR")
+
+# Metric families maintained by the broker; workers fetch them for /metrics
+BROKER_METRICS = {metric.name for metric in (
+    CIRCUIT_BREAKER_TRANSITIONS, DAEMON_RESTARTS, DAEMON_EJECTIONS, POOL_INSTANCES, POOL_BUSY_INSTANCES,
+    POOL_LANE_WAITING, POOL_LANE_BUSY, DAEMON_RSS_BYTES, DAEMON_CPU_SECONDS, DAEMON_CONTEXT_SWITCHES
+)}
+
+
+def _encode(message: Dict[str, Any]) -> bytes:
+    return json.dumps(message, separators=(",", ":")).encode("utf-8") + b"\n"
+
+
+# --- Broker process ---
+
+class _WorkerConnection:
+    """One connected API worker and the slots it holds."""
+
+    def __init__(self, conn_id: int, writer: asyncio.StreamWriter):
+        self.id = conn_id
+        self.writer = writer
+        self.slots: Dict[int, DaemonSlot] = {}
+        self.checkouts: Dict[int, asyncio.Task] = {}  # Checkouts waiting in the scheduler, by request id
+        self.metrics = ""  # Worker's own metrics as last pushed
+        self.closed = False
+
+    def send(self, message: Dict[str, Any]) -> None:
+        if not self.closed:
+            self.writer.write(_encode(message))
+
+
+class PoolBroker:
+    """Serves a FdoDaemonPoolManager's slots to API workers over a Unix socket."""
+
+    def __init__(self, pool_manager: FdoDaemonPoolManager, socket_path: str = DEFAULT_SOCKET,
+                 state_interval: float = STATE_INTERVAL, state_file: Optional[str] = None,
+                 fingerprint: Optional[str] = None):
+        """
+        Args:
+            pool_manager: Started pool to share
+            socket_path: Unix socket to listen on (replaced if it exists)
+            state_interval: Seconds between state pushes to workers
+            state_file: Supervisor state file to maintain while serving (None: not persistent)
+            fingerprint: Pool configuration fingerprint recorded in the state file
+        """
+        self.pool_manager = pool_manager
+        self.socket_path = socket_path
+        self.state_interval = state_interval
+        self.state_file = state_file
+        self.fingerprint = fingerprint
+        self.started_at = time.time()
+        self._recorded_daemons: Optional[list] = None
+        self._connections: Dict[int, _WorkerConnection] = {}
+        self._conn_ids = itertools.count(1)
+        self._tokens = itertools.count(1)
+
+    def state(self) -> Dict[str, Any]:
+        """Pool figures workers need without a round trip."""
+        manager = self.pool_manager
+        status = manager.get_pool_status()
+        status["broker"] = {
+            "pid": os.getpid(),
+            "persistent": self.state_file is not None,
+            "uptime_s": round(time.time() - self.started_at, 1)
+        }
+        return {
+            "status": status,
+            "memory": manager.resources.snapshot(),
+            "resource_interval": manager.resources.interval,
+            "max_concurrency": {lane: manager.scheduler.max_concurrency(lane) for lane in manager.scheduler.lanes},
+            "base_port": manager.base_port,
+            "slots_per_daemon": manager.slots_per_daemon
+        }
+
+    async def serve(self, stop: Optional[asyncio.Event] = None) -> None:
+        """Accept workers and push state until stop is set."""
+        stop = stop or asyncio.Event()
+        if os.path.exists(self.socket_path):
+            os.unlink(self.socket_path)
+        server = await asyncio.start_unix_server(self._handle, path=self.socket_path, limit=2 ** 20)
+        logger.info(f"Pool broker listening on {self.socket_path}")
+        try:
+            while not stop.is_set():
+                if self.state_file:
+                    self._record_state()
+                if self._connections:
+                    line = _encode({"op": "state", "state": self.state()})
+                    for conn in list(self._connections.values()):
+                        if not conn.closed:
+                            conn.writer.write(line)
+                try:
+                    await asyncio.wait_for(stop.wait(), timeout=self.state_interval)
+                except asyncio.TimeoutError:
+                    pass
+        finally:
+            server.close()
+            await server.wait_closed()
+            if os.path.exists(self.socket_path):
+                os.unlink(self.socket_path)
+            if self.state_file and read_supervisor_state(self.state_file).get("pid") == os.getpid():
+                os.unlink(self.state_file)
+
+    def _record_state(self) -> None:
+        """Rewrite the supervisor state file when the set of daemon processes changes."""
+        daemons = [{"id": instance.id, "port": instance.port, "pid": instance.manager.pid}
+                   for instance in list(self.pool_manager.instances)]
+        if daemons == self._recorded_daemons:
+            return
+        self._recorded_daemons = daemons
+        state = {
+            "pid": os.getpid(),
+            "socket": self.socket_path,
+            "fingerprint": self.fingerprint,
+            "exe_path": self.pool_manager.exe_path,
+            "started_at": self.started_at,
+            "daemons": daemons
+        }
+        tmp_path = f"{self.state_file}.tmp"
+        with open(tmp_path, "w") as f:
+            json.dump(state, f)
+        os.replace(tmp_path, self.state_file)
+
+    async def _handle(self, reader: asyncio.StreamReader, writer: asyncio.StreamWriter) -> None:
+        conn = _WorkerConnection(next(self._conn_ids), writer)
+        self._connections[conn.id] = conn
+        logger.info(f"Pool broker: worker connection {conn.id} opened")
+        try:
+            while True:
+                line = await reader.readline()
+                if not line:
+                    break
+                await self._dispatch(conn, json.loads(line))
+        except (ConnectionError, ValueError) as e:
+            logger.warning(f"Pool broker: worker connection {conn.id} failed: {e}")
+        finally:
+            conn.closed = True
+            del self._connections[conn.id]
+            for task in list(conn.checkouts.values()):
+                task.cancel()
+            for slot in conn.slots.values():
+                await self.pool_manager.release_slot(slot)
+            if conn.slots:
+                logger.warning(f"Pool broker: released {len(conn.slots)} slot(s) held by worker connection {conn.id}")
+            conn.slots.clear()
+            writer.close()
+
+    async def _dispatch(self, conn: _WorkerConnection, message: Dict[str, Any]) -> None:
+        manager = self.pool_manager
+        op = message.get("op")
+
+        if op == "checkout":
+            # Waits in the scheduler; run it alongside this connection's other messages
+            request_id = message["id"]
+            task = asyncio.ensure_future(self._checkout(conn, message))
+            conn.checkouts[request_id] = task
+            task.add_done_callback(lambda _: conn.checkouts.pop(request_id, None))
+            return
+        if op == "cancel":
+            # The worker gave up on this checkout; a slot already granted comes back as a release
+            task = conn.checkouts.get(message["id"])
+            if task is not None:
+                task.cancel()
+            return
+
+        if op == "hello":
+            conn.send({"id": message["id"], "state": self.state()})
+            return
+        if op == "try_checkout":
+            slot = await manager.try_checkout(message["lane"], set(message.get("avoid") or ()))
+            conn.send({"id": message["id"], "slot": self._lease(conn, slot) if slot else None})
+            return
+        if op == "reset_circuit_breakers":
+            conn.send({"id": message["id"], "count": manager.reset_circuit_breakers()})
+            return
+        if op in ("metrics", "worker_metrics"):
+            conn.metrics = message.get("text") or conn.metrics
+            if op == "metrics":
+                # Pool families from here, request families from every worker (the asking one's are current)
+                texts = [REGISTRY.render(include=BROKER_METRICS)]
+                texts += [worker.metrics for worker in self._connections.values() if worker.metrics]
+                conn.send({"id": message["id"], "text": merge_expositions(texts)})
+            return
+
+        # One-way messages about a leased slot
+        token = message.get("token")
+        slot = conn.slots.pop(token, None) if op == "release" else conn.slots.get(token)
+        if slot is None:
+            return
+        if op == "release":
+            await manager.release_slot(slot)
+        elif op == "deadline":
+            slot.deadline = message["at"]
+        elif op == "result":
+            await manager.record_request_result(slot.instance, message["ok"], message.get("duration"))
+        elif op == "recycle":
+            manager.recycle_instance(slot.instance, reason=message.get("reason", "request_timeout"))
+
+    async def _checkout(self, conn: _WorkerConnection, message: Dict[str, Any]) -> None:
+        flow = message.get("flow")
+        set_request_flow((conn.id, flow) if flow is not None else None)
+        lane = message["lane"]
+        slot = await self.pool_manager.get_healthy_instance_async(
+            timeout=message["timeout"], avoid=set(message.get("avoid") or ()), lane=lane, size=message.get("size", 0)
+        )
+        if conn.closed:
+            if slot:
+                await self.pool_manager.release_slot(slot)
+            return
+        if slot is None:
+            conn.send({"id": message["id"], "slot": None,
+                       "retry_after": self.pool_manager.scheduler.retry_after(lane)})
+            return
+        conn.send({"id": message["id"], "slot": self._lease(conn, slot)})
+
+    def _lease(self, conn: _WorkerConnection, slot: DaemonSlot) -> Dict[str, Any]:
+        token = next(self._tokens)
+        conn.slots[token] = slot
+        instance = slot.instance
+        return {"token": token, "daemon": instance.id, "host": instance.bind_host, "port": instance.port,
+                "index": slot.index, "lane": slot.lane}
+
+
+# --- Worker side ---
+
+@dataclass(eq=False)
+class RemoteDaemon:
+    """The parts of a broker's DaemonInstance a worker needs to reach it."""
+    id: str
+    bind_host: str
+    port: int
+    token: int  # Lease the broker tracks this checkout under
+    generation: int  # Broker connection the lease belongs to
+
+
+class BrokerSlot:
+    """A slot leased from the broker; mirrors DaemonSlot."""
+
+    def __init__(self, client: "PoolBrokerClient", lease: Dict[str, Any]):
+        self.client = client
+        self.token = lease["token"]
+        self.instance = RemoteDaemon(lease["daemon"], lease["host"], lease["port"], self.token, client._generation)
+        self.index = lease["index"]
+        self.lane = lease["lane"]
+        self.started_at = time.time()
+        self._deadline: Optional[float] = None
+
+    @property
+    def deadline(self) -> Optional[float]:
+        return self._deadline
+
+    @deadline.setter
+    def deadline(self, value: Optional[float]) -> None:
+        # Forwarded so the broker's stuck-request backstop uses the worker's adaptive timeout
+        self._deadline = value
+        self.client._send_lease({"op": "deadline", "token": self.token, "at": value}, self.instance)
+
+
+class BrokerScheduler:
+    """
+    Worker-side view of the broker's PoolScheduler.
+
+    Lane configuration comes from the same environment as the broker; queue
+    estimates and lane capacity come from the broker's state pushes.
+    """
+
+    def __init__(self, client: "PoolBrokerClient"):
+        self.client = client
+        lanes = parse_lanes(os.getenv("FDO_POOL_LANES", DEFAULT_LANES))
+        self.lanes = {config.name: config for config in lanes}
+        self.default_lane = LANE_INTERACTIVE if LANE_INTERACTIVE in self.lanes else lanes[0].name
+        self._retry_after: Dict[str, int] = {}  # Broker's hint from the last failed checkout per lane
+
+    def resolve_lane(self, lane: Optional[str] = None, size: int = 0) -> str:
+        if size >= LARGE_INPUT_BYTES and LANE_LARGE in self.lanes:
+            return LANE_LARGE
+        lane = lane or current_lane()
+        return lane if lane in self.lanes else self.default_lane
+
+    def checkout_timeout(self, lane: str) -> float:
+        return max(CHECKOUT_TIMEOUT, 2 * self.lanes[lane].wait_budget)
+
+    def get_status(self) -> Dict[str, Dict]:
+        return self.client.get_pool_status().get("lanes", {})
+
+    def estimate_wait(self, lane: str) -> float:
+        estimate_ms = self.get_status().get(lane, {}).get("estimated_wait_ms")
+        return estimate_ms / 1000 if estimate_ms is not None else 0.0
+
+    def admit(self, lane: Optional[str] = None, size: int = 0) -> str:
+        """Admission control against the broker's last published queue estimate (see PoolScheduler.admit)."""
+        lane = self.resolve_lane(lane, size)
+        estimate = self.estimate_wait(lane)
+        if estimate <= self.lanes[lane].wait_budget:
+            return lane
+        POOL_ADMISSION_REJECTIONS.inc(lane)
+        raise PoolOverloadedError(lane, estimate, self.retry_after(lane, estimate))
+
+    def record_retry_after(self, lane: str, seconds: Optional[int]) -> None:
+        """Keep a failed checkout's Retry-After hint for the next retry_after(lane)."""
+        if seconds is None:
+            self._retry_after.pop(lane, None)
+        else:
+            self._retry_after[lane] = seconds
+
+    def retry_after(self, lane: str, estimate: Optional[float] = None) -> int:
+        if estimate is None:
+            hint = self._retry_after.pop(lane, None)
+            if hint is not None:
+                return hint
+            estimate = self.estimate_wait(lane)
+        if estimate >= 1e9:
+            return int(CHECKOUT_TIMEOUT)
+        return max(1, math.ceil(estimate - self.lanes[lane].wait_budget))
+
+    def max_concurrency(self, lane: Optional[str] = None) -> int:
+        return self.client._state["max_concurrency"].get(self.resolve_lane(lane), 1)
+
+
+class _BrokerResources:
+    """Cached stand-in for the pool's DaemonResourceCollector."""
+
+    def __init__(self, client: "PoolBrokerClient"):
+        self.client = client
+
+    @property
+    def interval(self) -> float:
+        return self.client._state["resource_interval"]
+
+    def snapshot(self) -> Dict[str, Any]:
+        return self.client._state["memory"]
+
+
+class PoolBrokerClient:
+    """
+    Drop-in replacement for FdoDaemonPoolManager in an API worker, backed by the pool broker.
+
+    Implements what FdoDaemonPoolClient and the API endpoints use: slot
+    checkout and release, result reporting, recycling, status and metrics.
+    """
+
+    def __init__(self, socket_path: str, timeouts: Optional[AdaptiveTimeouts] = None):
+        self.socket_path = socket_path
+        self.timeouts = timeouts or AdaptiveTimeouts.from_env()
+        self.scheduler = BrokerScheduler(self)
+        self.resources = _BrokerResources(self)
+        self._state: Dict[str, Any] = {}
+        self._pending: Dict[int, asyncio.Future] = {}
+        self._ids = itertools.count(1)
+        self._writer: Optional[asyncio.StreamWriter] = None
+        self._reader_task: Optional[asyncio.Task] = None
+        self._generation = 0  # Bumped per connection; leases from an earlier one are void
+        self._connected = False
+        self._closed = False
+        self._reconnect_task: Optional[asyncio.Task] = None
+        self.metrics_interval = METRICS_INTERVAL
+        self._metrics_task: Optional[asyncio.Task] = None
+
+    @classmethod
+    async def connect(cls, socket_path: str, timeout: float = 10.0) -> "PoolBrokerClient":
+        """Connect to a running broker and fetch its initial state."""
+        client = cls(socket_path)
+        await client._open(timeout)
+        client._metrics_task = asyncio.ensure_future(client._push_metrics())
+        return client
+
+    async def _open(self, timeout: float) -> None:
+        reader, self._writer = await asyncio.open_unix_connection(self.socket_path, limit=2 ** 24)
+        self._generation += 1
+        self._reader_task = asyncio.ensure_future(self._read_loop(reader, self._generation))
+        reply = await self._call({"op": "hello"}, timeout)
+        self._state = reply["state"]
+        self._connected = True
+
+    async def _reconnect(self) -> None:
+        """Reconnect with exponential backoff until the broker (or its replacement) answers."""
+        delay = RECONNECT_MIN_DELAY
+        while not self._closed:
+            await asyncio.sleep(delay)
+            try:
+                await self._open(CHECKOUT_TIMEOUT)
+            except (OSError, ConnectionError, asyncio.TimeoutError) as e:
+                logger.debug(f"Pool broker reconnect failed: {e}")
+                if self._writer is not None:
+                    self._writer.close()
+                delay = min(delay * 2, RECONNECT_MAX_DELAY)
+                continue
+            logger.info(f"Reconnected to pool broker at {self.socket_path}")
+            return
+
+    # FdoDaemonPoolManager interface
+
+    @property
+    def pool_size(self) -> int:
+        return self.get_pool_status().get("pool_size", 0)
+
+    @property
+    def base_port(self) -> int:
+        return self._state["base_port"]
+
+    @property
+    def slots_per_daemon(self) -> int:
+        return self._state["slots_per_daemon"]
+
+    def get_pool_status(self) -> Dict[str, Any]:
+        status = self._state["status"]
+        if self._connected:
+            return status
+        # Last known figures, but nothing can be checked out until the broker is back
+        return {**status, "instances_healthy": 0, "pool_health_percentage": 0,
+                "broker": {**status.get("broker", {}), "connected": False}}
+
+    def reset_circuit_breakers(self) -> int:
+        """Ask the broker to reset open breakers; returns how many were open in the last state."""
+        self._send({"op": "reset_circuit_breakers", "id": next(self._ids)})
+        return sum(1 for instance in self.get_pool_status().get("instances", []) if instance.get("circuit_breaker_open"))
+
+    async def get_healthy_instance_async(self, timeout: float = 5.0, avoid: Optional[Set[str]] = None,
+                                         lane: Optional[str] = None, size: int = 0) -> Optional[BrokerSlot]:
+        lane = self.scheduler.resolve_lane(lane, size)
+        if not self._connected:
+            self.scheduler.record_retry_after(lane, math.ceil(RECONNECT_MAX_DELAY))
+            return None
+        reply = await self._call({
+            "op": "checkout", "lane": lane, "avoid": sorted(avoid or ()), "size": size, "timeout": timeout,
+            "flow": current_flow()
+        }, timeout + CHECKOUT_TIMEOUT)
+        if reply["slot"] is None:
+            self.scheduler.record_retry_after(lane, reply.get("retry_after"))
+            return None
+        return BrokerSlot(self, reply["slot"])
+
+    async def try_checkout(self, lane: str, avoid: Optional[Set[str]] = None) -> Optional[BrokerSlot]:
+        if not self._connected:
+            return None
+        reply = await self._call({"op": "try_checkout", "lane": lane, "avoid": sorted(avoid or ())}, CHECKOUT_TIMEOUT)
+        return BrokerSlot(self, reply["slot"]) if reply["slot"] else None
+
+    async def release_slot(self, slot: BrokerSlot) -> None:
+        self._send_lease({"op": "release", "token": slot.token}, slot.instance)
+
+    async def record_request_result(self, instance: RemoteDaemon, success: bool,
+                                    service_time: Optional[float] = None) -> None:
+        self._send_lease({"op": "result", "token": instance.token, "ok": success, "duration": service_time}, instance)
+
+    def recycle_instance(self, instance: RemoteDaemon, reason: str) -> None:
+        self._send_lease({"op": "recycle", "token": instance.token, "reason": reason}, instance)
+
+    async def merged_metrics(self) -> str:
+        """
+        Prometheus text for /metrics: the pool families maintained by the broker
+        plus every worker's own families, labelled with the worker's pid.
+        """
+        text = self._worker_metrics()
+        if not self._connected:
+            return text
+        reply = await self._call({"op": "metrics", "text": text}, CHECKOUT_TIMEOUT)
+        return reply["text"]
+
+    def _worker_metrics(self) -> str:
+        return REGISTRY.render(exclude=BROKER_METRICS, labels={"worker": os.getpid()})
+
+    async def _push_metrics(self) -> None:
+        """Keep the broker's copy of this worker's metrics fresh for scrapes that reach other workers."""
+        while not self._closed:
+            await asyncio.sleep(self.metrics_interval)
+            if self._connected:
+                try:
+                    self._send({"op": "worker_metrics", "text": self._worker_metrics()})
+                except ConnectionError:
+                    pass
+
+    async def close(self) -> None:
+        self._closed = True
+        for task in (self._reconnect_task, self._metrics_task):
+            if task is not None:
+                task.cancel()
+        if self._writer is not None:
+            self._writer.close()
+        if self._reader_task is not None:
+            self._reader_task.cancel()
+
+    # Transport
+
+    def _send(self, message: Dict[str, Any]) -> None:
+        if self._writer is None or self._writer.is_closing():
+            raise ConnectionError("Pool broker connection is closed")
+        self._writer.write(_encode(message))
+
+    def _send_lease(self, message: Dict[str, Any], instance: RemoteDaemon) -> None:
+        """Send a message about a lease; dropped if the lease's connection is gone (the broker released it)."""
+        if instance.generation == self._generation and self._connected:
+            self._send(message)
+
+    async def _call(self, message: Dict[str, Any], timeout: float) -> Dict[str, Any]:
+        message["id"] = request_id = next(self._ids)
+        generation = self._generation
+        future = asyncio.get_running_loop().create_future()
+        self._pending[request_id] = future
+        try:
+            self._send(message)
+            return await asyncio.wait_for(future, timeout)
+        except (asyncio.CancelledError, asyncio.TimeoutError):
+            # Abandoned: a reply that already arrived is handed back, otherwise the broker drops the request
+            if future.done() and not future.cancelled() and future.exception() is None:
+                self._release_orphan(future.result(), generation)
+            elif generation == self._generation and self._connected:
+                self._send({"op": "cancel", "id": request_id})
+            raise
+        finally:
+            self._pending.pop(request_id, None)
+
+    def _release_orphan(self, reply: Dict[str, Any], generation: int) -> None:
+        """Release a slot granted to a checkout whose caller is gone, so the broker does not hold it forever."""
+        if reply.get("slot") and generation == self._generation and self._connected:
+            self._send({"op": "release", "token": reply["slot"]["token"]})
+
+    async def _read_loop(self, reader: asyncio.StreamReader, generation: int) -> None:
+        error: BaseException = ConnectionError("Pool broker closed the connection")
+        try:
+            while True:
+                line = await reader.readline()
+                if not line:
+                    break
+                message = json.loads(line)
+                if message.get("op") == "state":
+                    self._state = message["state"]
+                    continue
+                future = self._pending.get(message.get("id"))
+                if future is not None and not future.done():
+                    future.set_result(message)
+                else:
+                    self._release_orphan(message, generation)
+        except (ConnectionError, ValueError) as e:
+            error = e
+        if generation != self._generation:
+            return
+        was_connected, self._connected = self._connected, False
+        if self._writer is not None:
+            self._writer.close()
+        for future in self._pending.values():
+            if not future.done():
+                future.set_exception(error)
+        if was_connected and not self._closed:
+            logger.error(f"Lost connection to pool broker at {self.socket_path}: {error}; reconnecting")
+            self._reconnect_task = asyncio.ensure_future(self._reconnect())
+
+
+# --- Process management ---
+
+def discover_daemon_exe() -> Optional[str]:
+    """Daemon executable of the latest FDO release/backend (honours FDO_DAEMON_EXE), or None."""
+    from fdo_tools_manager import get_fdo_tools_manager
+
+    tools = get_fdo_tools_manager()
+    tools.discover_releases()
+    if not tools.select_latest_release():
+        logger.error("No FDO releases/backends found")
+        return None
+    daemon_exe = tools.get_daemon_exe_path()
+    if not daemon_exe:
+        logger.error("fdo_daemon.exe not found in selected release or backend drop")
+    return daemon_exe
+
+
+def pool_fingerprint(exe_path: str) -> str:
+    """Hash of the daemon executable and every pool setting in the environment."""
+    settings = sorted(
+        (name, value) for name, value in os.environ.items()
+        if name.startswith(FINGERPRINT_PREFIXES) and not name.startswith(FINGERPRINT_EXCLUDED)
+    )
+    return hashlib.sha256(json.dumps([os.path.abspath(exe_path), settings]).encode("utf-8")).hexdigest()[:16]
+
+
+def read_supervisor_state(path: str = SUPERVISOR_STATE) -> Dict[str, Any]:
+    try:
+        with open(path) as f:
+            return json.load(f)
+    except (OSError, ValueError):
+        return {}
+
+
+def _pid_alive(pid: Optional[int]) -> bool:
+    """Whether a process exists and has not exited (an unreaped zombie counts as exited)."""
+    if not pid:
+        return False
+    try:
+        with open(f"/proc/{pid}/stat") as f:
+            return f.read().rsplit(")", 1)[1].split()[0] != "Z"
+    except (OSError, IndexError):
+        return False
+
+
+def _socket_ready(socket_path: str) -> bool:
+    probe = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+    try:
+        probe.connect(socket_path)
+        return True
+    except OSError:
+        return False
+    finally:
+        probe.close()
+
+
+def start_broker_process(socket_path: str = DEFAULT_SOCKET, startup_timeout: float = 600.0,
+                         persistent: bool = False) -> subprocess.Popen:
+    """
+    Start the broker and wait until it accepts connections.
+
+    A persistent broker runs as a supervisor in its own session, logging to
+    SUPERVISOR_LOG and maintaining SUPERVISOR_STATE, and is not stopped when
+    this process exits.
+
+    Raises:
+        RuntimeError: If the broker exits or is not ready within startup_timeout
+    """
+    env = {**os.environ, "FDO_POOL_BROKER_SOCKET": socket_path}
+    if persistent:
+        env["FDO_POOL_SUPERVISOR"] = "true"
+        with open(SUPERVISOR_LOG, "ab") as log_file:
+            proc = subprocess.Popen([sys.executable, os.path.abspath(__file__)], env=env, stdin=subprocess.DEVNULL,
+                                    stdout=log_file, stderr=subprocess.STDOUT, start_new_session=True)
+    else:
+        env.pop("FDO_POOL_SUPERVISOR", None)
+        proc = subprocess.Popen([sys.executable, os.path.abspath(__file__)], env=env)
+    deadline = time.time() + startup_timeout
+    while time.time() < deadline:
+        if proc.poll() is not None:
+            raise RuntimeError(f"Pool broker exited during startup (code {proc.returncode})")
+        if _socket_ready(socket_path):
+            return proc
+        time.sleep(0.2)
+    proc.terminate()
+    raise RuntimeError(f"Pool broker not ready within {startup_timeout:.0f}s")
+
+
+def stop_broker_process(proc: subprocess.Popen) -> None:
+    proc.terminate()
+    try:
+        proc.wait(timeout=30)
+    except subprocess.TimeoutExpired:
+        proc.kill()
+        proc.wait()
+
+
+def stop_supervisor(state_path: str = SUPERVISOR_STATE, timeout: float = 60.0) -> bool:
+    """Stop the supervisor recorded in the state file; returns False if none was running."""
+    state = read_supervisor_state(state_path)
+    pid = state.get("pid")
+    if not _pid_alive(pid):
+        return False
+    os.kill(pid, signal.SIGTERM)
+    deadline = time.time() + timeout
+    while _pid_alive(pid) and time.time() < deadline:
+        time.sleep(0.2)
+    if _pid_alive(pid):
+        logger.warning(f"Pool supervisor {pid} did not stop within {timeout:.0f}s, killing it")
+        os.kill(pid, signal.SIGKILL)
+    return True
+
+
+def _reap_orphans(state: Dict[str, Any]) -> None:
+    """Kill daemons left running by a supervisor that died without stopping them."""
+    exe_name = os.path.basename(state.get("exe_path") or "")
+    for daemon in state.get("daemons", []):
+        pid = daemon.get("pid")
+        try:
+            with open(f"/proc/{pid}/cmdline", "rb") as f:
+                cmdline = f.read().decode("utf-8", "replace")
+        except (OSError, TypeError):
+            continue
+        if not exe_name or exe_name not in cmdline:
+            continue  # Pid was reused by something else
+        logger.warning(f"Killing orphaned daemon {daemon.get('id')} (pid {pid}, port {daemon.get('port')})")
+        for child in reversed(process_tree(pid)):
+            try:
+                os.kill(child, signal.SIGKILL)
+            except ProcessLookupError:
+                pass
+
+
+def ensure_supervisor(socket_path: str, exe_path: str, startup_timeout: float = 600.0) -> bool:
+    """
+    Reattach to the running pool supervisor, or start one.
+
+    A supervisor is reused if it is alive, listening on socket_path and was
+    started with the same pool fingerprint; otherwise it is stopped (or its
+    orphaned daemons are cleaned up) and a new one is started.
+
+    Returns:
+        True if an existing supervisor was reattached, False if one was started
+    """
+    fingerprint = pool_fingerprint(exe_path)
+    with open(f"{SUPERVISOR_STATE}.lock", "w") as lock:
+        # Serialise API processes starting at the same time so only one supervisor is started
+        fcntl.flock(lock, fcntl.LOCK_EX)
+        state = read_supervisor_state()
+        if _pid_alive(state.get("pid")):
+            if state.get("fingerprint") == fingerprint and state.get("socket") == socket_path \
+                    and _socket_ready(socket_path):
+                logger.info(f"Reattached to pool supervisor {state['pid']} on {socket_path} "
+                            f"({len(state.get('daemons', []))} daemons)")
+                return True
+            logger.info(f"Pool configuration changed, replacing pool supervisor {state['pid']}")
+            stop_supervisor()
+        elif state:
+            logger.warning(f"Pool supervisor {state.get('pid')} is gone, cleaning up after it")
+            _reap_orphans(state)
+        proc = start_broker_process(socket_path, startup_timeout, persistent=True)
+        logger.info(f"Started pool supervisor {proc.pid} on {socket_path} (log: {SUPERVISOR_LOG})")
+        return False
+
+
+def main() -> int:
+    """Broker process entry point: start the pool from the environment and serve it."""
+    logging.basicConfig(level=logging.INFO)
+    if "--stop" in sys.argv[1:]:
+        # Stop a persistent supervisor and its daemons
+        return 0 if stop_supervisor() else 1
+
+    daemon_exe = discover_daemon_exe()
+    if not daemon_exe:
+        return 1
+
+    persistent = os.getenv("FDO_POOL_SUPERVISOR", "false").lower() == "true"
+    pool_manager = FdoDaemonPoolManager.from_env(daemon_exe, os.getenv("FDO_DAEMON_BIND", "127.0.0.1"))
+    pool_manager.start()
+    broker = PoolBroker(
+        pool_manager, os.getenv("FDO_POOL_BROKER_SOCKET", DEFAULT_SOCKET),
+        state_file=SUPERVISOR_STATE if persistent else None,
+        fingerprint=pool_fingerprint(daemon_exe)
+    )
+
+    async def run() -> None:
+        stop = asyncio.Event()
+        loop = asyncio.get_running_loop()
+        for sig in (signal.SIGTERM, signal.SIGINT):
+            loop.add_signal_handler(sig, stop.set)
+        await broker.serve(stop)
+
+    try:
+        asyncio.run(run())
+    finally:
+        pool_manager.stop()
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,505 @@
+#!/usr/bin/env python3
+"""
+Pool Scheduler
+Priority lanes for daemon checkout.
+
+Requests wait in per-lane queues instead of polling. Whenever a daemon
+becomes idle the scheduler picks a lane by smooth weighted round-robin among
+lanes that have waiters, are under their concurrency limit, and would not eat
+into capacity reserved for other lanes. Interactive editor requests therefore
+keep a reserved daemon and the biggest weight, while bulk JSONL work and very
+large inputs cannot occupy the whole pool.
+
+Within a lane, waiters are grouped into flows (one per HTTP request) served by
+deficit round-robin with input bytes as the cost, so concurrent /compile-chunk
+requests split the lane evenly instead of the oldest, biggest script taking
+most of the pool.
+
+Admission control bounds the queues: before doing daemon work an endpoint
+asks admit() for an estimate of the lane's queue wait (waiters ahead, the
+lane's share of the pool and its observed daemon hold time). Work that would
+wait longer than the lane's budget is rejected up front with
+PoolOverloadedError carrying a Retry-After hint, rather than being parked
+until the checkout times out.
+
+The lane and flow are carried in context variables set by the endpoint, so
+nested work (chunker fan-out, JSONL frame loops) inherits them without
+signature changes.
+
+Capacity is counted in request slots rather than daemons: a daemon started
+with --threads N offers N slots, and reservations, limits and wait estimates
+all apply to the pool's total slot count.
+"""
+
+import os
+import time
+import asyncio
+import math
+import logging
+import itertools
+from collections import deque
+from contextvars import ContextVar
+from dataclasses import dataclass, field
+from typing import Deque, Dict, List, Optional, Set, TYPE_CHECKING
+
+from metrics import POOL_ADMISSION_REJECTIONS
+
+if TYPE_CHECKING:
+    from fdo_daemon_pool_manager import FdoDaemonPoolManager, DaemonSlot
+
+logger = logging.getLogger(__name__)
+
+LANE_INTERACTIVE = "interactive"
+LANE_CHUNKING = "chunking"
+LANE_BULK = "bulk"
+LANE_LARGE = "large"
+
+# name:weight:reserve_fraction:limit_fraction[:wait_budget_seconds]
+DEFAULT_LANES = "interactive:8:0.1:1.0:1,chunking:4:0:1.0:5,bulk:2:0:1.0:10,large:1:0:0.25:10"
+DEFAULT_WAIT_BUDGET = 5.0
+
+# Minimum checkout timeout; admitted requests wait up to twice their lane's budget
+CHECKOUT_TIMEOUT = 5.0
+
+# Assumed daemon hold time before any request has been observed
+DEFAULT_SERVICE_TIME = 0.1
+
+# Weight of the newest sample in the per-lane hold time EWMA
+HOLD_TIME_ALPHA = 0.2
+
+# Inputs at least this large (bytes) are scheduled in the large lane
+LARGE_INPUT_BYTES = int(os.getenv("FDO_POOL_LARGE_INPUT_BYTES", "32768"))
+
+# Deficit round-robin quantum (input bytes credited to a flow per round)
+DRR_QUANTUM_BYTES = int(os.getenv("FDO_POOL_DRR_QUANTUM", "4096"))
+
+# Interval at which waiters re-run dispatch themselves, covering daemons that
+# become healthy from the health monitor thread (which cannot resolve futures)
+WAITER_RECHECK_INTERVAL = 0.25
+
+_request_lane: ContextVar[str] = ContextVar("pool_request_lane", default=LANE_INTERACTIVE)
+_request_flow: ContextVar[Optional[object]] = ContextVar("pool_request_flow", default=None)
+_flow_ids = itertools.count(1)
+
+
+def set_request_lane(lane: str) -> None:
+    """
+    Set the scheduling lane for daemon work done by the current request.
+
+    Also starts a new fair-share flow, so all checkouts made by this request
+    (including from tasks it spawns) share one round-robin slot in the lane.
+    """
+    _request_lane.set(lane)
+    _request_flow.set(next(_flow_ids))
+
+
+def set_request_flow(flow: object) -> None:
+    """Join an existing fair-share flow (e.g. one forwarded from an API worker by the pool broker)."""
+    _request_flow.set(flow)
+
+
+def current_lane() -> str:
+    return _request_lane.get()
+
+
+def current_flow() -> Optional[object]:
+    return _request_flow.get()
+
+
+class PoolOverloadedError(RuntimeError):
+    """Raised when the pool cannot serve a request within its lane's wait budget."""
+
+    def __init__(self, lane: str, estimated_wait: float, retry_after: int, message: Optional[str] = None):
+        self.lane = lane
+        self.estimated_wait = estimated_wait
+        self.retry_after = retry_after
+        super().__init__(message or (
+            f"Daemon pool overloaded: estimated {estimated_wait:.2f}s wait in lane '{lane}', "
+            f"retry after {retry_after}s"
+        ))
+
+
+@dataclass
+class LaneConfig:
+    """Scheduling parameters for one lane."""
+    name: str
+    weight: int                  # Share of dispatches when several lanes are waiting
+    reserve_fraction: float      # Fraction of the pool held back for this lane (at least one slot if > 0)
+    limit_fraction: float        # Maximum fraction of the pool this lane may occupy (at least one slot)
+    wait_budget: float = DEFAULT_WAIT_BUDGET  # Admission rejects work expected to queue longer (seconds)
+
+    def reserve(self, pool_size: int) -> int:
+        if self.reserve_fraction <= 0:
+            return 0
+        return max(1, int(pool_size * self.reserve_fraction))
+
+    def limit(self, pool_size: int) -> int:
+        return max(1, int(pool_size * self.limit_fraction))
+
+
+@dataclass(eq=False)
+class _Waiter:
+    future: asyncio.Future
+    avoid: Optional[Set[str]]
+    flow: object                # Fair-share key (request flow id, or the waiter itself)
+    cost: int                   # Input bytes, charged against the flow's deficit
+    enqueued_at: float = field(default_factory=time.monotonic)
+
+
+@dataclass
+class _Lane:
+    config: LaneConfig
+    flows: Dict[object, Deque[_Waiter]] = field(default_factory=dict)
+    active: Deque[object] = field(default_factory=deque)   # Round-robin order of flows with waiters
+    deficit: Dict[object, int] = field(default_factory=dict)
+    waiting: int = 0
+    current_weight: int = 0     # Smooth weighted round-robin state
+    dispatched: int = 0
+    rejected: int = 0
+    hold_time: Optional[float] = None  # EWMA of checkout-to-release time (seconds)
+
+    def enqueue(self, waiter: _Waiter) -> None:
+        queue = self.flows.get(waiter.flow)
+        if queue is None:
+            queue = self.flows[waiter.flow] = deque()
+            self.active.append(waiter.flow)
+            self.deficit[waiter.flow] = 0
+        queue.append(waiter)
+        self.waiting += 1
+
+    def remove(self, waiter: _Waiter) -> None:
+        queue = self.flows.get(waiter.flow)
+        if queue is None or waiter not in queue:
+            return
+        queue.remove(waiter)
+        self.waiting -= 1
+        if not queue:
+            self._retire(waiter.flow)
+
+    def next_waiter(self) -> Optional[_Waiter]:
+        """
+        Dequeue by deficit round-robin across flows.
+
+        The flow at the head of the round keeps being served while its deficit
+        covers the next waiter's cost; otherwise it is credited a quantum and
+        moved to the back. Every queued waiter is pending (abandoned waiters
+        are removed eagerly), so this always returns one if any are queued.
+        """
+        while self.active:
+            key = self.active[0]
+            queue = self.flows[key]
+            head = queue[0]
+            if self.deficit[key] >= head.cost:
+                self.deficit[key] -= head.cost
+                queue.popleft()
+                self.waiting -= 1
+                if not queue:
+                    self._retire(key)
+                return head
+            self.deficit[key] += DRR_QUANTUM_BYTES
+            self.active.rotate(-1)
+        return None
+
+    def _retire(self, key: object) -> None:
+        # An idle flow forfeits its remaining deficit, as in classic DRR
+        del self.flows[key]
+        del self.deficit[key]
+        self.active.remove(key)
+
+
+def parse_lanes(spec: str) -> List[LaneConfig]:
+    """
+    Parse a lane spec ("name:weight:reserve_fraction:limit_fraction[:wait_budget],...").
+
+    Raises:
+        ValueError: If an entry is malformed
+    """
+    lanes = []
+    for entry in spec.split(","):
+        entry = entry.strip()
+        if not entry:
+            continue
+        parts = entry.split(":")
+        if len(parts) not in (4, 5):
+            raise ValueError(f"Invalid lane spec entry: {entry!r}")
+        name, weight, reserve, limit = parts[:4]
+        budget = float(parts[4]) if len(parts) == 5 else DEFAULT_WAIT_BUDGET
+        lanes.append(LaneConfig(name, max(1, int(weight)), float(reserve), float(limit), budget))
+    if not lanes:
+        raise ValueError("Lane spec defines no lanes")
+    return lanes
+
+
+class PoolScheduler:
+    """
+    Event-driven, lane-aware daemon checkout for FdoDaemonPoolManager.
+
+    All methods run on the event loop and complete without awaiting, so queue
+    and instance state changes are atomic with respect to other coroutines.
+    """
+
+    def __init__(self, pool_manager: "FdoDaemonPoolManager", lanes: Optional[List[LaneConfig]] = None):
+        self.pool_manager = pool_manager
+        if lanes is None:
+            lanes = parse_lanes(os.getenv("FDO_POOL_LANES", DEFAULT_LANES))
+        self.lanes: Dict[str, _Lane] = {config.name: _Lane(config) for config in lanes}
+        self.default_lane = LANE_INTERACTIVE if LANE_INTERACTIVE in self.lanes else lanes[0].name
+
+        logger.info("Pool scheduler lanes: " + ", ".join(
+            f"{c.name}(weight={c.weight}, reserve={c.reserve_fraction:g}, limit={c.limit_fraction:g}, "
+            f"budget={c.wait_budget:g}s)"
+            for c in lanes
+        ))
+
+    def resolve_lane(self, lane: Optional[str] = None, size: int = 0) -> str:
+        """Lane for a request: large inputs go to the large lane, otherwise the context lane."""
+        if size >= LARGE_INPUT_BYTES and LANE_LARGE in self.lanes:
+            return LANE_LARGE
+        lane = lane or current_lane()
+        return lane if lane in self.lanes else self.default_lane
+
+    def checkout_timeout(self, lane: str) -> float:
+        """How long an admitted request may wait for a daemon in this lane."""
+        return max(CHECKOUT_TIMEOUT, 2 * self.lanes[lane].config.wait_budget)
+
+    def estimate_wait(self, lane: str) -> float:
+        """
+        Estimate how long a new checkout in this lane would queue.
+
+        Waiters ahead of it are drained at the lane's throughput: the slots it
+        can use, scaled by its weighted share among lanes that are also waiting,
+        divided by its observed hold time.
+        """
+        state = self.lanes[lane]
+        if not state.waiting and self._grantable(lane):
+            return 0.0
+
+        capacity = min(self.max_concurrency(lane),
+                       sum(i.slots for i in self.pool_manager.instances if i.state == "healthy"))
+        if capacity <= 0:
+            return math.inf
+
+        competing = sum(other.config.weight for name, other in self.lanes.items()
+                        if other.waiting and name != lane)
+        share = state.config.weight / (state.config.weight + competing)
+        return (state.waiting + 1) * self._hold_time(lane) / (capacity * share)
+
+    def admit(self, lane: Optional[str] = None, size: int = 0) -> str:
+        """
+        Admission control for a request about to use the pool.
+
+        Args:
+            lane: Lane name (defaults to the lane set for the current request)
+            size: Input size in bytes
+
+        Returns:
+            Resolved lane name
+
+        Raises:
+            PoolOverloadedError: If the estimated wait exceeds the lane's budget
+        """
+        lane = self.resolve_lane(lane, size)
+        state = self.lanes[lane]
+        estimate = self.estimate_wait(lane)
+        if estimate <= state.config.wait_budget:
+            return lane
+
+        state.rejected += 1
+        POOL_ADMISSION_REJECTIONS.inc(lane)
+        raise PoolOverloadedError(lane, estimate, self.retry_after(lane, estimate))
+
+    def retry_after(self, lane: str, estimate: Optional[float] = None) -> int:
+        """Seconds until the lane's queue is expected to drain back within budget."""
+        if estimate is None:
+            estimate = self.estimate_wait(lane)
+        if math.isinf(estimate):
+            return int(max(CHECKOUT_TIMEOUT, self.pool_manager.health_interval))
+        return max(1, math.ceil(estimate - self.lanes[lane].config.wait_budget))
+
+    def record_release(self, slot: "DaemonSlot") -> None:
+        """Fold a finished checkout's hold time into its lane's EWMA."""
+        state = self.lanes.get(slot.lane)
+        if state is None:
+            return
+        held = time.time() - slot.started_at
+        if state.hold_time is None:
+            state.hold_time = held
+        else:
+            state.hold_time += HOLD_TIME_ALPHA * (held - state.hold_time)
+
+    def _hold_time(self, lane: str) -> float:
+        hold_time = self.lanes[lane].hold_time
+        if hold_time is not None:
+            return hold_time
+        observed = [i.ewma_service_time for i in self.pool_manager.instances if i.ewma_service_time is not None]
+        return sum(observed) / len(observed) if observed else DEFAULT_SERVICE_TIME
+
+    def _free_slots(self, idle: Optional[list] = None) -> int:
+        if idle is None:
+            idle = self.pool_manager.idle_instances()
+        return sum(instance.slots - instance.in_flight for instance in idle)
+
+    def _grantable(self, lane: str) -> bool:
+        """Whether a checkout in this lane would be granted immediately."""
+        idle = self._free_slots()
+        if not idle:
+            return False
+        pool_size = self.pool_manager.capacity()
+        busy = self._busy_by_lane()
+        if busy[lane] >= self.lanes[lane].config.limit(pool_size):
+            return False
+        reserved_elsewhere = sum(max(0, other.config.reserve(pool_size) - busy[name])
+                                 for name, other in self.lanes.items() if name != lane)
+        return idle - 1 >= reserved_elsewhere
+
+    def try_checkout(self, lane: str, avoid: Optional[Set[str]] = None) -> Optional["DaemonSlot"]:
+        """
+        Grant a free slot immediately or not at all.
+
+        Only succeeds when nothing is queued in any lane, so speculative work
+        (request hedging) never takes a slot a waiting request could use.
+        Daemons in avoid are never used.
+        """
+        if any(state.waiting for state in self.lanes.values()) or not self._grantable(lane):
+            return None
+        manager = self.pool_manager
+        idle = [i for i in manager.idle_instances() if not avoid or i.id not in avoid]
+        if not idle:
+            return None
+        self.lanes[lane].dispatched += 1
+        return manager.acquire_slot(manager.select_idle_instance(idle), lane)
+
+    async def checkout(self, lane: str, avoid: Optional[Set[str]], timeout: float,
+                       size: int = 0) -> Optional["DaemonSlot"]:
+        """
+        Wait for a daemon slot in the given lane.
+
+        Args:
+            lane: Lane name (see resolve_lane)
+            avoid: Daemon ids to use only if no other daemon is idle
+            timeout: Maximum seconds to wait
+            size: Input bytes, the waiter's fair-share cost within its flow
+
+        Returns:
+            Checked-out DaemonSlot, or None on timeout
+        """
+        loop = asyncio.get_running_loop()
+        future = loop.create_future()
+        flow = current_flow()
+        waiter = _Waiter(future, avoid, flow if flow is not None else future, max(1, size))
+        self.lanes[lane].enqueue(waiter)
+        self.dispatch()
+
+        deadline = time.monotonic() + timeout
+        try:
+            while not waiter.future.done():
+                remaining = deadline - time.monotonic()
+                if remaining <= 0:
+                    break
+                await asyncio.wait({waiter.future}, timeout=min(remaining, WAITER_RECHECK_INTERVAL))
+                if not waiter.future.done():
+                    self.dispatch()
+        except asyncio.CancelledError:
+            self._abandon(lane, waiter)
+            raise
+
+        if waiter.future.done():
+            return waiter.future.result()
+
+        self._abandon(lane, waiter)
+        return None
+
+    def _abandon(self, lane: str, waiter: _Waiter) -> None:
+        """Drop a waiter; if a slot was already handed to it, give the slot back."""
+        self.lanes[lane].remove(waiter)
+        if waiter.future.done() and not waiter.future.cancelled():
+            self.pool_manager.free_slot(waiter.future.result())
+            self.dispatch()
+        else:
+            waiter.future.cancel()
+
+    def dispatch(self) -> None:
+        """Hand free slots to waiting requests, lane by lane."""
+        manager = self.pool_manager
+        while True:
+            idle = manager.idle_instances()
+            if not idle:
+                return
+
+            lane = self._pick_lane(self._free_slots(idle))
+            if lane is None:
+                return
+
+            waiter = lane.next_waiter()
+            instance = manager.select_idle_instance(idle, waiter.avoid)
+            lane.dispatched += 1
+            waiter.future.set_result(manager.acquire_slot(instance, lane.config.name))
+
+    def max_concurrency(self, lane: Optional[str] = None) -> int:
+        """Most slots a lane can hold at once: its limit, less capacity reserved for other lanes."""
+        lane = self.resolve_lane(lane)
+        pool_size = (self.pool_manager.capacity() or
+                     self.pool_manager.pool_size * self.pool_manager.slots_per_daemon)
+        reserved_elsewhere = sum(other.config.reserve(pool_size)
+                                 for name, other in self.lanes.items() if name != lane)
+        return max(1, min(self.lanes[lane].config.limit(pool_size), pool_size - reserved_elsewhere))
+
+    def _busy_by_lane(self) -> Dict[str, int]:
+        busy = {name: 0 for name in self.lanes}
+        for instance in self.pool_manager.instances:
+            for slot in instance.active:
+                if slot.lane in busy:
+                    busy[slot.lane] += 1
+        return busy
+
+    def _pick_lane(self, idle_count: int) -> Optional[_Lane]:
+        """Smooth weighted round-robin over lanes allowed to take one more slot."""
+        pool_size = self.pool_manager.capacity()
+        busy = self._busy_by_lane()
+
+        # Free slots that must stay free to honour other lanes' unfilled reservations
+        unfilled = {name: max(0, lane.config.reserve(pool_size) - busy[name]) for name, lane in self.lanes.items()}
+        total_unfilled = sum(unfilled.values())
+
+        eligible = []
+        for name, lane in self.lanes.items():
+            if not lane.waiting:
+                continue
+            if busy[name] >= lane.config.limit(pool_size):
+                continue
+            if idle_count - 1 < total_unfilled - unfilled[name]:
+                continue
+            eligible.append(lane)
+
+        if not eligible:
+            return None
+
+        total_weight = sum(lane.config.weight for lane in eligible)
+        for lane in eligible:
+            lane.current_weight += lane.config.weight
+        chosen = max(eligible, key=lambda lane: lane.current_weight)
+        chosen.current_weight -= total_weight
+        return chosen
+
+    def get_status(self) -> Dict[str, Dict]:
+        pool_size = self.pool_manager.capacity()
+        busy = self._busy_by_lane()
+        now = time.monotonic()
+        status = {}
+        for name, lane in self.lanes.items():
+            oldest = min((queue[0].enqueued_at for queue in lane.flows.values()), default=None)
+            status[name] = {
+                "weight": lane.config.weight,
+                "reserved": lane.config.reserve(pool_size),
+                "limit": lane.config.limit(pool_size),
+                "busy": busy[name],
+                "waiting": lane.waiting,
+                "flows": len(lane.flows),
+                "oldest_wait_ms": round((now - oldest) * 1000, 1) if oldest is not None else None,
+                "dispatched": lane.dispatched,
+                "rejected": lane.rejected,
+                "wait_budget_s": lane.config.wait_budget,
+                "hold_time_ms": round(lane.hold_time * 1000, 3) if lane.hold_time is not None else None,
+                "estimated_wait_ms": round(min(self.estimate_wait(name), 1e9) * 1000, 1)
+            }
+        return status
@@ -0,0 +1,123 @@
+#!/usr/bin/env python3
+"""
+Request Timing
+Lightweight per-request phase recorder exposed as a Server-Timing header.
+
+A SpanRecorder is installed in a context variable at the start of each HTTP
+request, so FdoChunker, FdoDaemonPoolClient, FdoDaemonClient and JsonlProcessor
+can record phases without the recorder being threaded through every call.
+Phase durations accumulate: concurrent daemon calls made by one request add up,
+so "daemon" may exceed the request's wall time when atoms compile in parallel.
+
+The "daemon" phase is the HTTP round trip to the daemon and includes Ada32
+compile/decompile time; the daemon does not report its internal time separately.
+"""
+
+import time
+import logging
+from contextlib import contextmanager
+from contextvars import ContextVar
+from typing import Dict, List, Optional, Any
+
+logger = logging.getLogger(__name__)
+
+# Maximum daemon ids listed in the Server-Timing description
+MAX_DAEMON_IDS_IN_HEADER = 8
+
+
+class SpanRecorder:
+    """Accumulates per-phase durations and the daemons used by one request."""
+
+    __slots__ = ("started_at", "phases", "counts", "daemon_ids")
+
+    def __init__(self):
+        self.started_at = time.perf_counter()
+        self.phases: Dict[str, float] = {}   # phase -> accumulated seconds
+        self.counts: Dict[str, int] = {}     # phase -> number of spans
+        self.daemon_ids: List[str] = []      # daemons used, in first-use order
+
+    def add(self, phase: str, duration: float) -> None:
+        self.phases[phase] = self.phases.get(phase, 0.0) + duration
+        self.counts[phase] = self.counts.get(phase, 0) + 1
+
+    def record_daemon(self, daemon_id: str) -> None:
+        if daemon_id not in self.daemon_ids:
+            self.daemon_ids.append(daemon_id)
+
+    @contextmanager
+    def span(self, phase: str):
+        start = time.perf_counter()
+        try:
+            yield
+        finally:
+            self.add(phase, time.perf_counter() - start)
+
+    def elapsed(self) -> float:
+        return time.perf_counter() - self.started_at
+
+    def server_timing_header(self) -> str:
+        """Render phases as a Server-Timing header value (durations in milliseconds)."""
+        entries = []
+        for phase, duration in self.phases.items():
+            entry = f"{phase};dur={duration * 1000:.2f}"
+            if phase == "daemon" and self.daemon_ids:
+                daemons = ",".join(self.daemon_ids[:MAX_DAEMON_IDS_IN_HEADER])
+                entry += f';desc="{self.counts[phase]}x {daemons}"'
+            entries.append(entry)
+        entries.append(f"total;dur={self.elapsed() * 1000:.2f}")
+        return ", ".join(entries)
+
+    def as_dict(self) -> Dict[str, Any]:
+        """Timings block for JSON responses."""
+        return {
+            "total_ms": round(self.elapsed() * 1000, 3),
+            "phases_ms": {phase: round(duration * 1000, 3) for phase, duration in self.phases.items()},
+            "phase_counts": dict(self.counts),
+            "daemons": list(self.daemon_ids)
+        }
+
+
+_current_recorder: ContextVar[Optional[SpanRecorder]] = ContextVar("request_span_recorder", default=None)
+
+
+def start_recording() -> SpanRecorder:
+    """Install a fresh recorder for the current request context."""
+    recorder = SpanRecorder()
+    _current_recorder.set(recorder)
+    return recorder
+
+
+def current_recorder() -> Optional[SpanRecorder]:
+    return _current_recorder.get()
+
+
+@contextmanager
+def span(phase: str):
+    """Time a phase on the current request's recorder (no-op outside a request)."""
+    recorder = _current_recorder.get()
+    if recorder is None:
+        yield
+        return
+    start = time.perf_counter()
+    try:
+        yield
+    finally:
+        recorder.add(phase, time.perf_counter() - start)
+
+
+def add_phase(phase: str, duration: float) -> None:
+    recorder = _current_recorder.get()
+    if recorder is not None:
+        recorder.add(phase, duration)
+
+
+def record_daemon(daemon_id: str) -> None:
+    recorder = _current_recorder.get()
+    if recorder is not None:
+        recorder.record_daemon(daemon_id)
+
+
+def timings_block() -> Optional[Dict[str, Any]]:
+    """Current recorder's timings, or None outside a request."""
+    recorder = _current_recorder.get()
+    return recorder.as_dict() if recorder is not None else None
@@ -0,0 +1,208 @@
+#!/usr/bin/env python3
+"""
+Response Compression
+ASGI middleware that compresses responses according to Accept-Encoding.
+
+zstd is preferred when the client accepts it and the zstandard package is
+installed, otherwise gzip. Responses smaller than the minimum size, already
+encoded, or of a content type that does not compress (images, archives) are
+passed through. Streaming responses are compressed chunk by chunk.
+"""
+
+import gzip
+import zlib
+from typing import Dict, List, Optional, Tuple
+
+try:
+    import zstandard
+except ImportError:  # zstd is optional; gzip is always available
+    zstandard = None
+
+# Content types sent as-is (already compressed or not worth it)
+INCOMPRESSIBLE_TYPES = ("image/", "video/", "audio/", "application/zip", "application/gzip", "application/zstd",
+                        "application/x-gzip")
+
+GZIP_LEVEL = 5
+ZSTD_LEVEL = 3
+
+
+def available_encodings() -> List[str]:
+    """Encodings this process can produce, in order of preference."""
+    return (["zstd"] if zstandard is not None else []) + ["gzip"]
+
+
+def choose_encoding(accept_encoding: str, encodings: List[str]) -> Optional[str]:
+    """
+    Pick the preferred encoding the client accepts.
+
+    Args:
+        accept_encoding: Accept-Encoding header value (q-values honoured, q=0 refuses)
+        encodings: Encodings on offer, in order of preference
+
+    Returns:
+        Encoding name, or None to send the response uncompressed
+    """
+    accepted: Dict[str, float] = {}
+    for part in accept_encoding.lower().split(","):
+        name, _, params = part.strip().partition(";")
+        quality = 1.0
+        params = params.strip()
+        if params.startswith("q="):
+            try:
+                quality = float(params[2:])
+            except ValueError:
+                quality = 0.0
+        if name:
+            accepted[name.strip()] = quality
+
+    best, best_quality = None, 0.0
+    for encoding in encodings:
+        quality = accepted.get(encoding, accepted.get("*", 0.0))
+        if quality > best_quality:
+            best, best_quality = encoding, quality
+    return best
+
+
+class _Compressor:
+    """Incremental compressor for one response body."""
+
+    def __init__(self, encoding: str):
+        if encoding == "zstd":
+            self._obj = zstandard.ZstdCompressor(level=ZSTD_LEVEL).compressobj()
+            self._flush = lambda: self._obj.flush(zstandard.COMPRESSOBJ_FLUSH_FINISH)
+        else:
+            self._obj = zlib.compressobj(GZIP_LEVEL, zlib.DEFLATED, 16 + zlib.MAX_WBITS)  # gzip container
+            self._flush = self._obj.flush
+
+    def compress(self, data: bytes) -> bytes:
+        return self._obj.compress(data)
+
+    def finish(self) -> bytes:
+        return self._flush()
+
+
+def compress_body(body: bytes, encoding: str) -> bytes:
+    """Compress a complete body in one call."""
+    if encoding == "zstd":
+        return zstandard.ZstdCompressor(level=ZSTD_LEVEL).compress(body)
+    return gzip.compress(body, compresslevel=GZIP_LEVEL, mtime=0)
+
+
+class CompressionMiddleware:
+    """Compress responses of at least minimum_size bytes per the request's Accept-Encoding."""
+
+    def __init__(self, app, minimum_size: int = 1024, encodings: Optional[List[str]] = None):
+        """
+        Args:
+            app: ASGI application to wrap
+            minimum_size: Bodies smaller than this are sent uncompressed
+            encodings: Encodings to offer, in order of preference (default: available_encodings())
+        """
+        self.app = app
+        self.minimum_size = minimum_size
+        self.encodings = [e for e in (encodings or available_encodings()) if e in available_encodings()]
+
+    async def __call__(self, scope, receive, send) -> None:
+        if scope["type"] != "http":
+            await self.app(scope, receive, send)
+            return
+        accept_encoding = ""
+        for name, value in scope.get("headers", ()):
+            if name == b"accept-encoding":
+                accept_encoding = value.decode("latin-1")
+                break
+        encoding = choose_encoding(accept_encoding, self.encodings) if accept_encoding else None
+        if encoding is None:
+            await self.app(scope, receive, send)
+            return
+        await _CompressedResponder(self.app, encoding, self.minimum_size)(scope, receive, send)
+
+
+class _CompressedResponder:
+    """Buffers the start of one response to decide whether to compress it, then streams the rest."""
+
+    def __init__(self, app, encoding: str, minimum_size: int):
+        self.app = app
+        self.encoding = encoding
+        self.minimum_size = minimum_size
+        self.send = None
+        self.start_message: Optional[dict] = None
+        self.buffer: List[bytes] = []
+        self.buffered = 0
+        self.compressor: Optional[_Compressor] = None
+        self.passthrough = False
+
+    async def __call__(self, scope, receive, send) -> None:
+        self.send = send
+        await self.app(scope, receive, self._send)
+
+    async def _send(self, message: dict) -> None:
+        kind = message["type"]
+        if kind == "http.response.start":
+            headers = _header_map(message.get("headers", ()))
+            content_type = headers.get(b"content-type", b"").decode("latin-1").lower()
+            self.passthrough = (
+                b"content-encoding" in headers or content_type.startswith(INCOMPRESSIBLE_TYPES)
+                or message.get("status", 200) in (204, 304)
+            )
+            if self.passthrough:
+                await self.send(message)
+            else:
+                self.start_message = message
+            return
+        if kind != "http.response.body" or self.passthrough:
+            await self.send(message)
+            return
+
+        body = message.get("body", b"")
+        more_body = message.get("more_body", False)
+
+        if self.compressor is not None:
+            # Already streaming compressed output
+            data = self.compressor.compress(body)
+            if not more_body:
+                data += self.compressor.finish()
+            if data or not more_body:
+                await self.send({"type": "http.response.body", "body": data, "more_body": more_body})
+            return
+
+        self.buffer.append(body)
+        self.buffered += len(body)
+        if more_body and self.buffered < self.minimum_size:
+            return  # Not enough yet to decide
+
+        pending = b"".join(self.buffer)
+        self.buffer = []
+        if self.buffered < self.minimum_size:
+            # Whole body is below the threshold
+            await self.send(self.start_message)
+            await self.send({"type": "http.response.body", "body": pending, "more_body": False})
+            return
+
+        if not more_body:
+            compressed = compress_body(pending, self.encoding)
+            await self.send(self._start(len(compressed)))
+            await self.send({"type": "http.response.body", "body": compressed, "more_body": False})
+            return
+
+        self.compressor = _Compressor(self.encoding)
+        await self.send(self._start(None))
+        await self.send({"type": "http.response.body", "body": self.compressor.compress(pending), "more_body": True})
+
+    def _start(self, content_length: Optional[int]) -> dict:
+        """The buffered start message, re-headed for the compressed body."""
+        headers: List[Tuple[bytes, bytes]] = [
+            (name, value) for name, value in self.start_message.get("headers", ())
+            if name.lower() not in (b"content-length", b"content-encoding")
+        ]
+        headers.append((b"content-encoding", self.encoding.encode("ascii")))
+        if content_length is not None:
+            headers.append((b"content-length", str(content_length).encode("ascii")))
+        vary = [value for name, value in headers if name.lower() == b"vary"]
+        if not any(b"accept-encoding" in value.lower() for value in vary):
+            headers.append((b"vary", b"Accept-Encoding"))
+        return {**self.start_message, "headers": headers}
+
+
+def _header_map(headers) -> Dict[bytes, bytes]:
+    return {name.lower(): value for name, value in headers}
@@ -0,0 +1,294 @@
+#!/usr/bin/env python3
+"""
+Mock FDO Daemon
+Wine-free stand-in for fdo_daemon.exe speaking the same HTTP protocol:
+  - POST /compile    (text/plain) -> application/octet-stream
+  - POST /decompile  (application/octet-stream) -> text/plain
+  - GET  /health     -> JSON
+  - GET  /stats      -> JSON
+
+Answers come from the samples corpus (exact .txt <-> .bin matches); anything
+else gets a deterministic synthetic answer. Latency, error, crash and hang
+behaviour is configurable so pool scheduling, retry and recycling changes can
+be load-tested deterministically at large pool sizes.
+
+The pool manager launches it in place of fdo_daemon.exe when the daemon
+executable is a .py file:
+
+    FDO_DAEMON_EXE=bench/mock_fdo_daemon.py MOCK_FDO_LATENCY=lognormal:8:0.5 \\
+        FDO_DAEMON_POOL_ENABLED=true FDO_DAEMON_POOL_SIZE=100 python3 -m api.src.api_server
+
+Every option can be given on the command line or through the matching
+MOCK_FDO_* environment variable (the pool only passes --host/--port, and
+--threads when FDO_DAEMON_SLOTS > 1).
+Latency specs (milliseconds):
+    fixed:MS | uniform:LO:HI | exp:MEAN | lognormal:MEDIAN:SIGMA
+"""
+
+import argparse
+import hashlib
+import json
+import math
+import os
+import random
+import sys
+import threading
+import time
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+from pathlib import Path
+from typing import Callable, Dict, Optional
+
+DEFAULT_SAMPLES_DIR = Path(__file__).resolve().parent.parent / "releases" / "atomforge-backend" / "samples"
+
+
+def parse_latency(spec: str) -> Callable[[random.Random], float]:
+    """
+    Parse a latency distribution spec into a sampler returning seconds.
+
+    Raises:
+        ValueError: If the spec is not recognised
+    """
+    kind, _, rest = spec.partition(":")
+    params = [float(p) for p in rest.split(":") if p]
+    if kind == "fixed" and len(params) == 1:
+        return lambda rng: params[0] / 1000.0
+    if kind == "uniform" and len(params) == 2:
+        return lambda rng: rng.uniform(params[0], params[1]) / 1000.0
+    if kind == "exp" and len(params) == 1:
+        return lambda rng: rng.expovariate(1.0 / params[0]) / 1000.0 if params[0] > 0 else 0.0
+    if kind == "lognormal" and len(params) == 2:
+        mu = math.log(params[0]) if params[0] > 0 else 0.0
+        return lambda rng: rng.lognormvariate(mu, params[1]) / 1000.0
+    raise ValueError(f"Invalid latency spec: {spec!r}")
+
+
+class MockCorpus:
+    """Source <-> binary lookup built from .txt/.bin sample pairs."""
+
+    def __init__(self, samples_dir: Path):
+        self.by_source: Dict[str, bytes] = {}
+        self.by_binary: Dict[bytes, str] = {}
+        if samples_dir.is_dir():
+            for txt_path in samples_dir.glob("*.txt"):
+                bin_path = txt_path.with_suffix(".bin")
+                if not bin_path.exists():
+                    continue
+                source = txt_path.read_text(encoding="utf-8", errors="replace")
+                binary = bin_path.read_bytes()
+                self.by_source[self._normalize(source)] = binary
+                self.by_binary[binary] = source
+
+    @staticmethod
+    def _normalize(source: str) -> str:
+        return "\n".join(line.strip() for line in source.strip().splitlines())
+
+    def compile(self, source: str) -> bytes:
+        binary = self.by_source.get(self._normalize(source))
+        if binary is not None:
+            return binary
+        # Synthetic but deterministic: roughly a third of the source size, minimum one atom header
+        digest = hashlib.blake2b(source.encode("utf-8"), digest_size=32).digest()
+        size = max(4, len(source.encode("utf-8")) // 3)
+        return (digest * (size // len(digest) + 1))[:size]
+
+    def decompile(self, binary: bytes) -> str:
+        source = self.by_binary.get(binary)
+        if source is not None:
+            return source
+        return f"uni_start_stream <00x>\n  ; mock decompile of {len(binary)} bytes\nuni_end_stream <>\n"
+
+
+class MockDaemonState:
+    """Shared state and fault injection for all request threads."""
+
+    def __init__(self, args: argparse.Namespace):
+        self.args = args
+        self.corpus = MockCorpus(Path(args.samples))
+        self.latency = parse_latency(args.latency)
+        seed = args.seed if args.seed is not None else 0
+        self.rng = random.Random(f"{seed}:{args.port}")  # Deterministic per daemon
+        self.rng_lock = threading.Lock()
+        self.slots = threading.BoundedSemaphore(args.threads)
+        self.slow_factor = args.slow_factor if args.port in args.slow_ports else 1.0
+        self.started_at = time.time()
+
+        self.stats_lock = threading.Lock()
+        self.requests = 0
+        self.errors = 0
+        self.busy = 0
+        self.service_seconds = 0.0
+        self.leaked = []  # Buffers retained by --leak-kb
+
+    def draw(self) -> Dict[str, float]:
+        """Draw this request's latency and fault decisions from the seeded stream."""
+        with self.rng_lock:
+            return {
+                "latency": self.latency(self.rng) * self.slow_factor,
+                "error": self.rng.random() < self.args.error_rate,
+                "crash": self.rng.random() < self.args.crash_rate,
+                "concurrent_crash": self.rng.random() < self.args.concurrent_crash_rate,
+                "hang": self.rng.random() < self.args.hang_rate
+            }
+
+
+class MockDaemonHandler(BaseHTTPRequestHandler):
+    protocol_version = "HTTP/1.1"
+    server_version = "MockFdoDaemon/1.0"
+    # Head and body are separate writes; with Nagle on, keep-alive clients stall on delayed ACKs
+    disable_nagle_algorithm = True
+    state: MockDaemonState = None  # Set on the subclass created in main()
+
+    def log_message(self, format, *args):
+        if self.state.args.verbose:
+            super().log_message(format, *args)
+
+    def _reply(self, status: int, body: bytes, content_type: str) -> None:
+        self.send_response(status)
+        self.send_header("Content-Type", content_type)
+        self.send_header("Content-Length", str(len(body)))
+        self.end_headers()
+        self.wfile.write(body)
+
+    def _reply_json(self, status: int, obj: Dict) -> None:
+        self._reply(status, json.dumps(obj).encode("utf-8"), "application/json")
+
+    def do_GET(self):
+        state = self.state
+        if self.path == "/health":
+            if state.args.health_blocks_when_busy and state.busy >= state.args.threads:
+                # Emulate a single-threaded daemon whose health endpoint waits behind a running request
+                with state.slots:
+                    pass
+            self._reply_json(200, {"status": "ok", "ready": True, "crash_count": 0, "mock": True})
+        elif self.path == "/stats":
+            with state.stats_lock:
+                self._reply_json(200, {
+                    "pid": os.getpid(),
+                    "port": state.args.port,
+                    "uptime_s": round(time.time() - state.started_at, 3),
+                    "requests": state.requests,
+                    "errors": state.errors,
+                    "busy": state.busy,
+                    "threads": state.args.threads,
+                    "mean_service_ms": round(state.service_seconds / state.requests * 1000, 3) if state.requests else None,
+                    "slow_factor": state.slow_factor,
+                    "leaked_kb": len(state.leaked) * state.args.leak_kb
+                })
+        else:
+            self._reply_json(404, {"error": "not found"})
+
+    def do_POST(self):
+        state = self.state
+        length = int(self.headers.get("Content-Length", "0"))
+        body = self.rfile.read(length) if length else b""
+
+        if self.path not in ("/compile", "/decompile"):
+            self._reply_json(404, {"error": "not found"})
+            return
+
+        with state.slots:
+            with state.stats_lock:
+                state.busy += 1
+                state.requests += 1
+                request_number = state.requests
+            start = time.perf_counter()
+            try:
+                self._process(body, request_number)
+            finally:
+                with state.stats_lock:
+                    state.busy -= 1
+                    state.service_seconds += time.perf_counter() - start
+
+    def _process(self, body: bytes, request_number: int) -> None:
+        state = self.state
+        args = state.args
+        decision = state.draw()
+
+        with state.stats_lock:
+            overlapped = state.busy > 1
+        if overlapped and decision["concurrent_crash"]:
+            # Emulate Ada32 state corrupted by another request running in the same process
+            sys.stderr.write(f"mock daemon on port {args.port}: injected concurrent crash at request {request_number}\n")
+            sys.stderr.flush()
+            os._exit(4)
+
+        if decision["crash"] or (args.crash_after and request_number >= args.crash_after):
+            sys.stderr.write(f"mock daemon on port {args.port}: injected crash at request {request_number}\n")
+            sys.stderr.flush()
+            os._exit(3)
+
+        if decision["hang"]:
+            time.sleep(args.hang_seconds)
+
+        time.sleep(decision["latency"] + args.latency_per_kb / 1000.0 * len(body) / 1024.0)
+
+        if args.leak_kb:
+            with state.stats_lock:
+                state.leaked.append(b"\xa5" * (args.leak_kb * 1024))
+
+        if decision["error"]:
+            with state.stats_lock:
+                state.errors += 1
+            self._reply_json(400, {"success": False, "error": "Ada32 error rc=0x0001: mock injected error"})
+            return
+
+        if self.path == "/compile":
+            self._reply(200, state.corpus.compile(body.decode("utf-8", errors="replace")), "application/octet-stream")
+        else:
+            self._reply(200, state.corpus.decompile(body).encode("utf-8"), "text/plain; charset=utf-8")
+
+
+def _env(name: str, default: str) -> str:
+    return os.environ.get(f"MOCK_FDO_{name}", default)
+
+
+def main() -> int:
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--host", default="127.0.0.1")
+    parser.add_argument("--port", type=int, required=True)
+    parser.add_argument("--samples", default=_env("SAMPLES", str(DEFAULT_SAMPLES_DIR)))
+    parser.add_argument("--latency", default=_env("LATENCY", "fixed:5"), help="Latency distribution spec (ms)")
+    parser.add_argument("--latency-per-kb", type=float, default=float(_env("LATENCY_PER_KB", "0")),
+                        help="Extra milliseconds per KiB of request body")
+    parser.add_argument("--error-rate", type=float, default=float(_env("ERROR_RATE", "0")))
+    parser.add_argument("--crash-rate", type=float, default=float(_env("CRASH_RATE", "0")))
+    parser.add_argument("--crash-after", type=int, default=int(_env("CRASH_AFTER", "0")),
+                        help="Crash on the Nth request (0 disables)")
+    parser.add_argument("--hang-rate", type=float, default=float(_env("HANG_RATE", "0")))
+    parser.add_argument("--hang-seconds", type=float, default=float(_env("HANG_SECONDS", "3600")))
+    parser.add_argument("--threads", type=int, default=int(_env("THREADS", "1")),
+                        help="Requests processed concurrently (the real daemon processes one)")
+    parser.add_argument("--concurrent-crash-rate", type=float, default=float(_env("CONCURRENT_CRASH_RATE", "0")),
+                        help="Crash probability for a request that overlaps another one (thread-unsafe Ada32)")
+    parser.add_argument("--slow-ports", default=_env("SLOW_PORTS", ""),
+                        help="Comma-separated ports whose latency is multiplied by --slow-factor")
+    parser.add_argument("--slow-factor", type=float, default=float(_env("SLOW_FACTOR", "1")))
+    parser.add_argument("--leak-kb", type=int, default=int(_env("LEAK_KB", "0")),
+                        help="KiB retained per request, to emulate a daemon bloating over time")
+    parser.add_argument("--health-blocks-when-busy", action="store_true",
+                        default=_env("HEALTH_BLOCKS_WHEN_BUSY", "false").lower() == "true")
+    parser.add_argument("--seed", type=int, default=int(_env("SEED", "0")))
+    parser.add_argument("--verbose", action="store_true", default=_env("VERBOSE", "false").lower() == "true")
+    args, _ = parser.parse_known_args()  # Ignore extra flags the real daemon accepts
+    args.slow_ports = {int(p) for p in args.slow_ports.split(",") if p.strip()}
+
+    try:
+        state = MockDaemonState(args)
+    except ValueError as e:
+        parser.error(str(e))
+
+    handler = type("BoundMockDaemonHandler", (MockDaemonHandler,), {"state": state})
+    server = ThreadingHTTPServer((args.host, args.port), handler)
+    server.daemon_threads = True
+    sys.stderr.write(f"mock fdo daemon listening on {args.host}:{args.port} "
+                     f"({len(state.corpus.by_source)} corpus samples, latency={args.latency})\n")
+    sys.stderr.flush()
+    try:
+        server.serve_forever()
+    except KeyboardInterrupt:
+        pass
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,159 @@
+#!/usr/bin/env python3
+"""
+Chunk Packet Count Benchmark
+Chunks every sample script in the corpus twice, once with the fixed-limit
+data atom split (FDO_CHUNKER_EXACT_SPLIT=false) and once with the byte-exact
+split, and reports the packet counts, payload bytes and packets over
+MAX_OUTBOUND_SIZE of both per sample, in total, and for the data-heavy samples
+(those with data atoms long enough to be split).
+
+Atoms are compiled by an FDO daemon when --daemon is given, which gives exact
+numbers. Without it a size model stands in: data atoms compile to their real
+layout ([protocol][atom][length][payload]), other atoms to 3 bytes plus their
+argument text. The model is enough to compare the two splits, since only data
+atoms are handled differently, but absolute counts need the daemon.
+
+Usage:
+    python3 bench/packet_count.py --output packets.json
+    python3 bench/packet_count.py --daemon http://127.0.0.1:8080 --token AT --output packets.json
+"""
+
+import argparse
+import asyncio
+import json
+import logging
+import re
+import sys
+from pathlib import Path
+from typing import Any, Dict, List
+
+REPO_ROOT = Path(__file__).resolve().parent.parent
+sys.path.insert(0, str(REPO_ROOT / "api" / "src"))
+
+from fdo_atom_parser import FdoAtomParser  # noqa: E402
+from fdo_chunker import FdoChunker  # noqa: E402
+from fdo_daemon_client import FdoDaemonClient  # noqa: E402
+from p3_payload_builder import P3PayloadBuilder  # noqa: E402
+
+logger = logging.getLogger("packet_count")
+
+DEFAULT_SAMPLES_DIR = REPO_ROOT / "releases" / "atomforge-backend" / "samples"
+
+# [protocol][atom] prefixes as seen in the corpus binaries (dod_data assumed alike)
+MODEL_PREFIXES = {"man_append_data": b"\x01\x14", "idb_append_data": b"\x05\x0b", "dod_data": b"\x05\x0b"}
+
+
+class ModelCompiler:
+    """Stand-in for the daemon's compile_source with the size model described above."""
+
+    async def compile_source(self, source: str) -> bytes:
+        return b"".join(self._compile_line(line.strip()) for line in source.split("\n") if line.strip())
+
+    @classmethod
+    def _compile_line(cls, line: str) -> bytes:
+        name, _, args = line.partition("<")
+        name = name.strip()
+        args = args.rstrip().rstrip(">").strip()
+        if name in MODEL_PREFIXES:
+            payload = cls._payload(args)
+            length = bytes((len(payload),)) if len(payload) < 0x80 else bytes((0x80 | (len(payload) >> 8), len(payload) & 0xFF))
+            return MODEL_PREFIXES[name] + length + payload
+        return b"\x00" * (3 + len(args.encode("utf-8")))
+
+    @staticmethod
+    def _payload(args: str) -> bytes:
+        if args.startswith('"'):
+            text = args[1:-1] if args.endswith('"') else args[1:]
+            payload = bytearray()
+            for part in re.split(r'(\\x[0-9A-Fa-f]{2}|\\.)', text):
+                if part.startswith("\\x") and len(part) == 4:
+                    payload.append(int(part[2:], 16))
+                elif part.startswith("\\") and len(part) == 2:
+                    payload.extend(part[1].encode("utf-8"))
+                else:
+                    payload.extend(part.encode("utf-8"))
+            return bytes(payload)
+        if "x" in args.lower():
+            return bytes(int(p.strip()[:-1] or "0", 16) for p in args.split(",") if p.strip())
+        return bytes.fromhex(re.sub(r"\s+", "", args))
+
+
+def is_data_heavy(source: str) -> bool:
+    """True if the fixed-limit split would split any data atom in the script."""
+    return FdoAtomParser.preprocess_script(source).count("\n") != source.count("\n")
+
+
+async def count_sample(compiler, source: str, token: str) -> Dict[str, Any]:
+    counts = {}
+    for mode, exact in (("fixed", False), ("exact", True)):
+        chunker = FdoChunker(compiler, enable_parallel=False, exact_split=exact)
+        result = await chunker.process_fdo_script(source, 0, token)
+        chunks = result["chunks"] if result else []
+        counts[mode] = {
+            "packets": len(chunks),
+            "bytes": chunks.payload_size if chunks else 0,
+            "oversize": sum(1 for info in (result["chunk_info"] if result else []) if info["size"] > P3PayloadBuilder.MAX_OUTBOUND_SIZE)
+        }
+    return counts
+
+
+def _totals(samples: List[Dict[str, Any]]) -> Dict[str, Any]:
+    fixed = sum(s["fixed"]["packets"] for s in samples)
+    exact = sum(s["exact"]["packets"] for s in samples)
+    return {
+        "samples": len(samples),
+        "fixed_packets": fixed,
+        "exact_packets": exact,
+        "fixed_bytes": sum(s["fixed"]["bytes"] for s in samples),
+        "exact_bytes": sum(s["exact"]["bytes"] for s in samples),
+        "fixed_oversize_packets": sum(s["fixed"]["oversize"] for s in samples),
+        "exact_oversize_packets": sum(s["exact"]["oversize"] for s in samples),
+        "packet_reduction_pct": round(100.0 * (fixed - exact) / fixed, 2) if fixed else 0.0
+    }
+
+
+async def run(args: argparse.Namespace) -> Dict[str, Any]:
+    compiler = FdoDaemonClient(args.daemon) if args.daemon else ModelCompiler()
+    samples = []
+    try:
+        for path in sorted(Path(args.samples).glob("*.txt")):
+            source = path.read_text(encoding="utf-8", errors="replace")
+            try:
+                counts = await count_sample(compiler, source, args.token)
+            except Exception as e:
+                logger.warning(f"{path.name}: {e}")
+                continue
+            samples.append({"name": path.stem, "data_heavy": is_data_heavy(source), **counts})
+    finally:
+        if args.daemon:
+            await compiler.close()
+
+    return {
+        "meta": {"compiler": args.daemon or "model", "token": args.token, "samples_dir": args.samples},
+        "overall": _totals(samples),
+        "data_heavy": _totals([s for s in samples if s["data_heavy"]]),
+        "samples": samples if args.per_sample else None
+    }
+
+
+def main() -> int:
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--samples", default=str(DEFAULT_SAMPLES_DIR), help="Directory of .txt sample scripts")
+    parser.add_argument("--daemon", help="FDO daemon URL to compile atoms with (default: size model)")
+    parser.add_argument("--token", default="AT", help="P3 token for the packets")
+    parser.add_argument("--per-sample", action="store_true", help="Include per-sample counts in the report")
+    parser.add_argument("--output", help="Write the JSON report to this file (default: stdout)")
+    args = parser.parse_args()
+
+    logging.basicConfig(level=logging.WARNING, format="%(message)s", stream=sys.stderr)
+
+    report = asyncio.run(run(args))
+    output = json.dumps(report, indent=2)
+    if args.output:
+        Path(args.output).write_text(output + "\n")
+    print(output)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
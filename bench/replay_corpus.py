@@ -0,0 +1,437 @@
+#!/usr/bin/env python3
+"""
+Corpus Replay Benchmark
+Replays the bundled .txt/.bin sample corpus against the AtomForge API and
+reports throughput, latency percentiles, daemon utilization and error rates
+as machine-readable JSON.
+
+Usage:
+    # Run against a server that is already up
+    python3 bench/replay_corpus.py --url http://localhost:8000 --concurrency 16 --duration 30 \\
+        --mix compile=4,decompile=4,compile-chunk=1,decompile-jsonl=1 --output run.json
+
+    # Spawn a local server with a given pool size for the run
+    python3 bench/replay_corpus.py --spawn --pool-size 8 --duration 30 --output run.json
+
+    # Compare two runs (exit status 1 if a regression is flagged)
+    python3 bench/replay_corpus.py --compare baseline.json run.json --threshold-pct 10
+"""
+
+import argparse
+import asyncio
+import base64
+import json
+import logging
+import math
+import os
+import random
+import struct
+import subprocess
+import sys
+import time
+from pathlib import Path
+from typing import Any, Dict, List, Optional
+
+import httpx
+
+REPO_ROOT = Path(__file__).resolve().parent.parent
+sys.path.insert(0, str(REPO_ROOT / "api" / "src"))
+
+from p3_frame_scanner import P3FrameScanner  # noqa: E402
+from p3_payload_builder import P3PayloadBuilder  # noqa: E402
+
+logger = logging.getLogger("replay_corpus")
+
+DEFAULT_SAMPLES_DIR = REPO_ROOT / "releases" / "atomforge-backend" / "samples"
+DEFAULT_MIX = "compile=4,decompile=4,compile-chunk=1,decompile-jsonl=1"
+OPERATIONS = ("compile", "decompile", "compile-chunk", "compile-chunk-compact", "decompile-jsonl")
+CHUNK_STREAM_TYPE = "application/vnd.atomforge.p3-chunks"
+
+
+# --- Corpus ---
+
+def _p3_frame(data: bytes, tx_seq: int, rx_seq: int) -> bytes:
+    """Wrap a P3 payload into a complete client DATA frame with a valid CRC."""
+    body = struct.pack(">HBBB", len(data) + 3, tx_seq, rx_seq, 0xA0) + data
+    return b"\x5a" + struct.pack(">H", P3FrameScanner.crc16(body)) + body + b"\x0d"
+
+
+def _binary_to_jsonl(binary: bytes, token: str = "AT", stream_id: int = 0) -> bytes:
+    """Split a compiled FDO stream into AT payloads and render them as capture JSONL lines."""
+    header_size = P3PayloadBuilder.get_header_size(token)
+    max_data = P3PayloadBuilder.MAX_OUTBOUND_SIZE - header_size
+    lines = []
+    timestamp = 1.7e9
+    for index, offset in enumerate(range(0, len(binary), max_data)):
+        payload = P3PayloadBuilder.build_packet(binary[offset:offset + max_data], stream_id, token)
+        frame = _p3_frame(payload, (0x10 + index) & 0x7F, 0x10)
+        lines.append(json.dumps({
+            "ts": f"{timestamp + index * 0.001:.3f}",
+            "dir": "out",
+            "token": token,
+            "fullHex": frame.hex().upper()
+        }))
+    return ("\n".join(lines) + "\n").encode("utf-8")
+
+
+def load_corpus(samples_dir: Path) -> List[Dict[str, Any]]:
+    """
+    Load .txt/.bin sample pairs.
+
+    Returns:
+        List of dicts with name, source, binary and a prebuilt JSONL capture
+    """
+    corpus = []
+    for txt_path in sorted(samples_dir.glob("*.txt")):
+        bin_path = txt_path.with_suffix(".bin")
+        if not bin_path.exists():
+            continue
+        binary = bin_path.read_bytes()
+        if not binary:
+            continue
+        corpus.append({
+            "name": txt_path.stem,
+            "source": txt_path.read_text(encoding="utf-8", errors="replace"),
+            "binary": binary,
+            "binary_b64": base64.b64encode(binary).decode("ascii"),
+            "jsonl": _binary_to_jsonl(binary)
+        })
+    if not corpus:
+        raise SystemExit(f"No .txt/.bin sample pairs found in {samples_dir}")
+    return corpus
+
+
+def parse_mix(mix: str) -> Dict[str, float]:
+    weights = {}
+    for part in mix.split(","):
+        if not part.strip():
+            continue
+        name, _, weight = part.partition("=")
+        name = name.strip()
+        if name not in OPERATIONS:
+            raise SystemExit(f"Unknown operation in --mix: {name} (expected one of {', '.join(OPERATIONS)})")
+        weights[name] = float(weight or 1)
+    if not weights or sum(weights.values()) <= 0:
+        raise SystemExit("--mix must give at least one operation a positive weight")
+    return weights
+
+
+# --- Load generation ---
+
+async def _send(client: httpx.AsyncClient, op: str, sample: Dict[str, Any]) -> httpx.Response:
+    if op == "compile":
+        return await client.post("/compile", json={"source": sample["source"]})
+    if op == "decompile":
+        return await client.post("/decompile", json={"binary_data": sample["binary_b64"]})
+    if op == "compile-chunk":
+        return await client.post("/compile-chunk", json={"source": sample["source"], "validate_first": False})
+    if op == "compile-chunk-compact":
+        return await client.post("/compile-chunk", json={"source": sample["source"], "validate_first": False},
+                                 headers={"Accept": CHUNK_STREAM_TYPE})
+    files = {"file": (f"{sample['name']}.jsonl", sample["jsonl"], "application/x-ndjson")}
+    return await client.post("/decompile-jsonl", files=files)
+
+
+def _percentile(sorted_values: List[float], pct: float) -> Optional[float]:
+    """Nearest-rank percentile of an already sorted list."""
+    if not sorted_values:
+        return None
+    rank = max(1, math.ceil(pct / 100.0 * len(sorted_values)))
+    return sorted_values[min(rank, len(sorted_values)) - 1]
+
+
+def _latency_summary(latencies: List[float]) -> Dict[str, Optional[float]]:
+    values = sorted(latencies)
+    to_ms = lambda v: round(v * 1000, 3) if v is not None else None  # noqa: E731
+    return {
+        "p50": to_ms(_percentile(values, 50)),
+        "p95": to_ms(_percentile(values, 95)),
+        "p99": to_ms(_percentile(values, 99)),
+        "mean": to_ms(sum(values) / len(values)) if values else None,
+        "max": to_ms(values[-1]) if values else None
+    }
+
+
+async def _sample_pool(client: httpx.AsyncClient, stop: asyncio.Event, samples: List[Dict[str, float]],
+                       interval: float) -> None:
+    """Poll /health/pool and record busy/healthy daemon counts."""
+    while not stop.is_set():
+        try:
+            r = await client.get("/health/pool")
+            if r.status_code == 200:
+                pool = r.json().get("pool", r.json())
+                healthy = pool.get("instances_healthy", 0)
+                busy = pool.get("concurrent_requests", 0)
+                samples.append({
+                    "busy": busy,
+                    "healthy": healthy,
+                    "utilization": busy / healthy if healthy else 0.0
+                })
+        except httpx.HTTPError:
+            pass
+        try:
+            await asyncio.wait_for(stop.wait(), timeout=interval)
+        except asyncio.TimeoutError:
+            pass
+
+
+async def run_benchmark(args: argparse.Namespace) -> Dict[str, Any]:
+    corpus = load_corpus(Path(args.samples))
+    mix = parse_mix(args.mix)
+    ops = list(mix.keys())
+    weights = [mix[op] for op in ops]
+    rng = random.Random(args.seed)
+
+    results: Dict[str, Dict[str, Any]] = {
+        op: {"latencies": [], "statuses": {}, "errors": 0, "transport_errors": 0} for op in ops
+    }
+    limits = httpx.Limits(max_connections=args.concurrency + 2, max_keepalive_connections=args.concurrency + 2)
+
+    async with httpx.AsyncClient(base_url=args.url, timeout=args.timeout, limits=limits) as client:
+        # Warmup (not recorded) so connection setup and daemon first-use cost stay out of the numbers
+        warmup_deadline = time.perf_counter() + args.warmup
+        while time.perf_counter() < warmup_deadline:
+            try:
+                await _send(client, rng.choices(ops, weights)[0], rng.choice(corpus))
+            except httpx.HTTPError:
+                pass
+
+        stop = asyncio.Event()
+        pool_samples: List[Dict[str, float]] = []
+        sampler = asyncio.create_task(_sample_pool(client, stop, pool_samples, args.pool_sample_interval))
+
+        remaining = [args.requests] if args.requests else None
+        deadline = time.perf_counter() + args.duration
+
+        async def worker(worker_rng: random.Random) -> None:
+            while True:
+                if remaining is not None:
+                    if remaining[0] <= 0:
+                        return
+                    remaining[0] -= 1
+                elif time.perf_counter() >= deadline:
+                    return
+
+                op = worker_rng.choices(ops, weights)[0]
+                sample = worker_rng.choice(corpus)
+                record = results[op]
+                start = time.perf_counter()
+                try:
+                    response = await _send(client, op, sample)
+                except httpx.HTTPError:
+                    record["transport_errors"] += 1
+                    record["errors"] += 1
+                    continue
+                elapsed = time.perf_counter() - start
+
+                status = str(response.status_code)
+                record["statuses"][status] = record["statuses"].get(status, 0) + 1
+                ok = response.status_code < 400
+                if ok and op == "compile-chunk-compact":
+                    # Only successful chunking comes back as a chunk stream
+                    ok = response.headers.get("content-type", "").startswith(CHUNK_STREAM_TYPE)
+                elif ok and op in ("compile-chunk", "decompile-jsonl", "decompile"):
+                    try:
+                        ok = bool(response.json().get("success", True))
+                    except ValueError:
+                        ok = False
+                if ok:
+                    record["latencies"].append(elapsed)
+                else:
+                    record["errors"] += 1
+
+        started = time.perf_counter()
+        await asyncio.gather(*(worker(random.Random(rng.random())) for _ in range(args.concurrency)))
+        wall_time = time.perf_counter() - started
+
+        stop.set()
+        await sampler
+
+    report_ops = {}
+    all_latencies: List[float] = []
+    total_requests = total_errors = 0
+    for op, record in results.items():
+        completed = len(record["latencies"]) + record["errors"]
+        total_requests += completed
+        total_errors += record["errors"]
+        all_latencies.extend(record["latencies"])
+        report_ops[op] = {
+            "requests": completed,
+            "errors": record["errors"],
+            "transport_errors": record["transport_errors"],
+            "error_rate": round(record["errors"] / completed, 4) if completed else 0.0,
+            "throughput_rps": round(len(record["latencies"]) / wall_time, 3) if wall_time else 0.0,
+            "status_codes": record["statuses"],
+            "latency_ms": _latency_summary(record["latencies"])
+        }
+
+    utilization = [s["utilization"] for s in pool_samples]
+    return {
+        "meta": {
+            "url": args.url,
+            "concurrency": args.concurrency,
+            "mix": mix,
+            "duration_s": round(wall_time, 3),
+            "requests_limit": args.requests,
+            "pool_size": args.pool_size,
+            "corpus_samples": len(corpus),
+            "seed": args.seed,
+            "started_at": time.strftime("%Y-%m-%dT%H:%M:%SZ", time.gmtime())
+        },
+        "overall": {
+            "requests": total_requests,
+            "errors": total_errors,
+            "error_rate": round(total_errors / total_requests, 4) if total_requests else 0.0,
+            "throughput_rps": round(len(all_latencies) / wall_time, 3) if wall_time else 0.0,
+            "latency_ms": _latency_summary(all_latencies)
+        },
+        "ops": report_ops,
+        "pool": {
+            "samples": len(pool_samples),
+            "utilization_mean": round(sum(utilization) / len(utilization), 4) if utilization else None,
+            "utilization_max": round(max(utilization), 4) if utilization else None,
+            "busy_max": max((s["busy"] for s in pool_samples), default=None),
+            "healthy_min": min((s["healthy"] for s in pool_samples), default=None)
+        }
+    }
+
+
+# --- Local server ---
+
+def spawn_server(args: argparse.Namespace) -> subprocess.Popen:
+    """Start a local API server with the requested pool size and wait until /health responds."""
+    env = dict(os.environ)
+    env.setdefault("PYTHONPATH", str(REPO_ROOT))
+    env.setdefault("FDO_RELEASES_DIR", str(REPO_ROOT / "releases"))
+    env["PORT"] = str(args.spawn_port)
+    if args.pool_size:
+        env["FDO_DAEMON_POOL_ENABLED"] = "true"
+        env["FDO_DAEMON_POOL_SIZE"] = str(args.pool_size)
+
+    log_path = Path(args.spawn_log)
+    log_file = open(log_path, "wb")
+    proc = subprocess.Popen(
+        [sys.executable, "-m", "api.src.api_server"],
+        cwd=str(REPO_ROOT), env=env, stdout=log_file, stderr=subprocess.STDOUT
+    )
+    args.url = f"http://127.0.0.1:{args.spawn_port}"
+
+    deadline = time.time() + args.spawn_timeout
+    while time.time() < deadline:
+        if proc.poll() is not None:
+            raise SystemExit(f"Server exited during startup (code {proc.returncode}), see {log_path}")
+        try:
+            if httpx.get(f"{args.url}/health", timeout=1.0).status_code == 200:
+                logger.info(f"Spawned server ready at {args.url} (pid {proc.pid})")
+                return proc
+        except httpx.HTTPError:
+            pass
+        time.sleep(0.5)
+
+    proc.terminate()
+    raise SystemExit(f"Server did not become healthy within {args.spawn_timeout}s, see {log_path}")
+
+
+# --- Comparison ---
+
+def compare_reports(baseline: Dict[str, Any], candidate: Dict[str, Any], threshold_pct: float) -> Dict[str, Any]:
+    """
+    Compare two reports and flag regressions.
+
+    A regression is a throughput drop or p95/p99 increase beyond threshold_pct,
+    or an error rate increase of more than one percentage point.
+    """
+    def pct_change(old: Optional[float], new: Optional[float]) -> Optional[float]:
+        if old in (None, 0) or new is None:
+            return None
+        return round((new - old) / old * 100.0, 2)
+
+    sections = {"overall": (baseline["overall"], candidate["overall"])}
+    for op in sorted(set(baseline.get("ops", {})) & set(candidate.get("ops", {}))):
+        sections[op] = (baseline["ops"][op], candidate["ops"][op])
+
+    comparison = {}
+    regressions = []
+    for name, (old, new) in sections.items():
+        entry = {
+            "throughput_change_pct": pct_change(old["throughput_rps"], new["throughput_rps"]),
+            "p50_change_pct": pct_change(old["latency_ms"]["p50"], new["latency_ms"]["p50"]),
+            "p95_change_pct": pct_change(old["latency_ms"]["p95"], new["latency_ms"]["p95"]),
+            "p99_change_pct": pct_change(old["latency_ms"]["p99"], new["latency_ms"]["p99"]),
+            "error_rate_change": round(new["error_rate"] - old["error_rate"], 4)
+        }
+        flags = []
+        if entry["throughput_change_pct"] is not None and entry["throughput_change_pct"] < -threshold_pct:
+            flags.append("throughput")
+        for key in ("p95", "p99"):
+            change = entry[f"{key}_change_pct"]
+            if change is not None and change > threshold_pct:
+                flags.append(key)
+        if entry["error_rate_change"] > 0.01:
+            flags.append("error_rate")
+        entry["regressions"] = flags
+        comparison[name] = entry
+        regressions.extend(f"{name}:{flag}" for flag in flags)
+
+    return {"threshold_pct": threshold_pct, "sections": comparison, "regressions": regressions}
+
+
+# --- CLI ---
+
+def main() -> int:
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--url", default="http://localhost:8000", help="API base URL")
+    parser.add_argument("--samples", default=str(DEFAULT_SAMPLES_DIR), help="Directory of .txt/.bin sample pairs")
+    parser.add_argument("--concurrency", type=int, default=8, help="Concurrent in-flight requests")
+    parser.add_argument("--duration", type=float, default=30.0, help="Measured run time in seconds")
+    parser.add_argument("--requests", type=int, default=0, help="Stop after N requests instead of --duration")
+    parser.add_argument("--warmup", type=float, default=2.0, help="Unrecorded warmup time in seconds")
+    parser.add_argument("--mix", default=DEFAULT_MIX, help="Weighted operation mix, e.g. compile=4,decompile=1")
+    parser.add_argument("--timeout", type=float, default=60.0, help="Per-request timeout in seconds")
+    parser.add_argument("--seed", type=int, default=1, help="Random seed for request selection")
+    parser.add_argument("--pool-size", type=int, default=0, help="Pool size (recorded; applied with --spawn)")
+    parser.add_argument("--pool-sample-interval", type=float, default=0.5, help="Seconds between /health/pool polls")
+    parser.add_argument("--spawn", action="store_true", help="Start a local API server for the run")
+    parser.add_argument("--spawn-port", type=int, default=8765, help="Port for the spawned server")
+    parser.add_argument("--spawn-timeout", type=float, default=120.0, help="Seconds to wait for the spawned server")
+    parser.add_argument("--spawn-log", default="/tmp/replay_corpus_server.log", help="Spawned server log file")
+    parser.add_argument("--output", help="Write the JSON report to this file (default: stdout)")
+    parser.add_argument("--compare", nargs=2, metavar=("BASELINE", "CANDIDATE"), help="Compare two reports")
+    parser.add_argument("--threshold-pct", type=float, default=10.0, help="Regression threshold for --compare")
+    args = parser.parse_args()
+
+    logging.basicConfig(level=logging.INFO, format="%(message)s", stream=sys.stderr)
+
+    if args.compare:
+        baseline, candidate = (json.loads(Path(path).read_text()) for path in args.compare)
+        result = compare_reports(baseline, candidate, args.threshold_pct)
+        output = json.dumps(result, indent=2)
+        if args.output:
+            Path(args.output).write_text(output + "\n")
+        print(output)
+        return 1 if result["regressions"] else 0
+
+    server = spawn_server(args) if args.spawn else None
+    try:
+        report = asyncio.run(run_benchmark(args))
+    finally:
+        if server:
+            server.terminate()
+            try:
+                server.wait(timeout=15)
+            except subprocess.TimeoutExpired:
+                server.kill()
+
+    output = json.dumps(report, indent=2)
+    if args.output:
+        Path(args.output).write_text(output + "\n")
+        overall = report["overall"]
+        logger.info(f"{overall['requests']} requests, {overall['throughput_rps']} req/s, "
+                    f"p95={overall['latency_ms']['p95']}ms, error_rate={overall['error_rate']}")
+    else:
+        print(output)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
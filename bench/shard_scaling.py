@@ -0,0 +1,111 @@
+#!/usr/bin/env python3
+"""
+Wine Prefix Shard Scaling Benchmark
+Measures how pool throughput scales with the number of Wine prefix shards
+(FDO_WINE_PREFIX_SHARDS). For each shard count a local API server is spawned
+with the same pool size and the corpus replay from replay_corpus.py is run
+against it; the report lists throughput and latency per shard count and the
+speedup over the first one.
+
+Usage:
+    python3 bench/shard_scaling.py --pool-size 16 --shards 1,2,4,8 --concurrency 32 \\
+        --duration 30 --output shards.json
+"""
+
+import argparse
+import asyncio
+import json
+import logging
+import os
+import subprocess
+import sys
+from pathlib import Path
+from typing import Any, Dict, List
+
+sys.path.insert(0, str(Path(__file__).resolve().parent))
+
+from replay_corpus import DEFAULT_SAMPLES_DIR, run_benchmark, spawn_server  # noqa: E402
+
+logger = logging.getLogger("shard_scaling")
+
+
+def parse_shards(spec: str) -> List[int]:
+    counts = sorted({int(part) for part in spec.split(",") if part.strip()})
+    if not counts or counts[0] < 1:
+        raise SystemExit("--shards must list positive shard counts, e.g. 1,2,4")
+    return counts
+
+
+def run_shard_count(args: argparse.Namespace, shards: int) -> Dict[str, Any]:
+    """Spawn a server with the given shard count and replay the corpus against it."""
+    os.environ["FDO_WINE_PREFIX_SHARDS"] = str(shards)
+    server = spawn_server(args)
+    try:
+        report = asyncio.run(run_benchmark(args))
+    finally:
+        server.terminate()
+        try:
+            server.wait(timeout=15)
+        except subprocess.TimeoutExpired:
+            server.kill()
+
+    overall = report["overall"]
+    logger.info(f"shards={shards}: {overall['throughput_rps']} req/s, p95={overall['latency_ms']['p95']}ms, "
+                f"error_rate={overall['error_rate']}")
+    return {
+        "shards": shards,
+        "throughput_rps": overall["throughput_rps"],
+        "latency_ms": overall["latency_ms"],
+        "error_rate": overall["error_rate"],
+        "requests": overall["requests"],
+        "utilization_mean": report["pool"]["utilization_mean"]
+    }
+
+
+def main() -> int:
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--shards", default="1,2,4", help="Comma-separated shard counts to measure")
+    parser.add_argument("--pool-size", type=int, default=8, help="Daemon pool size for every run")
+    parser.add_argument("--samples", default=str(DEFAULT_SAMPLES_DIR), help="Directory of .txt/.bin sample pairs")
+    parser.add_argument("--concurrency", type=int, default=16, help="Concurrent in-flight requests")
+    parser.add_argument("--duration", type=float, default=30.0, help="Measured run time per shard count")
+    parser.add_argument("--warmup", type=float, default=5.0, help="Unrecorded warmup time per shard count")
+    parser.add_argument("--mix", default="compile=1,decompile=1", help="Weighted operation mix")
+    parser.add_argument("--timeout", type=float, default=60.0, help="Per-request timeout in seconds")
+    parser.add_argument("--seed", type=int, default=1, help="Random seed for request selection")
+    parser.add_argument("--spawn-port", type=int, default=8765, help="Port for the spawned servers")
+    parser.add_argument("--spawn-timeout", type=float, default=180.0, help="Seconds to wait for each server")
+    parser.add_argument("--spawn-log", default="/tmp/shard_scaling_server.log", help="Spawned server log file")
+    parser.add_argument("--output", help="Write the JSON report to this file (default: stdout)")
+    args = parser.parse_args()
+
+    # Fields run_benchmark expects that this benchmark does not vary
+    args.requests = 0
+    args.pool_sample_interval = 0.5
+
+    logging.basicConfig(level=logging.INFO, format="%(message)s", stream=sys.stderr)
+
+    runs = [run_shard_count(args, shards) for shards in parse_shards(args.shards)]
+    baseline = runs[0]["throughput_rps"]
+    for run in runs:
+        run["speedup"] = round(run["throughput_rps"] / baseline, 3) if baseline else None
+
+    report = {
+        "meta": {
+            "pool_size": args.pool_size,
+            "concurrency": args.concurrency,
+            "mix": args.mix,
+            "duration_s": args.duration,
+            "daemon_exe": os.environ.get("FDO_DAEMON_EXE")
+        },
+        "runs": runs
+    }
+    output = json.dumps(report, indent=2)
+    if args.output:
+        Path(args.output).write_text(output + "\n")
+    print(output)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
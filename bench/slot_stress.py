@@ -0,0 +1,171 @@
+#!/usr/bin/env python3
+"""
+Daemon Slot Stress Test
+Measures what concurrent request slots per daemon (FDO_DAEMON_SLOTS, passed to
+fdo_daemon as --threads) buy and what they cost. For each slots value a local
+API server is spawned with the same pool size and the corpus replay from
+replay_corpus.py keeps every slot busy (concurrency = pool size x slots x
+--load-factor). The report lists per slots value:
+
+  - throughput, latency and error rate
+  - daemon crashes (restarts from /health/pool) per 1000 requests, the cost
+    of running Ada32 concurrently in one process
+  - memory per daemon (/health/pool/memory) and throughput per GB
+
+With --memory-mb it also projects throughput when the memory budget is
+filled with daemons of each slots value, and recommends the value with the
+highest projection among those within --max-crash-rate and --max-error-rate.
+
+Usage:
+    python3 bench/slot_stress.py --pool-size 4 --slots 1,2,4 --duration 60 --memory-mb 4096 \\
+        --output slots.json
+"""
+
+import argparse
+import asyncio
+import json
+import logging
+import os
+import subprocess
+import sys
+from pathlib import Path
+from typing import Any, Dict, List, Optional
+
+import httpx
+
+sys.path.insert(0, str(Path(__file__).resolve().parent))
+
+from replay_corpus import DEFAULT_SAMPLES_DIR, run_benchmark, spawn_server  # noqa: E402
+
+logger = logging.getLogger("slot_stress")
+
+
+def parse_slots(spec: str) -> List[int]:
+    values = sorted({int(part) for part in spec.split(",") if part.strip()})
+    if not values or values[0] < 1:
+        raise SystemExit("--slots must list positive slot counts, e.g. 1,2,4")
+    return values
+
+
+def pool_snapshot(url: str) -> Dict[str, Any]:
+    """Daemon restarts and memory per daemon from the spawned server."""
+    pool = httpx.get(f"{url}/health/pool", timeout=10.0).json()
+    memory = httpx.get(f"{url}/health/pool/memory", timeout=10.0).json()
+    return {
+        "restarts": pool.get("daemon_restarts", 0),
+        "healthy": pool.get("instances_healthy", 0),
+        "per_daemon_mb": memory.get("per_daemon_total_mb")
+    }
+
+
+def run_slots(args: argparse.Namespace, slots: int) -> Dict[str, Any]:
+    """Spawn a server with the given slots per daemon and replay the corpus against it."""
+    os.environ["FDO_DAEMON_SLOTS"] = str(slots)
+    args.concurrency = max(1, round(args.pool_size * slots * args.load_factor))
+    server = spawn_server(args)
+    try:
+        report = asyncio.run(run_benchmark(args))
+        pool = pool_snapshot(args.url)
+    finally:
+        server.terminate()
+        try:
+            server.wait(timeout=15)
+        except subprocess.TimeoutExpired:
+            server.kill()
+
+    overall = report["overall"]
+    requests = overall["requests"]
+    throughput = overall["throughput_rps"]
+    per_daemon_mb = pool["per_daemon_mb"]
+    run = {
+        "slots": slots,
+        "concurrency": args.concurrency,
+        "throughput_rps": throughput,
+        "latency_ms": overall["latency_ms"],
+        "error_rate": overall["error_rate"],
+        "requests": requests,
+        "daemon_crashes": pool["restarts"],
+        "crashes_per_1k": round(pool["restarts"] / requests * 1000, 3) if requests else None,
+        "healthy_at_end": pool["healthy"],
+        "per_daemon_mb": per_daemon_mb,
+        "throughput_per_gb": (round(throughput / (per_daemon_mb * args.pool_size / 1024), 3)
+                              if per_daemon_mb else None)
+    }
+    logger.info(f"slots={slots}: {throughput} req/s, p95={overall['latency_ms']['p95']}ms, "
+                f"error_rate={overall['error_rate']}, crashes={pool['restarts']}, per_daemon={per_daemon_mb}MB")
+    return run
+
+
+def project(runs: List[Dict[str, Any]], args: argparse.Namespace) -> Optional[int]:
+    """Add memory-budget projections to each run and return the recommended slots value."""
+    best = None
+    for run in runs:
+        crash_rate = (run["crashes_per_1k"] or 0) / 1000
+        run["safe"] = crash_rate <= args.max_crash_rate and run["error_rate"] <= args.max_error_rate
+        if not args.memory_mb or not run["per_daemon_mb"]:
+            continue
+        daemons = max(1, int(args.memory_mb // run["per_daemon_mb"]))
+        run["projected_daemons"] = daemons
+        run["projected_throughput_rps"] = round(run["throughput_rps"] / args.pool_size * daemons, 3)
+        if run["safe"] and (best is None or run["projected_throughput_rps"] > best["projected_throughput_rps"]):
+            best = run
+    return best["slots"] if best else None
+
+
+def main() -> int:
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--slots", default="1,2,4", help="Comma-separated slots-per-daemon values to measure")
+    parser.add_argument("--pool-size", type=int, default=4, help="Daemon pool size for every run")
+    parser.add_argument("--load-factor", type=float, default=1.0,
+                        help="In-flight requests per slot (above 1 keeps a queue at every slot)")
+    parser.add_argument("--memory-mb", type=float, default=0.0,
+                        help="Memory budget for daemons; enables throughput projections and a recommendation")
+    parser.add_argument("--max-crash-rate", type=float, default=0.001, help="Highest acceptable crashes per request")
+    parser.add_argument("--max-error-rate", type=float, default=0.01, help="Highest acceptable error rate")
+    parser.add_argument("--samples", default=str(DEFAULT_SAMPLES_DIR), help="Directory of .txt/.bin sample pairs")
+    parser.add_argument("--duration", type=float, default=60.0, help="Measured run time per slots value")
+    parser.add_argument("--warmup", type=float, default=5.0, help="Unrecorded warmup time per slots value")
+    parser.add_argument("--mix", default="compile=1,decompile=1", help="Weighted operation mix")
+    parser.add_argument("--timeout", type=float, default=60.0, help="Per-request timeout in seconds")
+    parser.add_argument("--seed", type=int, default=1, help="Random seed for request selection")
+    parser.add_argument("--spawn-port", type=int, default=8765, help="Port for the spawned servers")
+    parser.add_argument("--spawn-timeout", type=float, default=180.0, help="Seconds to wait for each server")
+    parser.add_argument("--spawn-log", default="/tmp/slot_stress_server.log", help="Spawned server log file")
+    parser.add_argument("--output", help="Write the JSON report to this file (default: stdout)")
+    args = parser.parse_args()
+
+    # Fields run_benchmark expects that this benchmark does not vary
+    args.requests = 0
+    args.pool_sample_interval = 0.5
+
+    logging.basicConfig(level=logging.INFO, format="%(message)s", stream=sys.stderr)
+
+    runs = [run_slots(args, slots) for slots in parse_slots(args.slots)]
+    baseline = runs[0]["throughput_rps"]
+    for run in runs:
+        run["speedup"] = round(run["throughput_rps"] / baseline, 3) if baseline else None
+    recommended = project(runs, args)
+
+    report = {
+        "meta": {
+            "pool_size": args.pool_size,
+            "load_factor": args.load_factor,
+            "mix": args.mix,
+            "duration_s": args.duration,
+            "memory_mb": args.memory_mb or None,
+            "max_crash_rate": args.max_crash_rate,
+            "max_error_rate": args.max_error_rate,
+            "daemon_exe": os.environ.get("FDO_DAEMON_EXE")
+        },
+        "runs": runs,
+        "recommended_slots": recommended
+    }
+    output = json.dumps(report, indent=2)
+    if args.output:
+        Path(args.output).write_text(output + "\n")
+    print(output)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
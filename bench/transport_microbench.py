@@ -0,0 +1,155 @@
+#!/usr/bin/env python3
+"""
+Daemon Transport Microbenchmark
+Compares the two FdoDaemonClient transports (httpx and the lean keep-alive
+transport enabled by FDO_DAEMON_FAST_TRANSPORT) on per-atom sized payloads.
+
+A zero-latency mock daemon (bench/mock_fdo_daemon.py) is started once; for
+each payload size and transport the same request sequence is sent at a fixed
+concurrency. Besides wall-clock latency the report gives client CPU time per
+request (this process only, the daemon runs separately), which is the cost
+the transport itself adds to every daemon round trip.
+
+Usage:
+    python3 bench/transport_microbench.py --sizes 64,512,4096 --requests 5000 --concurrency 4 \\
+        --output transport.json
+"""
+
+import argparse
+import asyncio
+import json
+import logging
+import os
+import subprocess
+import sys
+import time
+from pathlib import Path
+from typing import Any, Dict, List
+
+import httpx
+
+REPO_ROOT = Path(__file__).resolve().parent.parent
+sys.path.insert(0, str(REPO_ROOT / "api" / "src"))
+sys.path.insert(0, str(Path(__file__).resolve().parent))
+
+from fdo_daemon_client import FdoDaemonClient  # noqa: E402
+from replay_corpus import _latency_summary  # noqa: E402
+
+logger = logging.getLogger("transport_microbench")
+
+MOCK_DAEMON = REPO_ROOT / "bench" / "mock_fdo_daemon.py"
+TRANSPORTS = {"httpx": False, "fast": True}
+
+
+def start_mock(port: int, threads: int) -> subprocess.Popen:
+    """Start a zero-latency mock daemon and wait for /health."""
+    proc = subprocess.Popen(
+        [sys.executable, str(MOCK_DAEMON), "--port", str(port), "--latency", "fixed:0", "--threads", str(threads)],
+        stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL
+    )
+    deadline = time.time() + 15
+    while time.time() < deadline:
+        try:
+            if httpx.get(f"http://127.0.0.1:{port}/health", timeout=0.5).status_code == 200:
+                return proc
+        except httpx.HTTPError:
+            pass
+        time.sleep(0.1)
+    proc.kill()
+    raise SystemExit(f"Mock daemon did not start on port {port}")
+
+
+def payloads(size: int) -> Dict[str, Any]:
+    """A compile source and a decompile binary of roughly the given size."""
+    line = "  uni_use_last_atom_string <00x>\n"
+    source = "uni_start_stream <00x>\n" + line * max(0, (size - 40) // len(line)) + "uni_end_stream <>\n"
+    return {"compile": source, "decompile": bytes(range(256)) * (size // 256) + bytes(size % 256)}
+
+
+async def run_case(base_url: str, fast: bool, op: str, payload: Any, requests: int, concurrency: int,
+                   warmup: int) -> Dict[str, Any]:
+    client = FdoDaemonClient(base_url=base_url, timeout_seconds=10.0, fast_transport=fast)
+    call = client.compile_source if op == "compile" else client.decompile_binary
+    try:
+        for _ in range(warmup):
+            await call(payload)
+
+        latencies: List[float] = []
+        remaining = [requests]
+
+        async def worker() -> None:
+            while remaining[0] > 0:
+                remaining[0] -= 1
+                start = time.perf_counter()
+                await call(payload)
+                latencies.append(time.perf_counter() - start)
+
+        cpu_start = time.process_time()
+        wall_start = time.perf_counter()
+        await asyncio.gather(*(worker() for _ in range(concurrency)))
+        wall = time.perf_counter() - wall_start
+        cpu = time.process_time() - cpu_start
+    finally:
+        await client.close()
+
+    return {
+        "throughput_rps": round(len(latencies) / wall, 1),
+        "latency_ms": _latency_summary(latencies),
+        "client_cpu_us_per_request": round(cpu / len(latencies) * 1e6, 1)
+    }
+
+
+async def run(args: argparse.Namespace) -> Dict[str, Any]:
+    base_url = f"http://127.0.0.1:{args.port}"
+    results = []
+    for size in [int(s) for s in args.sizes.split(",") if s.strip()]:
+        for op, payload in payloads(size).items():
+            row: Dict[str, Any] = {"op": op, "size": size}
+            for name, fast in TRANSPORTS.items():
+                row[name] = await run_case(base_url, fast, op, payload, args.requests, args.concurrency, args.warmup)
+            baseline, candidate = row["httpx"], row["fast"]
+            row["cpu_saved_pct"] = round(
+                (1 - candidate["client_cpu_us_per_request"] / baseline["client_cpu_us_per_request"]) * 100, 1)
+            row["speedup"] = round(candidate["throughput_rps"] / baseline["throughput_rps"], 3)
+            logger.info(f"{op} {size}B: httpx {baseline['client_cpu_us_per_request']}us/req, "
+                        f"fast {candidate['client_cpu_us_per_request']}us/req, speedup {row['speedup']}x")
+            results.append(row)
+    return {
+        "meta": {
+            "requests": args.requests,
+            "concurrency": args.concurrency,
+            "httpx_version": getattr(httpx, "__version__", None)
+        },
+        "results": results
+    }
+
+
+def main() -> int:
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--sizes", default="64,512,4096", help="Comma-separated payload sizes in bytes")
+    parser.add_argument("--requests", type=int, default=5000, help="Measured requests per case")
+    parser.add_argument("--warmup", type=int, default=200, help="Unrecorded requests per case")
+    parser.add_argument("--concurrency", type=int, default=4, help="Concurrent in-flight requests")
+    parser.add_argument("--port", type=int, default=18999, help="Port for the mock daemon")
+    parser.add_argument("--output", help="Write the JSON report to this file (default: stdout)")
+    args = parser.parse_args()
+
+    logging.basicConfig(level=logging.INFO, format="%(message)s", stream=sys.stderr)
+    os.environ.setdefault("MOCK_FDO_SEED", "1")
+
+    mock = start_mock(args.port, args.concurrency)
+    try:
+        report = asyncio.run(run(args))
+    finally:
+        mock.terminate()
+        mock.wait(timeout=5)
+
+    output = json.dumps(report, indent=2)
+    if args.output:
+        Path(args.output).write_text(output + "\n")
+    print(output)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())